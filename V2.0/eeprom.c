@@ -7,91 +7,676 @@
 
 
 //private function prototypes;
-static EEPROM_Result EEPROM_PageTransfer();
-static EEPROM_Result EEPROM_SetPageStatus(EEPROM_Page Page, EEPROM_PageStatus PageStatus);
-static EEPROM_Result EEPROM_PageToIndex(EEPROM_Page Page);
+static EEPROM_Result EEPROM_ReadRecord(EEPROM_Handle* Handle, uint16_t Slot, EEPROM_Value* Value);
+static EEPROM_Result EEPROM_WriteRecord(EEPROM_Handle* Handle, uint16_t VariableName, EEPROM_Value Value, EEPROM_Size Size, const uint8_t* Data);
+static uint8_t EEPROM_RecordUnchanged(EEPROM_Handle* Handle, uint16_t Slot, EEPROM_Value Value, EEPROM_Size Size);
+static uint16_t EEPROM_RecordBytes(EEPROM_Handle* Handle, uint16_t Slot);
+static uint16_t EEPROM_BlobHalfword(const uint8_t* Data, uint16_t Length, uint16_t Offset);
+static uint8_t EEPROM_BlobUnchanged(EEPROM_Handle* Handle, uint16_t Slot, const uint8_t* Data, uint16_t Length);
+static EEPROM_Result EEPROM_CountRecord(EEPROM_Handle* Handle, uint16_t VariableName, uint32_t* Value);
+static uint32_t EEPROM_CounterValue(uint32_t Address, uint16_t* Ticks);
+static EEPROM_Result EEPROM_VerifyRecord(EEPROM_Handle* Handle, uint16_t Slot);
+static uint8_t EEPROM_RecordValid(uint32_t Address);
+static uint16_t EEPROM_RecordCrc(uint16_t VariableHeader, EEPROM_Value Value, EEPROM_Size Size, const uint8_t* Data);
+static uint32_t EEPROM_CrcStart();
+static uint32_t EEPROM_CrcUpdate(uint32_t Crc, uint16_t Halfword);
+static EEPROM_Result EEPROM_CountErase(EEPROM_Handle* Handle, EEPROM_Page Page);
+#if EEPROM_STATS
+static void EEPROM_WriteLatency(EEPROM_Handle* Handle, uint32_t Timestamp);
+#endif
+static EEPROM_Result EEPROM_WriteBatch(EEPROM_Handle* Handle, const EEPROM_Variable* Variables, const uint16_t* VariableNames, uint16_t Count);
+static EEPROM_Result EEPROM_WriteRecords(EEPROM_Handle* Handle, const EEPROM_Variable* Variables, const uint16_t* VariableNames, uint16_t Count);
+static uint8_t EEPROM_BatchEntry(EEPROM_Handle* Handle, const EEPROM_Variable* Variables, const uint16_t* VariableNames, uint16_t Count, uint16_t Entry, uint16_t* VariableName, EEPROM_Value* Value, EEPROM_Size* Size);
+static EEPROM_Result EEPROM_PageTransfer(EEPROM_Handle* Handle, uint16_t Budget);
+static EEPROM_Result EEPROM_SetPageStatus(EEPROM_Handle* Handle, EEPROM_Page Page, EEPROM_PageStatus PageStatus);
+static EEPROM_Result EEPROM_ErasePage(EEPROM_Handle* Handle, EEPROM_Page Page);
+static EEPROM_Result EEPROM_FinishErase(uint8_t Wait);
+static uint8_t EEPROM_BeginBurst(void);
+static EEPROM_Result EEPROM_EndBurst(uint8_t Started, EEPROM_Result result);
+static EEPROM_Result EEPROM_CheckBurst(void);
+#if EEPROM_BURST_PROGRAM
+static void EEPROM_PauseBurst(void);
+static EEPROM_Result EEPROM_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+#if !defined(EEPROM_BURST_BEGIN)
+static HAL_StatusTypeDef EEPROM_BurstBegin(uint32_t Address);
+static HAL_StatusTypeDef EEPROM_BurstWrite(uint32_t Address, uint16_t Data);
+static HAL_StatusTypeDef EEPROM_BurstCheck(uint32_t Address);
+static HAL_StatusTypeDef EEPROM_BurstEnd(uint32_t Address);
+#endif
+#endif
+static uint8_t EEPROM_PageBlank(EEPROM_Page Page);
+static EEPROM_Result EEPROM_PageToIndex(EEPROM_Handle* Handle, EEPROM_Page Page);
+static uint16_t EEPROM_ReadHalfword(uint32_t Address, uint32_t* Word, uint32_t* WordAddress);
+static EEPROM_Result EEPROM_WriteCheckpoint(EEPROM_Handle* Handle);
+static uint32_t EEPROM_PageCheckpoint(EEPROM_Handle* Handle, EEPROM_Page Page, uint8_t* Slots);
+static uint32_t EEPROM_NextPage(EEPROM_Handle* Handle, uint32_t Page);
+static uint16_t EEPROM_PageMemory(EEPROM_Handle* Handle, EEPROM_Page Page);
+static void EEPROM_CountLive(EEPROM_Handle* Handle, uint16_t Slot, int8_t Sign);
+static uint16_t EEPROM_PageGarbage(EEPROM_Handle* Handle, EEPROM_Page Page);
+static EEPROM_Result EEPROM_StartTransfer(EEPROM_Handle* Handle, uint8_t Wait);
+static EEPROM_Result EEPROM_InitClass(EEPROM_Handle* Handle);
+static void EEPROM_SelectClass(EEPROM_Handle* Handle, uint8_t Class);
+static uint8_t EEPROM_NameClass(EEPROM_Handle* Handle, uint16_t VariableName);
+static uint8_t EEPROM_PageClass(EEPROM_Handle* Handle, EEPROM_Page Page);
+static void EEPROM_SetShadow(EEPROM_Handle* Handle, uint16_t Slot, EEPROM_Value Value, EEPROM_Size Size);
+#if EEPROM_SPARSE_NAMES
+static uint16_t EEPROM_InsertSlot(EEPROM_Handle* Handle, uint16_t VariableName);
+#endif
+#if EEPROM_CACHE_SIZE > 0
+static EEPROM_Result EEPROM_FlushCache(EEPROM_Handle* Handle, uint8_t Emergency);
+#endif
+static EEPROM_Result EEPROM_DrainQueue(EEPROM_Handle* Handle);
+#if EEPROM_TRANSACTION_SIZE > 0
+static EEPROM_Result EEPROM_TransactionCheck(EEPROM_Handle* Handle, const EEPROM_Variable* Variables, const uint16_t* VariableNames, uint16_t Count);
+static EEPROM_Result EEPROM_TransactionWrite(EEPROM_Handle* Handle, uint16_t VariableName, EEPROM_Value Value, EEPROM_Size Size);
+static EEPROM_Result EEPROM_MoveTransaction(EEPROM_Handle* Handle);
+static void EEPROM_ReserveTransaction(EEPROM_Handle* Handle);
+static EEPROM_Result EEPROM_DropTransaction(EEPROM_Handle* Handle, uint8_t Restore);
+#endif
+
+
+//check configuration
+#if EEPROM_PAGE_COUNT < 2 || EEPROM_PAGE_COUNT * FLASH_PAGE_SIZE > 0x10000
+#error "EEPROM_PAGE_COUNT must be at least 2 and the pages must not exceed 64 KByte (16 bit index)"
+#endif
+#if EEPROM_CACHE_SIZE > 255 || EEPROM_CACHE_THRESHOLD > EEPROM_CACHE_SIZE
+#error "EEPROM_CACHE_SIZE must not exceed 255 and EEPROM_CACHE_THRESHOLD must not exceed EEPROM_CACHE_SIZE"
+#endif
+#if EEPROM_BLOB_MAX_SIZE > FLASH_PAGE_SIZE / 2
+#error "EEPROM_BLOB_MAX_SIZE must not exceed half of the page size"
+#endif
+#if EEPROM_CRC < 0 || EEPROM_CRC > EEPROM_CRC_TRANSFER
+#error "EEPROM_CRC must be 0, EEPROM_CRC_INIT, EEPROM_CRC_READ or EEPROM_CRC_TRANSFER"
+#endif
+#if EEPROM_COUNTER_TICKS < 1 || 10 + 2 * EEPROM_COUNTER_TICKS > FLASH_PAGE_SIZE / 2
+#error "EEPROM_COUNTER_TICKS must be at least 1 and a counter record must not exceed half of the page size"
+#endif
+#if EEPROM_CLASS_COUNT < 1 || EEPROM_CLASS_COUNT > EEPROM_PAGE_COUNT / 2
+#error "EEPROM_CLASS_COUNT must be at least 1 and every class needs at least 2 pages"
+#endif
+#if EEPROM_MAX_PAGE_COUNT < EEPROM_PAGE_COUNT || EEPROM_MAX_CLASS_COUNT < EEPROM_CLASS_COUNT
+#error "EEPROM_MAX_PAGE_COUNT and EEPROM_MAX_CLASS_COUNT must hold the default instance (EEPROM_Init checks EEPROM_MAX_VARIABLE_COUNT)"
+#endif
+#if EEPROM_QUEUE_SIZE < 0 || EEPROM_QUEUE_SIZE > 256 || (EEPROM_QUEUE_SIZE & (EEPROM_QUEUE_SIZE - 1)) != 0
+#error "EEPROM_QUEUE_SIZE must be 0 or a power of 2 up to 256 (the write counters wrap around)"
+#endif
+#if EEPROM_QUEUE_OVERFLOW != EEPROM_QUEUE_REJECT && EEPROM_QUEUE_OVERFLOW != EEPROM_QUEUE_OVERWRITE
+#error "EEPROM_QUEUE_OVERFLOW must be EEPROM_QUEUE_REJECT or EEPROM_QUEUE_OVERWRITE"
+#endif
+#if EEPROM_TRANSACTION_SIZE < 0 || EEPROM_TRANSACTION_SIZE > 255
+#error "EEPROM_TRANSACTION_SIZE must not exceed 255"
+#endif
+#if EEPROM_COMPACT_THRESHOLD < 0 || EEPROM_COMPACT_THRESHOLD > 100
+#error "EEPROM_COMPACT_THRESHOLD must be a percentage (0: off)"
+#endif
+#if EEPROM_BANK != 1 && EEPROM_BANK != 2
+#error "EEPROM_BANK must be 1 or 2"
+#endif
+
+
+//flash read access (can be redirected by the build, e.g. to the host flash simulator)
+#ifndef EEPROM_READ16
+#define EEPROM_READ16(Address)	(*((__IO uint16_t*) (Address)))
+#endif
+#ifndef EEPROM_READ32
+#define EEPROM_READ32(Address)	(*((__IO uint32_t*) (Address)))
+#endif
+#ifndef EEPROM_POINTER
+#define EEPROM_POINTER(Address)	((const uint8_t*) (Address))
+#endif
+
+//flash write access in program mode (burst programming on the flash registers, can be redirected like the read access)
+#ifndef EEPROM_WRITE16
+#define EEPROM_WRITE16(Address, Data)	(*((__IO uint16_t*) (Address)) = (Data))
+#endif
+
+
+//record written to the receiving page when all variables are carried forward (from then on the source page may be erased)
+//a deleted record with a name above every valid variable name, so it is ignored as variable
+#define EEPROM_TRANSFER_MARKER	0x3FFF
+
+//record of a checkpoint (variable count, header, addresses of all variables, size codes packed 8 per halfword, sparse names: names of all entries)
+//the header is a deleted record with a name above every valid variable name, the variable count is written before it,
+//so an interrupted checkpoint looks like an interrupted variable write (header missing) or is skipped (checkpoint not in a slot)
+#define EEPROM_CHECKPOINT_HEADER	0x3FFE
+#define EEPROM_CHECKPOINT_BYTES(Count)	(2U * (2 + (Count) + ((Count) + 7) / 8 + (EEPROM_SPARSE_NAMES ? (Count) : 0)))
+
+//name of a padding record (written by EEPROM_PageToIndex as header of an interrupted write, so records written behind it can't be
+//mistaken for its data), a variable record with a name above every valid variable name, so it is ignored as variable
+#define EEPROM_PADDING_NAME		0x3FFD
+
+//size of the CRC of a record in bytes (in front of the header of a variable record, in front of the commit halfword of a blob or counter)
+#if EEPROM_CRC
+#define EEPROM_CRC_BYTES		2
+#else
+#define EEPROM_CRC_BYTES		0
+#endif
+
+//record of a variable (header, value, CRC)
+#define EEPROM_RECORD_BYTES(Size)	(((Size) == EEPROM_SIZE_DELETED || (Size) == EEPROM_SIZE8 ? 2 : 2 + (1 << (Size))) + EEPROM_CRC_BYTES)
+
+//inline record of an 8 bit value (header 0b011 | 5 bit name | value, CRC), a 16 bit record with bit 13 of the name set (EEPROM_INLINE_VALUES)
+//name 31 is left out (its headers include the padding header), the CRC is written before the header, so the header is the only commit
+//its index entry is odd (offset of the header + 1), a checkpoint stores it like a blob (size code 0, but an address)
+#define EEPROM_INLINE_HEADER	0x6000
+#define EEPROM_INLINE_RECORD(Header)	(EEPROM_INLINE_VALUES && ((Header) & 0xE000) == EEPROM_INLINE_HEADER && ((Header) & 0x1F00) != 0x1F00)
+
+//offset of the record header from the index entry of a variable (the value follows the header, an inline value is in the header)
+#define EEPROM_HEADER_OFFSET(Index)	(((Index) - 1) & ~1U)
+
+//commit halfword of a transaction (EEPROM_TRANSACTION_SIZE), in front of its records: reserved erased, programmed last by EEPROM_Commit
+//0xA000: committed, 0xA000 | halfwords: aborted (the records up to header + 2 * halfwords are skipped), a 32 bit record with bit 13
+//of the name set (no variable name), the padding header 0xBFFD is left out (more halfwords than a page has)
+#define EEPROM_TRANSACTION_HEADER	0xA000
+#define EEPROM_TRANSACTION_RECORD(Header)	(EEPROM_TRANSACTION_SIZE > 0 && ((Header) & 0xE000) == EEPROM_TRANSACTION_HEADER && ((Header) & 0x1FFF) <= FLASH_PAGE_SIZE / 2)
+
+//sizes written by EEPROM_UpdateVariable, EEPROM_WriteVariables and EEPROM_WriteVariableFromISR (8 bit only for names with inline records)
+#define EEPROM_SIZE_INVALID(Name, Size)	((Size) > EEPROM_SIZE64 && ((Size) != EEPROM_SIZE8 || !EEPROM_INLINE_VALUES || (Name) >= EEPROM_INLINE_NAMES))
+
+//record of a blob (header, length, data padded to halfwords with 0xFF, CRC, commit halfword 0x0000)
+//the header is a deleted record with bit 13 of the name set, the length is written before it and the commit halfword
+//after the data, so an interrupted blob write looks like an interrupted variable write (header missing) or is skipped (no commit)
+#define EEPROM_BLOB_HEADER		0x2000
+#define EEPROM_BLOB_BYTES(Length)	(6 + (((Length) + 1) & ~1) + EEPROM_CRC_BYTES)
+
+//record of a counter (blob header, tick count with EEPROM_COUNTER_FLAG, 32 bit base value, ticks, CRC, commit halfword 0x0000)
+//the ticks are written erased, each increment overwrites the next tick with 0x0000 (value = base + ticks not erased)
+#define EEPROM_COUNTER_FLAG		0x8000
+#define EEPROM_COUNTER_BYTES(Ticks)	(10 + 2 * (Ticks) + EEPROM_CRC_BYTES)
+
+//size of the page header in bytes (page status, checkpoint slots, erase count)
+#if EEPROM_CHECKPOINT_INTERVAL > 0
+#define EEPROM_ERASE_COUNT_OFFSET	(2 + 2 * EEPROM_CHECKPOINT_SLOTS)
+#else
+#define EEPROM_ERASE_COUNT_OFFSET	2
+#endif
+#if EEPROM_STATS
+#define EEPROM_PAGE_HEADER		(EEPROM_ERASE_COUNT_OFFSET + 2)
+#else
+#define EEPROM_PAGE_HEADER		EEPROM_ERASE_COUNT_OFFSET
+#endif
+#if EEPROM_CHECKPOINT_INTERVAL > 0 && (EEPROM_CHECKPOINT_SLOTS < 1 || EEPROM_CHECKPOINT_SLOTS > 255)
+#error "EEPROM_CHECKPOINT_SLOTS must be 1 to 255"
+#endif
+
+//flash programming (counts the programmed halfwords for the statistics of the instance "Handle", burst programming: part of a running burst)
+#if EEPROM_BURST_PROGRAM
+#define EEPROM_FLASH_PROGRAM	EEPROM_Program
+#else
+#define EEPROM_FLASH_PROGRAM	HAL_FLASH_Program
+#endif
+#if EEPROM_STATS
+#define EEPROM_PROGRAM(TypeProgram, Address, Data)	(Handle->HalfwordPrograms += 1 << ((TypeProgram) - 1), EEPROM_FLASH_PROGRAM(TypeProgram, Address, Data))
+#else
+#define EEPROM_PROGRAM(TypeProgram, Address, Data)	EEPROM_FLASH_PROGRAM(TypeProgram, Address, Data)
+#endif
+
+//burst programming hooks (can be redirected by the build, e.g. to the host flash simulator), each returns a HAL_StatusTypeDef
+//EEPROM_BURST_BEGIN:		wait for the last operation, clear the flags and enter program mode for the bank of Address
+//EEPROM_BURST_WRITE:		write a halfword and wait while the flash is busy (no flag check, HAL_TIMEOUT if it stays busy)
+//EEPROM_BURST_CHECK:		check the error flags of the halfwords written in program mode of the bank of Address (stays in program mode)
+//EEPROM_BURST_END:		leave program mode of the bank of Address and check the error flags of all halfwords written in it
+#if EEPROM_BURST_PROGRAM && !defined(EEPROM_BURST_BEGIN)
+#define EEPROM_BURST_BEGIN(Address)			EEPROM_BurstBegin(Address)
+#define EEPROM_BURST_WRITE(Address, Data)	EEPROM_BurstWrite(Address, Data)
+#define EEPROM_BURST_CHECK(Address)			EEPROM_BurstCheck(Address)
+#define EEPROM_BURST_END(Address)			EEPROM_BurstEnd(Address)
+#define EEPROM_BURST_REGISTERS
+#endif
+
+//flash bank of an address (erase definitions of XL-density devices, FLASH_BANK_BOTH for pages in both banks)
+#if defined(FLASH_BANK2_END)
+#define EEPROM_FLASH_BANK(Address)	((Address) > FLASH_BANK1_END ? FLASH_BANK_2 : FLASH_BANK_1)
+#else
+#define EEPROM_FLASH_BANK(Address)	FLASH_BANK_1
+#endif
+
+#ifdef EEPROM_BURST_REGISTERS
+//status flag and control register of the bank of an address (burst programming, bank 2 of XL-density devices has its own registers)
+#if defined(FLASH_BANK2_END)
+#define EEPROM_FLASH_FLAG(Address, Flag)	((Address) > FLASH_BANK1_END ? Flag##_BANK2 : Flag)
+#define EEPROM_FLASH_CR(Address)			(*((Address) > FLASH_BANK1_END ? &FLASH->CR2 : &FLASH->CR))
+#else
+#define EEPROM_FLASH_FLAG(Address, Flag)	(Flag)
+#define EEPROM_FLASH_CR(Address)			(FLASH->CR)
+#endif
+#endif
+
+//entries of the address index of the instance "Handle" (dense names: entry i is variable i, sparse names: hash table of the names)
+//EEPROM_NAME_LIMIT:		variable names are 0 ... EEPROM_NAME_LIMIT - 1
+//EEPROM_SLOT:				entry of a variable name (sparse names: EEPROM_SLOT_NONE if the name has none)
+//EEPROM_SLOT_NAME:			variable name of an entry
+//EEPROM_FIRST_SLOT/END_SLOT:	entries which can hold variables of the selected class
+//EEPROM_SLOT_IN_CLASS:		1 if the entry holds a variable name of the selected class
+#if EEPROM_SPARSE_NAMES
+#define EEPROM_NAME_LIMIT		EEPROM_NAME_COUNT
+#define EEPROM_SLOT(Name)		EEPROM_FindSlot(Handle->Names, Handle->VariableCount, Name)
+#define EEPROM_SLOT_NAME(Slot)	(Handle->Names[Slot])
+#define EEPROM_FIRST_SLOT		0
+#define EEPROM_END_SLOT			Handle->VariableCount
+#define EEPROM_SLOT_IN_CLASS(Slot)	(Handle->Names[Slot] >= Handle->FirstName && Handle->Names[Slot] < Handle->EndName)
+#else
+#define EEPROM_NAME_LIMIT		Handle->VariableCount
+#define EEPROM_SLOT(Name)		(Name)
+#define EEPROM_SLOT_NAME(Slot)	(Slot)
+#define EEPROM_FIRST_SLOT		Handle->FirstName
+#define EEPROM_END_SLOT			Handle->EndName
+#define EEPROM_SLOT_IN_CLASS(Slot)	1
+#endif
+
+//address of page number 0 ... of the selected variable class of the instance "Handle"
+#define EEPROM_CLASS_PAGE(Number)	(Handle->ClassStart + (Number) * FLASH_PAGE_SIZE)
+
+//budget of EEPROM_PageTransfer to carry all variables forward and erase the source page in one call
+#define EEPROM_TRANSFER_ALL		0xFFFF
+
+//maximum time to wait for the end of an asynchronous page erase in ms
+#define EEPROM_ERASE_TIMEOUT	100
+
+
+//global variables (flash controller state shared by all instances, the state of an instance is kept in its EEPROM_Handle)
+static uint32_t EEPROM_ErasingPage = EEPROM_PAGE_NONE;		//page with a running asynchronous erase (joins the erased pages of its class when finished)
+static EEPROM_Handle* EEPROM_ErasingHandle = NULL;			//instance of the erasing page
+static volatile EEPROM_Result EEPROM_EraseResult = EEPROM_SUCCESS;	//EEPROM_PENDING until the flash interrupt reports the end of the erase
+#if EEPROM_BURST_PROGRAM
+static uint8_t EEPROM_Burst = 0;							//0: no burst, 1: burst running (program mode is entered with its next halfword), 2: burst in program mode
+static uint32_t EEPROM_BurstAddress = 0;					//first address programmed since program mode was entered (selects the bank)
+static EEPROM_Result EEPROM_BurstResult = EEPROM_SUCCESS;	//error flags of the parts of the running burst which already left program mode
+#endif
+
+//default instance (functions without handle) on the region of the library configuration
+static uint16_t EEPROM_DefaultIndex[EEPROM_VARIABLE_COUNT];
+static uint8_t EEPROM_DefaultSizeTable[EEPROM_VARIABLE_COUNT];
+#if EEPROM_SHADOW
+EEPROM_Value EEPROM_DefaultShadow[EEPROM_VARIABLE_COUNT];					//not static: read by the inline accessor EEPROM_ReadShadow
+#endif
+#if EEPROM_SPARSE_NAMES
+uint16_t EEPROM_DefaultNames[EEPROM_VARIABLE_COUNT];						//not static: read by the inline accessor EEPROM_ReadShadow
+#endif
+static const uint8_t EEPROM_ClassPages[EEPROM_CLASS_COUNT] = EEPROM_CLASS_PAGES;
+static const uint16_t EEPROM_ClassNames[EEPROM_CLASS_COUNT] = EEPROM_CLASS_NAMES;
+static EEPROM_Handle EEPROM_Default =
+{
+	.StartAddress = EEPROM_START_ADDRESS,
+	.PageCount = EEPROM_PAGE_COUNT,
+	.VariableCount = EEPROM_VARIABLE_COUNT,
+	.ClassCount = EEPROM_CLASS_COUNT,
+	.SizeTable = EEPROM_DefaultSizeTable,
+	.Index = EEPROM_DefaultIndex,
+	.ClassStart = EEPROM_START_ADDRESS,
+	.ClassEnd = EEPROM_START_ADDRESS + EEPROM_PAGE_COUNT * FLASH_PAGE_SIZE,
+	.EndName = EEPROM_VARIABLE_COUNT
+};
+
+#if EEPROM_CRC && !EEPROM_CRC_HARDWARE
+//CRC-16/CCITT (polynomial 0x1021) of each byte value
+static const uint16_t EEPROM_CrcTable[256] =
+{
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+	0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+	0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+	0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+	0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+	0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+	0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+	0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+	0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+	0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+	0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+	0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+	0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+	0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+	0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+	0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+	0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+	0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+	0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+	0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+	0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+	0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+	0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+	0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+	0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+	0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+	0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+	0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+	0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+	0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+	0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+#endif
+
+#if EEPROM_CACHE_SIZE > 0
+static volatile uint8_t EEPROM_Lock = 0;					//a library call changes the cache or the flash (EEPROM_EmergencyFlush must not interrupt it)
+static uint8_t EEPROM_Emergency = 0;						//emergency flush: don't start or finish page transfers (no time to erase)
+#endif
+
+
+// initialize an instance & restore the pages of its region to a known good state in case of page's status corruption after a power loss
+// (EEPROM_Init initializes the default instance, further instances can be initialized and used alongside it)
+// - check the region
+// - finish a running asynchronous erase
+// - take over the region and reset the instance variables
+// - set up page set and variable names of each class
+// - unlock flash
+// - read the erase count of each page
+// - restore the pages of each class and build its part of the address index
+//
+// Handle:	instance to initialize (kept by the caller as long as the instance is used, no EEPROM_WriteVariableFromISR meanwhile)
+// Region:	region of the instance (only read during the call, index and size table are kept)
+// return:	EEPROM_SUCCESS, EEPROM_NO_VALID_PAGE (also if the region or the classes don't fit), EEPROM_INVALID_NAME (variable count or storage don't fit),
+//			EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+EEPROM_Result EEPROM_HandleInit(EEPROM_Handle* Handle, const EEPROM_Region* Region)
+{
+	EEPROM_Result result;
+
+	//check the region (page aligned, 16 bit index, array sizes of EEPROM_Handle)
+	if (Region->StartAddress % FLASH_PAGE_SIZE != 0 || Region->PageCount < 2 || Region->PageCount > EEPROM_MAX_PAGE_COUNT
+		|| Region->PageCount * FLASH_PAGE_SIZE > 0x10000 || Region->ClassCount > EEPROM_MAX_CLASS_COUNT) return EEPROM_NO_VALID_PAGE;
+	if (Region->VariableCount == 0 || Region->VariableCount > EEPROM_MAX_VARIABLE_COUNT || Region->Index == NULL || Region->SizeTable == NULL) return EEPROM_INVALID_NAME;
+	if ((EEPROM_SHADOW && Region->Shadow == NULL) || (EEPROM_SPARSE_NAMES && Region->Names == NULL)) return EEPROM_INVALID_NAME;
+
+	//finish a running asynchronous erase (EEPROM_Init called again)
+	result = EEPROM_FinishErase(1);
+	if (result != EEPROM_SUCCESS) return result;
+
+	//take over the region and reset the instance variables (makes EEPROM_Init repeatable, e.g. after a simulated reset)
+	Handle->StartAddress = Region->StartAddress;
+	Handle->PageCount = Region->PageCount;
+	Handle->VariableCount = Region->VariableCount;
+	Handle->ClassCount = Region->ClassCount > 0 ? Region->ClassCount : 1;
+	Handle->Index = Region->Index;
+	Handle->SizeTable = Region->SizeTable;
+#if EEPROM_SHADOW
+	Handle->Shadow = Region->Shadow;
+#endif
+#if EEPROM_SPARSE_NAMES
+	Handle->Names = Region->Names;
+#endif
+	for (uint16_t i = 0; i < Handle->VariableCount; i++)
+	{
+		Handle->Index[i] = 0;
+		Handle->SizeTable[i] = EEPROM_SIZE_DELETED;
+#if EEPROM_SPARSE_NAMES
+		Handle->Names[i] = EEPROM_SLOT_NONE;
+#endif
+	}
+	Handle->ValidPage = EEPROM_PAGE_NONE;
+	Handle->ActivePage = EEPROM_PAGE_NONE;
+	Handle->ReceivingPage = EEPROM_PAGE_NONE;
+	Handle->ErasedPage = EEPROM_PAGE_NONE;
+	Handle->ErasedCount = 0;
+	Handle->NextIndex = 0;
+	Handle->TransferName = 0;
+	Handle->TransferBytes = 0;
+	Handle->TransferMarked = 0;
+	Handle->Writes = 0;
+	Handle->ElidedWrites = 0;
+	Handle->CheckpointRecords = 0;
+	Handle->CheckpointSlots = 0;
+#if EEPROM_CRC == EEPROM_CRC_READ
+	for (uint16_t i = 0; i < (Handle->VariableCount + 7) / 8; i++) Handle->Verified[i] = 0;
+#endif
+#if EEPROM_STATS
+	Handle->HalfwordPrograms = 0;
+	Handle->PageErases = 0;
+	Handle->PageTransfers = 0;
+	Handle->CopiedBytes = 0;
+	Handle->WrittenBytes = 0;
+	Handle->MaxWriteLatency = 0;
+#endif
+#if EEPROM_CACHE_SIZE > 0
+	Handle->CacheCount = 0;
+#endif
+#if EEPROM_QUEUE_SIZE > 0
+	Handle->QueueHead = 0;
+	Handle->QueueClaim = 0;
+	Handle->QueueTail = 0;
+	Handle->QueueHighWater = 0;
+	Handle->QueueOverflows = 0;
+#endif
+#if EEPROM_TRANSACTION_SIZE > 0
+	Handle->TransactionCount = 0;
+	Handle->TransactionOpen = 0;
+	Handle->TransactionClass = 0;
+	Handle->TransactionHeader = 0;
+	Handle->TransactionResult = EEPROM_SUCCESS;
+#endif
+
+	//set up page set and variable names of each class (pages in class order, every class has at least 2 pages and 1 variable)
+	uint32_t ClassStart = Handle->StartAddress;
+	for (uint8_t i = 0; i < Handle->ClassCount; i++)
+	{
+		uint8_t Pages = Region->ClassCount > 0 ? Region->ClassPages[i] : Handle->PageCount;
+		EEPROM_ClassState* Class = &Handle->Classes[i];
+		*Class = (EEPROM_ClassState) {0};
+		Class->ClassStart = ClassStart;
+		Class->ClassEnd = ClassStart + Pages * FLASH_PAGE_SIZE;
+		Class->FirstName = Region->ClassCount > 0 ? Region->ClassNames[i] : 0;
+		Class->EndName = i + 1 < Handle->ClassCount ? Region->ClassNames[i + 1] : EEPROM_NAME_LIMIT;
+		if (Pages < 2 || Class->FirstName >= Class->EndName || Class->EndName > EEPROM_NAME_LIMIT) return EEPROM_NO_VALID_PAGE;
+		ClassStart = Class->ClassEnd;
+	}
+	if (Handle->Classes[0].FirstName != 0 || ClassStart != Handle->StartAddress + Handle->PageCount * FLASH_PAGE_SIZE) return EEPROM_NO_VALID_PAGE;
+	Handle->Class = 0;
+	Handle->ClassStart = Handle->Classes[0].ClassStart;
+	Handle->ClassEnd = Handle->Classes[0].ClassEnd;
+	Handle->FirstName = Handle->Classes[0].FirstName;
+	Handle->EndName = Handle->Classes[0].EndName;
 
+	//unlock the flash memory
+	HAL_FLASH_Unlock();
 
-//global variables
-static uint8_t EEPROM_SizeTable[EEPROM_VARIABLE_COUNT];		//EEPROM_SizeTable[i]: actual size of variable i (as EEPROM_Size)
-static uint16_t EEPROM_Index[EEPROM_VARIABLE_COUNT];		//EEPROM_Index[i]: actual address of variable i (physical address = EEPROM_START_ADDRESS + EEPROM_Index[i])
-															//if EEPROM_Index[i] = 0 variable i not assigned
+	//read the erase count of each page (a missing count continues with the highest count of the other pages)
+#if EEPROM_STATS
+	uint16_t EraseCount = 0;
+	for (uint8_t i = 0; i < Handle->PageCount; i++)
+	{
+		Handle->EraseCounts[i] = EEPROM_READ16(Handle->StartAddress + i * FLASH_PAGE_SIZE + EEPROM_ERASE_COUNT_OFFSET);
+		if (Handle->EraseCounts[i] != 0xFFFF && Handle->EraseCounts[i] > EraseCount) EraseCount = Handle->EraseCounts[i];
+	}
+	for (uint8_t i = 0; i < Handle->PageCount; i++)
+	{
+		if (Handle->EraseCounts[i] == 0xFFFF) Handle->EraseCounts[i] = EraseCount;
+	}
+#endif
 
-static uint32_t EEPROM_ValidPage = EEPROM_PAGE_NONE;
-static uint32_t EEPROM_ReceivingPage = EEPROM_PAGE_NONE;
-static uint32_t EEPROM_ErasedPage = EEPROM_PAGE_NONE;
+	//restore the pages of each class and build its part of the address index
+	for (uint8_t i = 0; i < Handle->ClassCount; i++)
+	{
+		EEPROM_SelectClass(Handle, i);
+		result = EEPROM_InitClass(Handle);
+		if (result != EEPROM_SUCCESS) return result;
+	}
 
-static uint32_t EEPROM_NextIndex = 0;
+	return EEPROM_SUCCESS;
+}
 
 
-// initialize the EEPROM & restore the pages to a known good state in case of page's status corruption after a power loss
-// - unlock flash
-// - read each page status and check if valid
-// - if invalid page status, format EEPROM
-// - set global variables ValidPage, ReceivingPage and ErasedPage
-// - build address index
-// - resume page transfer if needed
+// restores the pages of the selected class & builds the address index of its variables
+// - read each page status
+// - erase the source page of an interrupted page transfer again, if a power loss might have interrupted its erase
+// - check if page status valid
+// - find the oldest page of the log and check that the used pages follow it in ring order
+// - if invalid page status, format the pages of the class
+// - set global page variables and build address index (from oldest to newest page, only the newest page if it holds a checkpoint)
+// - load the shadow copy of the variables
+// - resume page transfer if needed (in incremental mode EEPROM_Poll finishes it)
 //
 // return: EEPROM_SUCCESS, EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
-EEPROM_Result EEPROM_Init()
+static EEPROM_Result EEPROM_InitClass(EEPROM_Handle* Handle)
 {
 	EEPROM_Result result;
+	uint8_t PageCount = (Handle->ClassEnd - Handle->ClassStart) / FLASH_PAGE_SIZE;
 
-	//unlock the flash memory
-	HAL_FLASH_Unlock();
+	//read each page status
+	EEPROM_PageStatus PageStatus[EEPROM_MAX_PAGE_COUNT];
+	uint8_t ReceivingCount = 0;
+	uint8_t ReceivingPage = 0;
+	for (uint8_t i = 0; i < PageCount; i++)
+	{
+		PageStatus[i] = EEPROM_READ16(EEPROM_CLASS_PAGE(i));
+		if (PageStatus[i] == EEPROM_RECEIVING)
+		{
+			ReceivingCount++;
+			ReceivingPage = i;
+		}
+	}
+
+	//erase the source page of an interrupted page transfer (page following the receiving page) again, if its erase might have been interrupted
+	//(the erase starts after the transfer marker and ends before the receiving page is marked as valid, a partly erased page can show any status)
+	// - valid status: only if the receiving page holds the transfer marker
+	// - erased status: only if the page is not blank
+	// - invalid status: always
+	if (ReceivingCount == 1)
+	{
+		uint8_t SourcePage = (ReceivingPage + 1) % PageCount;
+		uint8_t EraseRequired = PageStatus[SourcePage] != EEPROM_VALID && PageStatus[SourcePage] != EEPROM_ERASED;
+		if (PageStatus[SourcePage] == EEPROM_ERASED) EraseRequired = !EEPROM_PageBlank(EEPROM_CLASS_PAGE(SourcePage));
+		if (PageStatus[SourcePage] == EEPROM_VALID)
+		{
+			result = EEPROM_PageToIndex(Handle, EEPROM_CLASS_PAGE(ReceivingPage));
+			if (result != EEPROM_SUCCESS) return result;
+			EraseRequired = Handle->TransferMarked;
+			for (uint16_t i = EEPROM_FIRST_SLOT; i < EEPROM_END_SLOT; i++)
+			{
+				if (!EEPROM_SLOT_IN_CLASS(i)) continue;
+				Handle->Index[i] = 0;
+				Handle->SizeTable[i] = EEPROM_SIZE_DELETED;
+			}
+		}
 
-	//read each page status and check if valid
-	EEPROM_PageStatus PageStatus0 = *((__IO uint16_t*) EEPROM_PAGE0);
-	EEPROM_PageStatus PageStatus1 = *((__IO uint16_t*) EEPROM_PAGE1);
+		if (EraseRequired)
+		{
+			FLASH_EraseInitTypeDef EraseDefinitions;
+			EraseDefinitions.TypeErase = FLASH_TYPEERASE_PAGES;
+			EraseDefinitions.Banks = EEPROM_FLASH_BANK(EEPROM_CLASS_PAGE(SourcePage));
+			EraseDefinitions.PageAddress = EEPROM_CLASS_PAGE(SourcePage);
+			EraseDefinitions.NbPages = 1;
+			uint32_t PageError;
+
+			result = HAL_FLASHEx_Erase(&EraseDefinitions, &PageError);
+			if (result != EEPROM_SUCCESS) return result;
+			result = EEPROM_CountErase(Handle, EEPROM_CLASS_PAGE(SourcePage));
+			if (result != EEPROM_SUCCESS) return result;
+			PageStatus[SourcePage] = EEPROM_ERASED;
+		}
+	}
+
+	//check if page status valid (at most one receiving page, at least one page in use, at least one erased or receiving page)
+	uint8_t ErasedCount = 0;
 	uint8_t InvalidState = 0;
-	if (PageStatus0 != EEPROM_VALID && PageStatus0 != EEPROM_RECEIVING && PageStatus0 != EEPROM_ERASED) InvalidState = 1;
-	if (PageStatus1 != EEPROM_VALID && PageStatus1 != EEPROM_RECEIVING && PageStatus1 != EEPROM_ERASED) InvalidState = 1;
-	if (PageStatus0 == PageStatus1) InvalidState = 1;
+	for (uint8_t i = 0; i < PageCount; i++)
+	{
+		if (PageStatus[i] == EEPROM_ERASED) ErasedCount++;
+		else if (PageStatus[i] != EEPROM_VALID && PageStatus[i] != EEPROM_RECEIVING) InvalidState = 1;
+	}
+	if (ReceivingCount > 1 || ErasedCount == PageCount || ErasedCount + ReceivingCount == 0) InvalidState = 1;
 
-	// if invalid page status, format EEPROM (erase both pages and set page0 as valid)
+	//find the oldest page of the log (used page following an erased page, or following the receiving page if no page is erased)
+	uint8_t OldestPage = 0;
+	for (uint8_t i = 0; i < PageCount && !InvalidState; i++)
+	{
+		EEPROM_PageStatus PreviousStatus = PageStatus[(i + PageCount - 1) % PageCount];
+		if (PageStatus[i] == EEPROM_ERASED) continue;
+		if (PreviousStatus == EEPROM_ERASED || (ErasedCount == 0 && PreviousStatus == EEPROM_RECEIVING)) OldestPage = i;
+	}
+
+	//check that the used pages follow the oldest page in ring order and that only the newest page is receiving
+	for (uint8_t i = 0; i < PageCount - ErasedCount && !InvalidState; i++)
+	{
+		EEPROM_PageStatus Status = PageStatus[(OldestPage + i) % PageCount];
+		if (Status == EEPROM_ERASED || (Status == EEPROM_RECEIVING && i != PageCount - ErasedCount - 1)) InvalidState = 1;
+	}
+
+	// if invalid page status, format the pages of the class (erase them and set the first one as valid)
 	if (InvalidState)
 	{
 		FLASH_EraseInitTypeDef EraseDefinitions;
 		EraseDefinitions.TypeErase = FLASH_TYPEERASE_PAGES;
-		EraseDefinitions.Banks = FLASH_BANK_1;
-		EraseDefinitions.PageAddress = EEPROM_PAGE0;
-		EraseDefinitions.NbPages = 2;
+		EraseDefinitions.Banks = EEPROM_FLASH_BANK(Handle->ClassStart) | EEPROM_FLASH_BANK(Handle->ClassEnd - 1);
+		EraseDefinitions.PageAddress = Handle->ClassStart;
+		EraseDefinitions.NbPages = PageCount;
 		uint32_t PageError;
 
 		result = HAL_FLASHEx_Erase(&EraseDefinitions, &PageError);
 		if (result != EEPROM_SUCCESS) return result;
+		for (uint8_t i = 0; i < PageCount; i++)
+		{
+			result = EEPROM_CountErase(Handle, EEPROM_CLASS_PAGE(i));
+			if (result != EEPROM_SUCCESS) return result;
+		}
 
-		result = HAL_FLASH_Program(EEPROM_SIZE16, EEPROM_PAGE0, EEPROM_VALID);
+		result = EEPROM_PROGRAM(EEPROM_SIZE16, Handle->ClassStart, EEPROM_VALID);
 		if (result != EEPROM_SUCCESS) return result;
 
-		PageStatus0 = EEPROM_VALID;
-		PageStatus1 = EEPROM_ERASED;
+		PageStatus[0] = EEPROM_VALID;
+		for (uint8_t i = 1; i < PageCount; i++) PageStatus[i] = EEPROM_ERASED;
+		ErasedCount = PageCount - 1;
+		OldestPage = 0;
+	}
+
+	//set global page variables and build address index (addresses from newer pages are dominant)
+	//the latest checkpoint of the newest page holds the addresses of the older pages (they don't have to be read)
+	uint8_t NewestPage = (OldestPage + PageCount - ErasedCount - 1) % PageCount;
+	uint8_t Slots;
+	uint8_t Checkpoint = EEPROM_PageCheckpoint(Handle, EEPROM_CLASS_PAGE(NewestPage), &Slots) != 0;
+	for (uint8_t i = 0; i < PageCount - ErasedCount; i++)
+	{
+		uint8_t Page = (OldestPage + i) % PageCount;
+		if (PageStatus[Page] == EEPROM_VALID)
+		{
+			if (Handle->ValidPage == EEPROM_PAGE_NONE) Handle->ValidPage = EEPROM_CLASS_PAGE(Page);
+			Handle->ActivePage = EEPROM_CLASS_PAGE(Page);
+		}
+		else Handle->ReceivingPage = EEPROM_CLASS_PAGE(Page);
+
+		if (!Checkpoint || Page == NewestPage)
+		{
+			result = EEPROM_PageToIndex(Handle, EEPROM_CLASS_PAGE(Page));
+			if (result != EEPROM_SUCCESS) return result;
+		}
 	}
+	Handle->ErasedCount = ErasedCount;
+	if (ErasedCount > 0) Handle->ErasedPage = EEPROM_CLASS_PAGE((OldestPage + PageCount - ErasedCount) % PageCount);
 
-	//set global variables ValidPage, ReceivingPage and ErasedPage (one stays EEPROM_PAGE_NONE)
-	if (PageStatus0 == EEPROM_VALID) EEPROM_ValidPage = EEPROM_PAGE0;
-	if (PageStatus1 == EEPROM_VALID) EEPROM_ValidPage = EEPROM_PAGE1;
-	if (PageStatus0 == EEPROM_RECEIVING) EEPROM_ReceivingPage = EEPROM_PAGE0;
-	if (PageStatus1 == EEPROM_RECEIVING) EEPROM_ReceivingPage = EEPROM_PAGE1;
-	if (PageStatus0 == EEPROM_ERASED) EEPROM_ErasedPage = EEPROM_PAGE0;
-	if (PageStatus1 == EEPROM_ERASED) EEPROM_ErasedPage = EEPROM_PAGE1;
+	//load the shadow copy of the variables (0 if not assigned)
+#if EEPROM_SHADOW
+	for (uint16_t i = EEPROM_FIRST_SLOT; i < EEPROM_END_SLOT; i++)
+	{
+		EEPROM_Value Value = {0};
+		if (!EEPROM_SLOT_IN_CLASS(i)) continue;
+		EEPROM_ReadRecord(Handle, i, &Value);
+		EEPROM_SetShadow(Handle, i, Value, Handle->Index[i] != 0 ? Handle->SizeTable[i] : EEPROM_SIZE_DELETED);
+	}
+#endif
 
-	//build address index (addresses from receiving page are dominant)
-	EEPROM_PageToIndex(EEPROM_ValidPage);
-	EEPROM_PageToIndex(EEPROM_ReceivingPage);
+	//sum up the live bytes of each page of the class (kept up to date by every change of the index from now on)
+	for (uint8_t i = 0; i < PageCount; i++) Handle->LiveBytes[(EEPROM_CLASS_PAGE(i) - Handle->StartAddress) / FLASH_PAGE_SIZE] = 0;
+	for (uint16_t i = EEPROM_FIRST_SLOT; i < EEPROM_END_SLOT; i++)
+	{
+		if (EEPROM_SLOT_IN_CLASS(i)) EEPROM_CountLive(Handle, i, 1);
+	}
 
-	//if needed, resume page transfer or just mark receiving page as valid
-	if (EEPROM_ReceivingPage != EEPROM_PAGE_NONE)
+	//if needed, resume page transfer or just mark receiving page as valid (source page already erased)
+	Handle->TransferMarked = 0;
+	if (Handle->ReceivingPage != EEPROM_PAGE_NONE)
 	{
-		if (EEPROM_ValidPage == EEPROM_PAGE_NONE)
+		if (Handle->ValidPage != EEPROM_NextPage(Handle, Handle->ReceivingPage))
 		{
-			result = EEPROM_SetPageStatus(EEPROM_ReceivingPage, EEPROM_VALID);
+			result = EEPROM_SetPageStatus(Handle, Handle->ReceivingPage, EEPROM_VALID);
 			if (result != EEPROM_SUCCESS) return result;
 		}
 		else
 		{
-			result = EEPROM_PageTransfer(EEPROM_ValidPage, EEPROM_ReceivingPage);
-			if (result != EEPROM_SUCCESS) return result;
+			Handle->TransferName = EEPROM_FIRST_SLOT;
+			Handle->TransferBytes = EEPROM_PageMemory(Handle, Handle->ValidPage) + 2;
+			if (!EEPROM_INCREMENTAL_TRANSFER)
+			{
+				result = EEPROM_PageTransfer(Handle, EEPROM_TRANSFER_ALL);
+				if (result != EEPROM_SUCCESS) return result;
+			}
 		}
 	}
 	
@@ -101,27 +686,125 @@ EEPROM_Result EEPROM_Init()
 
 // returns the last stored variable value which correspond to the passed variable name
 // - check if variable name exists
-// - check if variable was assigned
-// - read variable value from physical address with right size
+// - return a dirty value from the write-back cache
+// - find the entry of the variable in the address index
+// - check the CRC of the record on the first read (EEPROM_CRC_READ)
+// - read the variable from the shadow copy (EEPROM_SHADOW) or from flash
 //
 // VariableName:	name (number) of the variable to read
-// Value:			outputs the variable value
-// return:			EEPROM_SUCCESS, EEPROM_INVALID_NAME, EEPROM_NOT_ASSIGNED
-EEPROM_Result EEPROM_ReadVariable(uint16_t VariableName, EEPROM_Value* Value)
+// Value:			outputs the variable value (from the shadow copy: zero-extended to 64 bit)
+// return:			EEPROM_SUCCESS, EEPROM_INVALID_NAME, EEPROM_NOT_ASSIGNED, EEPROM_CORRUPTED
+EEPROM_Result EEPROM_HandleReadVariable(EEPROM_Handle* Handle, uint16_t VariableName, EEPROM_Value* Value)
 {
 	//check if variable name exists
-	if (VariableName >= EEPROM_VARIABLE_COUNT) return EEPROM_INVALID_NAME;
+	if (VariableName >= EEPROM_NAME_LIMIT) return EEPROM_INVALID_NAME;
+
+#if EEPROM_CACHE_SIZE > 0
+	//return a dirty value from the write-back cache
+	for (uint8_t i = 0; i < Handle->CacheCount; i++)
+	{
+		if (Handle->CacheName[i] != VariableName) continue;
+		switch (Handle->CacheSize[i])
+		{
+			case EEPROM_SIZE8: (*Value).uInt8 = Handle->CacheValue[i].uInt8; break;
+			case EEPROM_SIZE16: (*Value).uInt16 = Handle->CacheValue[i].uInt16; break;
+			case EEPROM_SIZE32: (*Value).uInt32 = Handle->CacheValue[i].uInt32; break;
+			case EEPROM_SIZE64: (*Value).uInt64 = Handle->CacheValue[i].uInt64; break;
+			default: return EEPROM_NOT_ASSIGNED;
+		}
+		return EEPROM_SUCCESS;
+	}
+#endif
+
+	//find the entry of the variable in the address index
+	uint16_t Slot = EEPROM_SLOT(VariableName);
+	if (Slot == EEPROM_SLOT_NONE) return EEPROM_NOT_ASSIGNED;
+
+	//check the CRC of the record on the first read
+	EEPROM_Result result = EEPROM_VerifyRecord(Handle, Slot);
+	if (result != EEPROM_SUCCESS) return result;
+
+#if EEPROM_SHADOW
+	//read the variable from the shadow copy (one RAM load, counters included)
+	uint8_t Size = Handle->SizeTable[Slot];
+	if (Handle->Index[Slot] == 0 || Size == EEPROM_SIZE_BLOB) return EEPROM_NOT_ASSIGNED;
+	*Value = Handle->Shadow[Slot];
+	return EEPROM_SUCCESS;
+#else
+	//read the variable from flash
+	return EEPROM_ReadRecord(Handle, Slot, Value);
+#endif
+}
+
+
+// keeps the shadow copy of a variable in sync with its latest value (EEPROM_SHADOW)
+// page transfers don't change values, dirty values of the write-back cache are copied when they are written to the cache
+//
+// Slot:	entry of the variable in the address index (EEPROM_SLOT_NONE: a deleted variable without entry, nothing to do)
+// Value:	latest value of the variable
+// Size:	size of "Value" as EEPROM_Size (deleted and blob: 0, counter: 32 bit)
+static void EEPROM_SetShadow(EEPROM_Handle* Handle, uint16_t Slot, EEPROM_Value Value, EEPROM_Size Size)
+{
+#if EEPROM_SHADOW
+	if (Slot == EEPROM_SLOT_NONE) return;
+	uint64_t Mask = Size == EEPROM_SIZE64 ? ~0ull : Size == EEPROM_SIZE32 || Size == EEPROM_SIZE_COUNTER ? 0xFFFFFFFF : Size == EEPROM_SIZE16 ? 0xFFFF : Size == EEPROM_SIZE8 ? 0xFF : 0;
+	Handle->Shadow[Slot].uInt64 = Value.uInt64 & Mask;
+#endif
+}
+
+
+#if EEPROM_SPARSE_NAMES
+// returns the entry of a name in the address index, gives the name an entry if it has none (EEPROM_SPARSE_NAMES)
+// - probe the entries from the hash of the name on until the name or an unused entry is found
+// - remember the first entry without record on the way (of a deleted variable), it is taken over by the name
+//
+// VariableName:	name (number) of the variable
+// return:			entry of the variable, EEPROM_SLOT_NONE if all entries hold variables
+static uint16_t EEPROM_InsertSlot(EEPROM_Handle* Handle, uint16_t VariableName)
+{
+	uint16_t Slot = EEPROM_NAME_HASH(VariableName) % Handle->VariableCount;
+	uint16_t Free = EEPROM_SLOT_NONE;
+	for (uint16_t i = 0; i < Handle->VariableCount; i++)
+	{
+		if (Handle->Names[Slot] == VariableName) return Slot;
+		if (Free == EEPROM_SLOT_NONE && Handle->Index[Slot] == 0) Free = Slot;
+		if (Handle->Names[Slot] == EEPROM_SLOT_NONE) break;
+		if (++Slot == Handle->VariableCount) Slot = 0;
+	}
+	if (Free == EEPROM_SLOT_NONE) return EEPROM_SLOT_NONE;
+
+	//take over the entry (the CRC of a record of its former name may have been checked)
+	Handle->Names[Free] = VariableName;
+#if EEPROM_CRC == EEPROM_CRC_READ
+	Handle->Verified[Free / 8] &= ~(1 << (Free % 8));
+#endif
+	return Free;
+}
+#endif
+
 
+// reads the variable value stored in flash
+// - check if variable was assigned
+// - read variable value from physical address with right size (counter: base value plus ticks)
+//
+// Slot:	entry of the variable to read in the address index (EEPROM_SLOT_NONE: not assigned)
+// Value:	outputs the variable value
+// return:	EEPROM_SUCCESS, EEPROM_NOT_ASSIGNED (also for a blob)
+static EEPROM_Result EEPROM_ReadRecord(EEPROM_Handle* Handle, uint16_t Slot, EEPROM_Value* Value)
+{
 	//check if variable was assigned
-	uint32_t Address = EEPROM_START_ADDRESS + EEPROM_Index[VariableName];
-	if (Address == EEPROM_PAGE0) return EEPROM_NOT_ASSIGNED;
+	if (Slot == EEPROM_SLOT_NONE) return EEPROM_NOT_ASSIGNED;
+	uint32_t Address = Handle->StartAddress + Handle->Index[Slot];
+	if (Address == Handle->StartAddress) return EEPROM_NOT_ASSIGNED;
 
 	//read variable value from physical address with right size
-	switch (EEPROM_SizeTable[VariableName])
+	switch (Handle->SizeTable[Slot])
 	{
-		case EEPROM_SIZE16: (*Value).uInt16 = *((__IO uint16_t*) Address); break;
-		case EEPROM_SIZE32: (*Value).uInt32 = *((__IO uint32_t*) Address); break;
-		case EEPROM_SIZE64: (*Value).uInt64 = *((__IO uint32_t*) Address) | ((uint64_t) *((__IO uint32_t*) (Address + 4)) << 32); break;
+		case EEPROM_SIZE8: (*Value).uInt8 = (uint8_t) EEPROM_READ16(Address - 1); break;
+		case EEPROM_SIZE16: (*Value).uInt16 = EEPROM_READ16(Address); break;
+		case EEPROM_SIZE32: (*Value).uInt32 = EEPROM_READ32(Address); break;
+		case EEPROM_SIZE64: (*Value).uInt64 = EEPROM_READ32(Address) | ((uint64_t) EEPROM_READ32(Address + 4) << 32); break;
+		case EEPROM_SIZE_COUNTER: (*Value).uInt32 = EEPROM_CounterValue(Address, NULL); break;
 		default: return EEPROM_NOT_ASSIGNED;
 	}
 
@@ -129,90 +812,373 @@ EEPROM_Result EEPROM_ReadVariable(uint16_t VariableName, EEPROM_Value* Value)
 }
 
 
-// writes variable in EEPROM if page not full
+// writes variable in EEPROM (like EEPROM_UpdateVariable, but an unchanged value is reported as EEPROM_SUCCESS)
+//
+// VariableName:	name (number) of the variable to write
+// Value:			value to be written
+// Size:			size of "Value" as EEPROM_Size
+// return:			EEPROM_SUCCESS, EEPROM_INVALID_NAME, EEPROM_INVALID_SIZE, EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+EEPROM_Result EEPROM_HandleWriteVariable(EEPROM_Handle* Handle, uint16_t VariableName, EEPROM_Value Value, EEPROM_Size Size)
+{
+	EEPROM_Result result = EEPROM_HandleUpdateVariable(Handle, VariableName, Value, Size);
+	if (result == EEPROM_UNCHANGED) result = EEPROM_SUCCESS;
+	return result;
+}
+
+
+// writes variable in EEPROM, if its value or size changed
+// - check if variable name and size exist
+// - drain the ISR write queue (its writes are older)
+// - open transaction: write the variable as part of it, if changed (past the write-back cache)
+// - find a dirty value of the variable in the write-back cache
+// - skip the write if value and size are unchanged (compared to the dirty value or else to the record in flash)
+// - without write-back cache: write the variable to flash (and a due checkpoint)
+// - coalesce with the dirty value of the same variable, else add it to the cache (flush the cache first if it is full)
+// - flush the cache if the threshold of dirty values is reached or the flush period is over
+//
+// VariableName:	name (number) of the variable to write
+// Value:			value to be written
+// Size:			size of "Value" as EEPROM_Size (a changed size is always written)
+// return:			EEPROM_SUCCESS, EEPROM_UNCHANGED, EEPROM_INVALID_NAME, EEPROM_INVALID_SIZE, EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+EEPROM_Result EEPROM_HandleUpdateVariable(EEPROM_Handle* Handle, uint16_t VariableName, EEPROM_Value Value, EEPROM_Size Size)
+{
+	EEPROM_Result result = EEPROM_SUCCESS;
+
+	//check if variable name and size exist (blobs are written by EEPROM_WriteBlob)
+	if (VariableName >= EEPROM_NAME_LIMIT) return EEPROM_INVALID_NAME;
+	if (EEPROM_SIZE_INVALID(VariableName, Size)) return EEPROM_INVALID_SIZE;
+
+	//drain the ISR write queue (its writes are older)
+	result = EEPROM_DrainQueue(Handle);
+	if (result != EEPROM_SUCCESS) return result;
+	Handle->Writes++;
+#if EEPROM_STATS
+	uint32_t Timestamp = EEPROM_TIMESTAMP();
+#endif
+
+#if EEPROM_TRANSACTION_SIZE > 0
+	//open transaction: write the variable as part of it (past the write-back cache, it is empty since EEPROM_BeginTransaction)
+	if (Handle->TransactionOpen)
+	{
+		if (EEPROM_RecordUnchanged(Handle, EEPROM_SLOT(VariableName), Value, Size))
+		{
+			Handle->ElidedWrites++;
+			return EEPROM_UNCHANGED;
+		}
+		result = EEPROM_TransactionWrite(Handle, VariableName, Value, Size);
+#if EEPROM_STATS
+		EEPROM_WriteLatency(Handle, Timestamp);
+#endif
+		return result;
+	}
+#endif
+
+#if EEPROM_CACHE_SIZE == 0
+	//skip the write if value and size are unchanged
+	if (EEPROM_RecordUnchanged(Handle, EEPROM_SLOT(VariableName), Value, Size))
+	{
+		Handle->ElidedWrites++;
+		return EEPROM_UNCHANGED;
+	}
+
+	//without write-back cache: write the variable to flash (and a due checkpoint)
+	result = EEPROM_WriteRecord(Handle, VariableName, Value, Size, NULL);
+	if (result == EEPROM_SUCCESS) EEPROM_SetShadow(Handle, EEPROM_SLOT(VariableName), Value, Size);
+	if (result == EEPROM_SUCCESS) result = EEPROM_WriteCheckpoint(Handle);
+#else
+	//find a dirty value of the variable in the write-back cache
+	uint8_t i = 0;
+	while (i < Handle->CacheCount && Handle->CacheName[i] != VariableName) i++;
+
+	//skip the write if value and size are unchanged (compared to the dirty value or else to the record in flash)
+	uint8_t Unchanged;
+	if (i < Handle->CacheCount)
+	{
+		uint64_t Mask = Size == EEPROM_SIZE64 ? ~0ull : Size == EEPROM_SIZE32 ? 0xFFFFFFFF : Size == EEPROM_SIZE16 ? 0xFFFF : Size == EEPROM_SIZE8 ? 0xFF : 0;
+		Unchanged = Size == Handle->CacheSize[i] && ((Value.uInt64 ^ Handle->CacheValue[i].uInt64) & Mask) == 0;
+	}
+	else Unchanged = EEPROM_RecordUnchanged(Handle, EEPROM_SLOT(VariableName), Value, Size);
+	if (Unchanged)
+	{
+		Handle->ElidedWrites++;
+		return EEPROM_UNCHANGED;
+	}
+
+	EEPROM_Lock = 1;
+
+	//coalesce with the dirty value of the same variable, else add it to the cache (flush the cache first if it is full)
+	if (i == EEPROM_CACHE_SIZE)
+	{
+		result = EEPROM_FlushCache(Handle, 0);
+		i = Handle->CacheCount;
+	}
+	if (result == EEPROM_SUCCESS)
+	{
+		if (i == Handle->CacheCount)
+		{
+			if (Handle->CacheCount == 0) Handle->CacheTick = HAL_GetTick();
+			Handle->CacheName[i] = VariableName;
+			Handle->CacheCount++;
+		}
+		Handle->CacheValue[i] = Value;
+		Handle->CacheSize[i] = Size;
+		EEPROM_SetShadow(Handle, EEPROM_SLOT(VariableName), Value, Size);
+
+		//flush the cache if the threshold of dirty values is reached or the flush period is over
+		if (Handle->CacheCount >= EEPROM_CACHE_THRESHOLD || (EEPROM_CACHE_PERIOD != 0 && HAL_GetTick() - Handle->CacheTick >= EEPROM_CACHE_PERIOD))
+		{
+			result = EEPROM_FlushCache(Handle, 0);
+		}
+	}
+
+	EEPROM_Lock = 0;
+#endif
+
+#if EEPROM_STATS
+	EEPROM_WriteLatency(Handle, Timestamp);
+#endif
+	return result;
+}
+
+
+// compares a value with the variable record in flash (1, 2 or 4 halfword reads, inline record: its header)
+//
+// Slot:	entry of the variable to compare in the address index (EEPROM_SLOT_NONE: not assigned)
+// Value:	value to compare
+// Size:	size of "Value" as EEPROM_Size
+// return:	1 if size and value equal the record in flash (or the variable is deleted / not assigned and Size is EEPROM_SIZE_DELETED), else 0
+static uint8_t EEPROM_RecordUnchanged(EEPROM_Handle* Handle, uint16_t Slot, EEPROM_Value Value, EEPROM_Size Size)
+{
+	if (Slot == EEPROM_SLOT_NONE) return Size == EEPROM_SIZE_DELETED;
+	uint32_t Address = Handle->StartAddress + Handle->Index[Slot];
+	if (Size == EEPROM_SIZE_DELETED) return Address == Handle->StartAddress;
+	if (Address == Handle->StartAddress || Size != Handle->SizeTable[Slot]) return 0;
+
+	switch (Size)
+	{
+		case EEPROM_SIZE8: return (uint8_t) EEPROM_READ16(Address - 1) == Value.uInt8;
+		case EEPROM_SIZE16: return EEPROM_READ16(Address) == Value.uInt16;
+		case EEPROM_SIZE32: return EEPROM_READ32(Address) == Value.uInt32;
+		default: return EEPROM_READ32(Address) == (uint32_t) Value.uInt64 && EEPROM_READ32(Address + 4) == (uint32_t) (Value.uInt64 >> 32);
+	}
+}
+
+
+// returns the memory of the latest record of a variable (what a page transfer has to carry forward for it)
+//
+// Slot:	entry of the variable in the address index (must be assigned)
+// return:	memory in bytes (header, value and CRC, blob and counter: from the length or tick count in flash)
+static uint16_t EEPROM_RecordBytes(EEPROM_Handle* Handle, uint16_t Slot)
+{
+	uint32_t Address = Handle->StartAddress + Handle->Index[Slot];
+	if (Handle->SizeTable[Slot] == EEPROM_SIZE_BLOB) return EEPROM_BLOB_BYTES(EEPROM_READ16(Address));
+	if (Handle->SizeTable[Slot] == EEPROM_SIZE_COUNTER) return EEPROM_COUNTER_BYTES(EEPROM_READ16(Address) & ~EEPROM_COUNTER_FLAG);
+	return EEPROM_RECORD_BYTES(Handle->SizeTable[Slot]);
+}
+
+
+// writes variable record to flash if page not full
+// - find the entry of the variable in the address index (sparse names: take one for a new name)
+// - select the class of the variable
+// - wait for a running asynchronous page erase
 // - get writing page's end address
 // - calculate memory usage of variable
+// - reserve space for the variables a running page transfer still has to carry forward
 // - check if page full
+//		- emergency flush: no page transfer
+//		- finish a running page transfer first
+//		- if more than one erased page is left, continue on next erased page (no page transfer)
 //		- check if data is too much to store on one page
 //		- mark the target page as receiving
 //		- change next index to receiving page
 //		- write the variable to target page
-//		- do page transfer
+//		- do page transfer (only start it in incremental mode, the asynchronous erase keeps running after return)
 // - else (if enough space)
-//		- write variable value
-//		- create and write variable header (size and name)
-//		- update index & size table
+//		- create variable header (size and name, inline record: name and value)
+//		- write variable value (blob: its length, counter: tick count and base value) and the CRC of a variable record
+//		- burst: check the error flags before the header
+//		- write variable header
+//		- write blob data, CRC and commit halfword (counter: only CRC and commit halfword, the ticks stay erased)
+//		- burst: check the error flags before the record enters the index
+//		- update bytes left to carry forward by a running page transfer
+//		- update index & size table (and the live bytes of the pages)
 //		- update next index
 //
-// VariableName:	name (number) of the variable to write
+// VariableName:	name (number) of the variable to write (must exist)
 // Value:			value to be written
 // Size:			size of "Value" as EEPROM_Size
+// Data:			blob data (Size EEPROM_SIZE_BLOB, Value.uInt16 holds the length), else unused (counter: Value.uInt32 is the base value)
 // return:			EEPROM_SUCCESS, EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
-EEPROM_Result EEPROM_WriteVariable(uint16_t VariableName, EEPROM_Value Value, uint8_t Size)
+static EEPROM_Result EEPROM_WriteRecord(EEPROM_Handle* Handle, uint16_t VariableName, EEPROM_Value Value, EEPROM_Size Size, const uint8_t* Data)
 {
 	EEPROM_Result result;
 
+	//find the entry of the variable in the address index (sparse names: a variable without entry has no record to delete)
+	uint16_t Slot = EEPROM_SLOT(VariableName);
+#if EEPROM_SPARSE_NAMES
+	if (Slot == EEPROM_SLOT_NONE && Size == EEPROM_SIZE_DELETED) return EEPROM_SUCCESS;
+	if (Slot == EEPROM_SLOT_NONE) Slot = EEPROM_InsertSlot(Handle, VariableName);
+	if (Slot == EEPROM_SLOT_NONE) return EEPROM_FULL;
+#endif
+
+	//select the class of the variable (its pages are written)
+	EEPROM_SelectClass(Handle, EEPROM_NameClass(Handle, VariableName));
+
+	//wait for a running asynchronous page erase (flash can't be programmed meanwhile)
+	result = EEPROM_FinishErase(1);
+	if (result != EEPROM_SUCCESS) return result;
+
 	//get writing page's end address (prefer writing to receiving page)
-	EEPROM_Page WritingPage = EEPROM_ValidPage;
-	if (EEPROM_ReceivingPage != EEPROM_PAGE_NONE) WritingPage = EEPROM_ReceivingPage;
+	EEPROM_Page WritingPage = Handle->ActivePage;
+	if (Handle->ReceivingPage != EEPROM_PAGE_NONE) WritingPage = Handle->ReceivingPage;
 	if (WritingPage == EEPROM_PAGE_NONE) return EEPROM_NO_VALID_PAGE;
 	uint32_t PageEndAddress = WritingPage + FLASH_PAGE_SIZE;
 
 	//calculate memory usage of variable
-	uint8_t Bytes = 2 + (1 << Size);
-	if (Size == EEPROM_SIZE_DELETED) Bytes = 2;
+	uint16_t Bytes = EEPROM_RECORD_BYTES(Size);
+	if (Size == EEPROM_SIZE_BLOB) Bytes = EEPROM_BLOB_BYTES(Value.uInt16);
+	if (Size == EEPROM_SIZE_COUNTER) Bytes = EEPROM_COUNTER_BYTES(EEPROM_COUNTER_TICKS);
+
+	//reserve space for the variables a running page transfer still has to carry forward (except this variable)
+	//(source of the page transfer: page following the receiving page, or the oldest page for the next transfer)
+	uint32_t SourcePage = Handle->ValidPage;
+	if (Handle->ReceivingPage != EEPROM_PAGE_NONE) SourcePage = EEPROM_NextPage(Handle, Handle->ReceivingPage);
+	uint32_t StartAddress = SourcePage - Handle->StartAddress;
+	uint32_t EndAddress = SourcePage - Handle->StartAddress + FLASH_PAGE_SIZE;
+	uint8_t Carried = StartAddress < Handle->Index[Slot] && Handle->Index[Slot] < EndAddress;
+	uint16_t ReservedBytes = 0;
+	if (Handle->ReceivingPage != EEPROM_PAGE_NONE)
+	{
+		ReservedBytes = Handle->TransferBytes;
+		if (Carried) ReservedBytes -= EEPROM_RecordBytes(Handle, Slot);
+	}
 
 	//check if enough free space or page full
-	if (EEPROM_NextIndex == 0 || PageEndAddress - EEPROM_NextIndex < Bytes)
+	if (Handle->NextIndex == 0 || PageEndAddress - Handle->NextIndex < Bytes + ReservedBytes)
 	{
-		//check if data is too much to store on one page
-		uint16_t RequiredMemory = 2;
-		for (uint16_t i = 0; i < EEPROM_VARIABLE_COUNT; i++)
+#if EEPROM_CACHE_SIZE > 0
+		//emergency flush: only continue on a further erased page (no time for a page transfer)
+		if (EEPROM_Emergency && (Handle->ReceivingPage != EEPROM_PAGE_NONE || Handle->ErasedCount < 2)) return EEPROM_FULL;
+#endif
+
+		//finish a running page transfer first (then write to the page that became valid)
+		if (Handle->ReceivingPage != EEPROM_PAGE_NONE)
+		{
+			result = EEPROM_PageTransfer(Handle, EEPROM_TRANSFER_ALL);
+			if (result != EEPROM_SUCCESS && result != EEPROM_PENDING) return result;
+
+			return EEPROM_WriteRecord(Handle, VariableName, Value, Size, Data);
+		}
+
+		//if more than one erased page is left, continue on next erased page (the last one is kept for page transfers)
+		if (Handle->ErasedCount > 1)
 		{
-			if (i == VariableName) RequiredMemory += 2 + (1 << Size);
-			else if (EEPROM_SizeTable[i] != EEPROM_SIZE_DELETED) RequiredMemory += 2 + (1 << EEPROM_SizeTable[i]);
+			result = EEPROM_SetPageStatus(Handle, Handle->ErasedPage, EEPROM_VALID);
+			if (result != EEPROM_SUCCESS) return result;
+
+			Handle->NextIndex = Handle->ActivePage + EEPROM_PAGE_HEADER;
+			Handle->CheckpointRecords = EEPROM_CHECKPOINT_INTERVAL;
+			Handle->CheckpointSlots = 0;
+			return EEPROM_WriteRecord(Handle, VariableName, Value, Size, Data);
 		}
+
+		//check if data is too much to store on one page (new variable, variables carried forward from the oldest page and transfer marker)
+		Handle->TransferBytes = EEPROM_PageMemory(Handle, Handle->ValidPage) + 2;
+		uint16_t RequiredMemory = EEPROM_PAGE_HEADER + Bytes + Handle->TransferBytes;
+		if (Carried) RequiredMemory -= EEPROM_RecordBytes(Handle, Slot);
 		if (RequiredMemory > FLASH_PAGE_SIZE) return EEPROM_FULL;
 
 		//mark the empty page as receiving
-		result = EEPROM_SetPageStatus(EEPROM_ErasedPage, EEPROM_RECEIVING);
+		result = EEPROM_SetPageStatus(Handle, Handle->ErasedPage, EEPROM_RECEIVING);
 		if (result != EEPROM_SUCCESS) return result;
 
 		//change next index to receiving page
-		EEPROM_NextIndex = EEPROM_ReceivingPage + 2;
+		Handle->NextIndex = Handle->ReceivingPage + EEPROM_PAGE_HEADER;
+		Handle->CheckpointSlots = 0;
 
 		//write the variable to receiving page (by calling this function again)
-		result = EEPROM_WriteVariable(VariableName, Value, Size);
+		result = EEPROM_WriteRecord(Handle, VariableName, Value, Size, Data);
 		if (result != EEPROM_SUCCESS) return result;
 
-		//do page transfer
-		result = EEPROM_PageTransfer();
-		if (result != EEPROM_SUCCESS) return result;
+		//do page transfer (in incremental mode only start it, EEPROM_Poll carries the variables forward)
+		Handle->TransferName = EEPROM_FIRST_SLOT;
+		Handle->TransferMarked = 0;
+		if (!EEPROM_INCREMENTAL_TRANSFER)
+		{
+			result = EEPROM_PageTransfer(Handle, EEPROM_TRANSFER_ALL);
+			if (result != EEPROM_SUCCESS && result != EEPROM_PENDING) return result;
+		}
 	}
 
 	//else (if enough space)
 	else
 	{
-		//write variable value
-		if (Size != EEPROM_SIZE_DELETED)
+		//create variable header (size and name, inline record: name and value)
+		uint16_t VariableHeader = VariableName + (Size << 14);
+		if (Size == EEPROM_SIZE_BLOB || Size == EEPROM_SIZE_COUNTER) VariableHeader = VariableName | EEPROM_BLOB_HEADER;
+		if (Size == EEPROM_SIZE8) VariableHeader = EEPROM_INLINE_HEADER | (VariableName << 8) | Value.uInt8;
+		uint16_t Crc = EEPROM_CRC ? EEPROM_RecordCrc(VariableHeader, Value, Size, Data) : 0;
+
+		//write variable value (blob: its length, counter: tick count and base value, the header must not be written before it)
+		if (Size == EEPROM_SIZE_BLOB) result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Handle->NextIndex + 2, Value.uInt16);
+		else if (Size == EEPROM_SIZE_COUNTER)
+		{
+			result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Handle->NextIndex + 2, EEPROM_COUNTER_TICKS | EEPROM_COUNTER_FLAG);
+			if (result == EEPROM_SUCCESS) result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_WORD, Handle->NextIndex + 4, Value.uInt32);
+		}
+		else if (Size != EEPROM_SIZE_DELETED && Size != EEPROM_SIZE8) result = EEPROM_PROGRAM(Size, Handle->NextIndex + 2, Value.uInt64);
+		if (result == EEPROM_SUCCESS && EEPROM_CRC && (Size <= EEPROM_SIZE64 || Size == EEPROM_SIZE8)) result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Handle->NextIndex + Bytes - 2, Crc);
+		if (result == EEPROM_SUCCESS) result = EEPROM_CheckBurst();
+		if (result != EEPROM_SUCCESS) return result;
+
+		//write variable header
+		result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Handle->NextIndex, VariableHeader);
+		if (result != EEPROM_SUCCESS) return result;
+
+		//write blob data, CRC and commit halfword (EEPROM_PageToIndex ignores a blob or counter without commit halfword)
+		if (Size == EEPROM_SIZE_BLOB)
+		{
+			uint32_t Address = Handle->NextIndex + 4;
+			for (uint16_t i = 0; i < Value.uInt16; i += 2, Address += 2)
+			{
+				result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Address, EEPROM_BlobHalfword(Data, Value.uInt16, i));
+				if (result != EEPROM_SUCCESS) return result;
+			}
+		}
+		if (Size == EEPROM_SIZE_BLOB || Size == EEPROM_SIZE_COUNTER)
 		{
-			result = HAL_FLASH_Program(Size, EEPROM_NextIndex + 2, Value.uInt64);
+			if (EEPROM_CRC) result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Handle->NextIndex + Bytes - 4, Crc);
+			if (result == EEPROM_SUCCESS) result = EEPROM_CheckBurst();
+			if (result == EEPROM_SUCCESS) result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Handle->NextIndex + Bytes - 2, 0x0000);
 			if (result != EEPROM_SUCCESS) return result;
 		}
 
-		//create and write variable header (size and name)
-		uint16_t VariableHeader = VariableName + (Size << 14);
-		result = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, EEPROM_NextIndex, VariableHeader);
+		//burst: check the error flags of the record before it enters the index (a failed record is neither indexed nor
+		//counted, NextIndex stays on it and a page transfer carries the variable forward again)
+		result = EEPROM_CheckBurst();
 		if (result != EEPROM_SUCCESS) return result;
 
-		//update index & size table
-		EEPROM_Index[VariableName] = EEPROM_NextIndex + 2 - EEPROM_START_ADDRESS;
-		EEPROM_SizeTable[VariableName] = Size;
-		if (Size == EEPROM_SIZE_DELETED) EEPROM_Index[VariableName] = 0;
+		//update bytes left to carry forward by a running page transfer (old value on source page is outdated now)
+		if (Handle->ReceivingPage != EEPROM_PAGE_NONE && Carried) Handle->TransferBytes -= EEPROM_RecordBytes(Handle, Slot);
+
+		//update index & size table (and the live bytes of the pages of the old and the new record)
+		EEPROM_CountLive(Handle, Slot, -1);
+		Handle->Index[Slot] = Handle->NextIndex + 2 - Handle->StartAddress;
+		Handle->SizeTable[Slot] = Size;
+		if (Size == EEPROM_SIZE8) Handle->Index[Slot]--;
+		if (Size == EEPROM_SIZE_DELETED) Handle->Index[Slot] = 0;
+		EEPROM_CountLive(Handle, Slot, 1);
+#if EEPROM_CRC == EEPROM_CRC_READ
+		Handle->Verified[Slot / 8] &= ~(1 << (Slot % 8));
+#endif
 
 		//update next index
-		EEPROM_NextIndex += Bytes;
-		if (EEPROM_NextIndex >= PageEndAddress) EEPROM_NextIndex = 0;
+		Handle->NextIndex += Bytes;
+		if (Handle->NextIndex >= PageEndAddress) Handle->NextIndex = 0;
+		Handle->CheckpointRecords++;
+#if EEPROM_STATS
+		Handle->WrittenBytes += Bytes;
+#endif
 	}
 
 	return EEPROM_SUCCESS;
@@ -223,205 +1189,2518 @@ EEPROM_Result EEPROM_WriteVariable(uint16_t VariableName, EEPROM_Value Value, ui
 // - call write variable with size EEPROM_SIZE_DELETED
 //
 // VariableName:	name (number) of the variable to delete
-// return:			EEPROM_SUCCESS, EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
-EEPROM_Result EEPROM_DeleteVariable(uint16_t VariableName)
+// return:			EEPROM_SUCCESS, EEPROM_INVALID_NAME, EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+EEPROM_Result EEPROM_HandleDeleteVariable(EEPROM_Handle* Handle, uint16_t VariableName)
 {
-	return EEPROM_WriteVariable(VariableName, (EEPROM_Value) (uint16_t) 0, EEPROM_SIZE_DELETED);
+	return EEPROM_HandleWriteVariable(Handle, VariableName, (EEPROM_Value) (uint16_t) 0, EEPROM_SIZE_DELETED);
 }
 
 
-// transfers latest variable values from valid page to receiving page
-// - get start & end address of valid page (source)
-// - copy each variable
-//		- check if is stored on the source page
-//		- read variable value
-//		- write variable to receiving page
-// - erase source page
-// - mark receiving page as valid
+// writes several variables in EEPROM with one free space check (e.g. configuration restore or factory provisioning)
+// the changed variables are written back to back on one page (of each class), a page transfer needed for them is done once before
+// (a running page transfer is finished first), unchanged variables are skipped like in EEPROM_UpdateVariable
+// if a name occurs more than once, the last entry wins (the ISR write queue is drained before)
 //
-// return: EEPROM_SUCCESS, EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
-static EEPROM_Result EEPROM_PageTransfer()
+// Variables:	variables to write (name, size and value)
+// Count:		number of variables
+// return:		EEPROM_SUCCESS, EEPROM_INVALID_NAME / EEPROM_INVALID_SIZE (nothing written), EEPROM_NO_VALID_PAGE, EEPROM_FULL (batch doesn't fit on one page, sparse names: not enough free entries, nothing written), EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+EEPROM_Result EEPROM_HandleWriteVariables(EEPROM_Handle* Handle, const EEPROM_Variable* Variables, uint16_t Count)
 {
-	EEPROM_Result result;
-	EEPROM_Value Value;
-
-	//get start & end address of valid page (source) (as offset to EEPROM start)
-	uint16_t StartAddress = EEPROM_ValidPage - EEPROM_START_ADDRESS;
-	uint16_t EndAddress = EEPROM_ValidPage - EEPROM_START_ADDRESS + FLASH_PAGE_SIZE;
-
-	//copy each variable
-	for (uint16_t i = 0; i < EEPROM_VARIABLE_COUNT; i++)
-	{
-		//check if is stored on the source page
-		if (StartAddress < EEPROM_Index[i] && EEPROM_Index[i] < EndAddress)
-		{
-			//read variable value (if possible)
-			if (EEPROM_ReadVariable(i, &Value) == EEPROM_SUCCESS)
-			{
-				//write variable to receiving page
-				result = EEPROM_WriteVariable(i, Value, EEPROM_SizeTable[i]);
-				if (result != EEPROM_SUCCESS) return result;
-			}
-		}
-	}
-
-	//erase source page
-	result = EEPROM_SetPageStatus(EEPROM_ValidPage, EEPROM_ERASED);
+	EEPROM_Result result = EEPROM_DrainQueue(Handle);
 	if (result != EEPROM_SUCCESS) return result;
+	return EEPROM_WriteBatch(Handle, Variables, NULL, Count);
+}
 
-	//mark receiving page as valid
-	result = EEPROM_SetPageStatus(EEPROM_ReceivingPage, EEPROM_VALID);
-	if (result != EEPROM_SUCCESS) return result;
 
-	return EEPROM_SUCCESS;
+// marks several variables as deleted with one free space check (like EEPROM_WriteVariables)
+//
+// VariableNames:	names (numbers) of the variables to delete
+// Count:			number of variables
+// return:			EEPROM_SUCCESS, EEPROM_INVALID_NAME (nothing deleted), EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+EEPROM_Result EEPROM_HandleDeleteVariables(EEPROM_Handle* Handle, const uint16_t* VariableNames, uint16_t Count)
+{
+	EEPROM_Result result = EEPROM_DrainQueue(Handle);
+	if (result != EEPROM_SUCCESS) return result;
+	return EEPROM_WriteBatch(Handle, NULL, VariableNames, Count);
 }
 
 
-// sets the page status and updates references from global variables
-// - check if erase operation required
-//		- remove every variable from index, that is stored on erase page
-//		- setup erase definitions
-//		- erase page
-// - else write status to flash
-// - update global page status variables
+// writes a blob (byte string of variable length, e.g. a name, a serial number or a calibration table) in EEPROM, if it changed
+// the blob is a variable like any other: EEPROM_DeleteVariable deletes it, a write of a value replaces it
+// - check if variable name exists and the length is allowed
+// - drain the ISR write queue and flush the write-back cache (their writes are older than the blob)
+// - skip the write if length and data are unchanged
+// - write the blob to flash (and a due checkpoint)
 //
-// Page:		page to change the status (as EEPROM_Page)
-// PageStatus:	page status to set for page (as EEPROM_PageStatus)
-// return:		EEPROM_SUCCESS, EEPROM_ERROR, EEPROM_BUSY or EEPROM_TIMEOUT
-static EEPROM_Result EEPROM_SetPageStatus(EEPROM_Page Page, EEPROM_PageStatus PageStatus)
+// VariableName:	name (number) of the variable to write
+// Data:			data to be written
+// Length:			length of "Data" in bytes (at most EEPROM_BLOB_MAX_SIZE)
+// return:			EEPROM_SUCCESS, EEPROM_UNCHANGED, EEPROM_INVALID_NAME, EEPROM_INVALID_SIZE (also in a transaction), EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+EEPROM_Result EEPROM_HandleWriteBlob(EEPROM_Handle* Handle, uint16_t VariableName, const void* Data, uint16_t Length)
 {
-	EEPROM_Result result;
+	EEPROM_Result result = EEPROM_SUCCESS;
 
-	//check if erase operation required
-	if (PageStatus == EEPROM_ERASED)
-	{
-		//remove every variable from index, that is stored on erase page
-		uint16_t StartAddress = Page - EEPROM_START_ADDRESS;
-		uint16_t EndAddress = Page - EEPROM_START_ADDRESS + FLASH_PAGE_SIZE;
-		for (uint16_t i = 0; i < EEPROM_VARIABLE_COUNT; i++)
-		{
-			if (StartAddress < EEPROM_Index[i] && EEPROM_Index[i] < EndAddress) EEPROM_Index[i] = 0;
-		}
+	//check if variable name exists and the length is allowed (no blob in a transaction)
+	if (VariableName >= EEPROM_NAME_LIMIT) return EEPROM_INVALID_NAME;
+	if (Length > EEPROM_BLOB_MAX_SIZE) return EEPROM_INVALID_SIZE;
+#if EEPROM_TRANSACTION_SIZE > 0
+	if (Handle->TransactionOpen) return EEPROM_INVALID_SIZE;
+#endif
 
-		//setup erase definitions
-		FLASH_EraseInitTypeDef EraseDefinitions;
-		EraseDefinitions.TypeErase = FLASH_TYPEERASE_PAGES;
-		EraseDefinitions.Banks = FLASH_BANK_1;
-		EraseDefinitions.PageAddress = Page;
-		EraseDefinitions.NbPages = 1;
-		uint32_t PageError;
+	//drain the ISR write queue (its writes are older than the blob)
+	result = EEPROM_DrainQueue(Handle);
+	if (result != EEPROM_SUCCESS) return result;
+	Handle->Writes++;
+#if EEPROM_STATS
+	uint32_t Timestamp = EEPROM_TIMESTAMP();
+#endif
+
+#if EEPROM_CACHE_SIZE > 0
+	//flush the write-back cache (its dirty values are older than the blob)
+	EEPROM_Lock = 1;
+	result = EEPROM_FlushCache(Handle, 0);
+#endif
+
+	//skip the write if length and data are unchanged
+	if (result == EEPROM_SUCCESS && EEPROM_BlobUnchanged(Handle, EEPROM_SLOT(VariableName), Data, Length))
+	{
+		Handle->ElidedWrites++;
+		result = EEPROM_UNCHANGED;
+	}
 
-		//erase page
-		result = HAL_FLASHEx_Erase(&EraseDefinitions, &PageError);
-		if (result != EEPROM_SUCCESS) return result;
+	//write the blob to flash (and a due checkpoint)
+	else if (result == EEPROM_SUCCESS)
+	{
+		result = EEPROM_WriteRecord(Handle, VariableName, (EEPROM_Value) Length, EEPROM_SIZE_BLOB, Data);
+		if (result == EEPROM_SUCCESS) EEPROM_SetShadow(Handle, EEPROM_SLOT(VariableName), (EEPROM_Value) Length, EEPROM_SIZE_BLOB);
+		if (result == EEPROM_SUCCESS) result = EEPROM_WriteCheckpoint(Handle);
 	}
 
-	//else write status to flash
-	else
+#if EEPROM_CACHE_SIZE > 0
+	EEPROM_Lock = 0;
+#endif
+#if EEPROM_STATS
+	EEPROM_WriteLatency(Handle, Timestamp);
+#endif
+
+	return result;
+}
+
+
+// returns the last stored blob which correspond to the passed variable name (zero-copy: a pointer to the data in flash)
+// the data stays valid until the next library call which writes to flash (a page transfer moves the blob), copy it to keep it
+// - check if variable name exists
+// - a dirty value in the write-back cache replaced the blob
+// - check if the variable is a blob
+// - check the CRC of the record on the first read (EEPROM_CRC_READ)
+// - return length and data address
+//
+// VariableName:	name (number) of the variable to read
+// Data:			outputs the address of the data (not aligned to words)
+// Length:			outputs the length of the data in bytes
+// return:			EEPROM_SUCCESS, EEPROM_INVALID_NAME, EEPROM_NOT_ASSIGNED (also if the variable is not a blob), EEPROM_CORRUPTED
+EEPROM_Result EEPROM_HandleReadBlob(EEPROM_Handle* Handle, uint16_t VariableName, const uint8_t** Data, uint16_t* Length)
+{
+	//check if variable name exists
+	if (VariableName >= EEPROM_NAME_LIMIT) return EEPROM_INVALID_NAME;
+
+#if EEPROM_CACHE_SIZE > 0
+	//a dirty value in the write-back cache replaced the blob
+	for (uint8_t i = 0; i < Handle->CacheCount; i++)
 	{
-		result = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, Page, PageStatus);
-		if (result != EEPROM_SUCCESS) return result;
+		if (Handle->CacheName[i] == VariableName) return EEPROM_NOT_ASSIGNED;
 	}
+#endif
 
-	//update global page status variables (remove page from old status and attach to new status)
-	if (EEPROM_ValidPage == Page) EEPROM_ValidPage = EEPROM_PAGE_NONE;
-	else if (EEPROM_ReceivingPage == Page) EEPROM_ReceivingPage = EEPROM_PAGE_NONE;
-	else if (EEPROM_ErasedPage == Page) EEPROM_ErasedPage = EEPROM_PAGE_NONE;
+	//check if the variable is a blob
+	uint16_t Slot = EEPROM_SLOT(VariableName);
+	if (Slot == EEPROM_SLOT_NONE || Handle->Index[Slot] == 0 || Handle->SizeTable[Slot] != EEPROM_SIZE_BLOB) return EEPROM_NOT_ASSIGNED;
 
-	if (PageStatus == EEPROM_VALID) EEPROM_ValidPage = Page;
-	else if (PageStatus == EEPROM_RECEIVING) EEPROM_ReceivingPage = Page;
-	else if (PageStatus == EEPROM_ERASED) EEPROM_ErasedPage = Page;
+	//check the CRC of the record on the first read
+	EEPROM_Result result = EEPROM_VerifyRecord(Handle, Slot);
+	if (result != EEPROM_SUCCESS) return result;
 
+	//return length and data address
+	uint32_t Address = Handle->StartAddress + Handle->Index[Slot];
+	*Length = EEPROM_READ16(Address);
+	*Data = EEPROM_POINTER(Address + 2);
 	return EEPROM_SUCCESS;
 }
 
 
-// reads the whole page, fills the index with variable addresses and the size table with variable sizes
-// - declare variables
+// increments a counter (e.g. boot or event counter) by one, mostly without a new record
+// the counter is a variable read by EEPROM_ReadVariable as 32 bit value, a 16 or 32 bit value of the variable is its start value
+// - check if variable name exists
+// - drain the ISR write queue and flush the write-back cache (a queued or dirty value of the counter is its start value)
+// - increment the counter in flash
+//
+// VariableName:	name (number) of the counter
+// Value:			outputs the incremented counter value (can be NULL)
+// return:			EEPROM_SUCCESS, EEPROM_INVALID_NAME, EEPROM_INVALID_SIZE (in a transaction), EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+EEPROM_Result EEPROM_HandleIncrementCounter(EEPROM_Handle* Handle, uint16_t VariableName, uint32_t* Value)
+{
+	EEPROM_Result result = EEPROM_SUCCESS;
+	uint32_t Counter = 0;
+
+	//check if variable name exists (no counter in a transaction)
+	if (VariableName >= EEPROM_NAME_LIMIT) return EEPROM_INVALID_NAME;
+#if EEPROM_TRANSACTION_SIZE > 0
+	if (Handle->TransactionOpen) return EEPROM_INVALID_SIZE;
+#endif
+
+	//drain the ISR write queue (a queued value of the counter is its start value)
+	result = EEPROM_DrainQueue(Handle);
+	if (result != EEPROM_SUCCESS) return result;
+	Handle->Writes++;
+#if EEPROM_STATS
+	uint32_t Timestamp = EEPROM_TIMESTAMP();
+#endif
+
+#if EEPROM_CACHE_SIZE > 0
+	//flush the write-back cache (a dirty value of the counter is its start value)
+	EEPROM_Lock = 1;
+	result = EEPROM_FlushCache(Handle, 0);
+#endif
+
+	//increment the counter in flash
+	if (result == EEPROM_SUCCESS) result = EEPROM_CountRecord(Handle, VariableName, &Counter);
+
+#if EEPROM_CACHE_SIZE > 0
+	EEPROM_Lock = 0;
+#endif
+#if EEPROM_STATS
+	EEPROM_WriteLatency(Handle, Timestamp);
+#endif
+
+	if (result == EEPROM_SUCCESS && Value != NULL) *Value = Counter;
+	return result;
+}
+
+
+// returns a halfword of blob data as programmed to flash (little endian, an odd last byte padded with 0xFF)
+//
+// Data:	blob data
+// Length:	length of "Data" in bytes
+// Offset:	offset of the halfword in bytes (even)
+// return:	halfword
+static uint16_t EEPROM_BlobHalfword(const uint8_t* Data, uint16_t Length, uint16_t Offset)
+{
+	uint16_t Halfword = Data[Offset];
+	Halfword |= (Offset + 1 < Length ? Data[Offset + 1] : 0xFF) << 8;
+	return Halfword;
+}
+
+
+// compares a blob with the variable record in flash (halfword by halfword, stops at the first difference)
+//
+// Slot:	entry of the variable to compare in the address index (EEPROM_SLOT_NONE: not assigned)
+// Data:	blob data
+// Length:	length of "Data" in bytes
+// return:	1 if the variable is a blob with equal length and data, else 0
+static uint8_t EEPROM_BlobUnchanged(EEPROM_Handle* Handle, uint16_t Slot, const uint8_t* Data, uint16_t Length)
+{
+	if (Slot == EEPROM_SLOT_NONE) return 0;
+	uint32_t Address = Handle->StartAddress + Handle->Index[Slot];
+	if (Address == Handle->StartAddress || Handle->SizeTable[Slot] != EEPROM_SIZE_BLOB || EEPROM_READ16(Address) != Length) return 0;
+
+	for (uint16_t i = 0; i < Length; i += 2)
+	{
+		if (EEPROM_READ16(Address + 2 + i) != EEPROM_BlobHalfword(Data, Length, i)) return 0;
+	}
+	return 1;
+}
+
+
+// increments a counter in flash
+// - wait for a running asynchronous page erase
+// - get the counter value (and the used ticks of its counter record, start value of another variable)
+// - if a tick of the counter record is left, overwrite it with 0x0000
+// - else write a new counter record with the incremented value as base (and a due checkpoint)
+//
+// VariableName:	name (number) of the counter (must exist)
+// Value:			outputs the incremented counter value
+// return:			EEPROM_SUCCESS, EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+static EEPROM_Result EEPROM_CountRecord(EEPROM_Handle* Handle, uint16_t VariableName, uint32_t* Value)
+{
+	EEPROM_Result result;
+	EEPROM_Value Counter;
+
+	//wait for a running asynchronous page erase (flash can't be programmed meanwhile)
+	result = EEPROM_FinishErase(1);
+	if (result != EEPROM_SUCCESS) return result;
+
+	//get the counter value (and the used ticks of its counter record, start value of another variable)
+	uint16_t Slot = EEPROM_SLOT(VariableName);
+	uint32_t Address = Handle->StartAddress + (Slot != EEPROM_SLOT_NONE ? Handle->Index[Slot] : 0);
+	uint16_t Ticks = EEPROM_COUNTER_TICKS;
+	uint16_t UsedTicks = EEPROM_COUNTER_TICKS;
+	Counter.uInt32 = 0;
+	if (Address != Handle->StartAddress && Handle->SizeTable[Slot] == EEPROM_SIZE_COUNTER)
+	{
+		Ticks = EEPROM_READ16(Address) & ~EEPROM_COUNTER_FLAG;
+		Counter.uInt32 = EEPROM_CounterValue(Address, &UsedTicks);
+	}
+	else EEPROM_ReadRecord(Handle, Slot, &Counter);
+	Counter.uInt32++;
+	*Value = Counter.uInt32;
+
+	//if a tick of the counter record is left, overwrite it with 0x0000
+#if EEPROM_STATS
+	if (UsedTicks < Ticks) Handle->WrittenBytes += 2;
+#endif
+	if (UsedTicks < Ticks)
+	{
+		result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Address + 6 + 2 * UsedTicks, 0x0000);
+		if (result == EEPROM_SUCCESS) EEPROM_SetShadow(Handle, Slot, Counter, EEPROM_SIZE_COUNTER);
+		return result;
+	}
+
+	//else write a new counter record with the incremented value as base (and a due checkpoint)
+	result = EEPROM_WriteRecord(Handle, VariableName, Counter, EEPROM_SIZE_COUNTER, NULL);
+	if (result == EEPROM_SUCCESS) EEPROM_SetShadow(Handle, EEPROM_SLOT(VariableName), Counter, EEPROM_SIZE_COUNTER);
+	if (result == EEPROM_SUCCESS) result = EEPROM_WriteCheckpoint(Handle);
+	return result;
+}
+
+
+// reads the value of a counter record (binary search for the first erased tick, the ticks are overwritten in order)
+// a tick partly overwritten by an interrupted increment counts as used
+//
+// Address:	address of the counter record (tick count behind the header)
+// Ticks:	outputs the number of used ticks (can be NULL)
+// return:	counter value (base value plus used ticks)
+static uint32_t EEPROM_CounterValue(uint32_t Address, uint16_t* Ticks)
+{
+	uint16_t Low = 0;
+	uint16_t High = EEPROM_READ16(Address) & ~EEPROM_COUNTER_FLAG;
+	while (Low < High)
+	{
+		uint16_t Middle = (Low + High) / 2;
+		if (EEPROM_READ16(Address + 6 + 2 * Middle) != 0xFFFF) Low = Middle + 1;
+		else High = Middle;
+	}
+	if (Ticks != NULL) *Ticks = Low;
+	return EEPROM_READ32(Address + 2) + Low;
+}
+
+
+// writes a batch of variables or deletes
+// - check if variable names and sizes exist
+// - check if the address index has an entry for each new name (sparse names)
+// - open transaction: check if all entries fit into it, write the changed entries as part of it
+// - flush the write-back cache (its dirty values are older than the batch)
+// - write the records (class by class)
+//
+// Variables:		variables to write (NULL for deletes)
+// VariableNames:	names of the variables to delete (used if Variables is NULL)
+// Count:			number of entries
+// return:			EEPROM_SUCCESS, EEPROM_INVALID_NAME, EEPROM_INVALID_SIZE, EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+static EEPROM_Result EEPROM_WriteBatch(EEPROM_Handle* Handle, const EEPROM_Variable* Variables, const uint16_t* VariableNames, uint16_t Count)
+{
+	EEPROM_Result result = EEPROM_SUCCESS;
+
+	//check if variable names and sizes exist
+	for (uint16_t i = 0; i < Count; i++)
+	{
+		uint16_t Name = Variables != NULL ? Variables[i].Name : VariableNames[i];
+		if (Name >= EEPROM_NAME_LIMIT) return EEPROM_INVALID_NAME;
+		if (Variables != NULL && EEPROM_SIZE_INVALID(Name, Variables[i].Size)) return EEPROM_INVALID_SIZE;
+	}
+
+#if EEPROM_SPARSE_NAMES
+	//check if the address index has an entry for each new name (nothing written otherwise, a name twice in the batch is counted once)
+	if (Variables != NULL)
+	{
+		uint16_t NewNames = 0, FreeSlots = 0;
+		for (uint16_t i = 0; i < Count; i++)
+		{
+			uint16_t Earlier = 0;
+			while (Earlier < i && Variables[Earlier].Name != Variables[i].Name) Earlier++;
+			if (Earlier < i) continue;
+			uint16_t Slot = EEPROM_SLOT(Variables[i].Name);
+			if (Slot == EEPROM_SLOT_NONE || Handle->Index[Slot] == 0) NewNames++;
+		}
+		for (uint16_t i = 0; i < Handle->VariableCount && NewNames > 0; i++) FreeSlots += Handle->Index[i] == 0;
+		if (NewNames > FreeSlots) return EEPROM_FULL;
+	}
+#endif
+	Handle->Writes += Count;
+#if EEPROM_STATS
+	uint32_t Timestamp = EEPROM_TIMESTAMP();
+#endif
+
+#if EEPROM_TRANSACTION_SIZE > 0
+	//open transaction: write the changed entries as part of it (in order, a later entry of a name overwrites it),
+	//if all of them fit into it (nothing written otherwise)
+	if (Handle->TransactionOpen)
+	{
+		result = EEPROM_TransactionCheck(Handle, Variables, VariableNames, Count);
+		for (uint16_t i = 0; i < Count && result == EEPROM_SUCCESS; i++)
+		{
+			uint16_t Name = Variables != NULL ? Variables[i].Name : VariableNames[i];
+			EEPROM_Value Value = Variables != NULL ? Variables[i].Value : (EEPROM_Value) (uint16_t) 0;
+			EEPROM_Size Size = Variables != NULL ? Variables[i].Size : EEPROM_SIZE_DELETED;
+			if (EEPROM_RecordUnchanged(Handle, EEPROM_SLOT(Name), Value, Size)) Handle->ElidedWrites++;
+			else result = EEPROM_TransactionWrite(Handle, Name, Value, Size);
+		}
+#if EEPROM_STATS
+		EEPROM_WriteLatency(Handle, Timestamp);
+#endif
+		return result;
+	}
+#endif
+
+#if EEPROM_CACHE_SIZE > 0
+	//flush the write-back cache (its dirty values are older than the batch)
+	EEPROM_Lock = 1;
+	result = EEPROM_FlushCache(Handle, 0);
+#endif
+
+	//write the records (class by class, the records of a class back to back on its pages)
+	for (uint8_t i = 0; i < Handle->ClassCount && result == EEPROM_SUCCESS; i++)
+	{
+		EEPROM_SelectClass(Handle, i);
+		result = EEPROM_WriteRecords(Handle, Variables, VariableNames, Count);
+	}
+
+#if EEPROM_CACHE_SIZE > 0
+	EEPROM_Lock = 0;
+#endif
+#if EEPROM_STATS
+	EEPROM_WriteLatency(Handle, Timestamp);
+#endif
+
+	return result;
+}
+
+
+// writes the records of a batch back to back (the entries of the selected class)
+// - count the entries of the selected class
+// - wait for a running asynchronous page erase
+// - until the changed variables fit on the writing page
+//		- get writing page's end address and source page of the (running or next) page transfer
+//		- sum up the memory of the changed variables and of their records a page transfer doesn't have to carry forward anymore
+//		- check if the batch fits on the writing page (space for a running page transfer reserved)
+//		- finish a running page transfer first
+//		- if more than one erased page is left, continue on next erased page
+//		- check if data is too much to store on one page, mark the empty page as receiving
+// - write records (in one burst)
+// - do page transfer (only start it in incremental mode)
+// - write a due checkpoint
+//
+// Variables:		variables to write (NULL for deletes)
+// VariableNames:	names of the variables to delete (used if Variables is NULL)
+// Count:			number of entries
+// return:			EEPROM_SUCCESS, EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+static EEPROM_Result EEPROM_WriteRecords(EEPROM_Handle* Handle, const EEPROM_Variable* Variables, const uint16_t* VariableNames, uint16_t Count)
+{
+	EEPROM_Result result;
+	uint16_t Name;
+	EEPROM_Value Value;
+	EEPROM_Size Size;
+	uint8_t Transfer = 0;
+
+	//count the entries of the selected class
+	uint16_t Entries = 0;
+	for (uint16_t i = 0; i < Count; i++)
+	{
+		if (EEPROM_NameClass(Handle, Variables != NULL ? Variables[i].Name : VariableNames[i]) == Handle->Class) Entries++;
+	}
+
+	//wait for a running asynchronous page erase
+	result = EEPROM_FinishErase(1);
+	if (result != EEPROM_SUCCESS) return result;
+
+	//until the changed variables fit on the writing page
+	while (1)
+	{
+		//get writing page's end address and source page of the (running or next) page transfer
+		EEPROM_Page WritingPage = Handle->ActivePage;
+		if (Handle->ReceivingPage != EEPROM_PAGE_NONE) WritingPage = Handle->ReceivingPage;
+		if (WritingPage == EEPROM_PAGE_NONE) return EEPROM_NO_VALID_PAGE;
+		uint32_t PageEndAddress = WritingPage + FLASH_PAGE_SIZE;
+		uint32_t SourcePage = Handle->ValidPage;
+		if (Handle->ReceivingPage != EEPROM_PAGE_NONE) SourcePage = EEPROM_NextPage(Handle, Handle->ReceivingPage);
+		uint32_t StartAddress = SourcePage - Handle->StartAddress;
+		uint32_t EndAddress = SourcePage - Handle->StartAddress + FLASH_PAGE_SIZE;
+
+		//sum up the memory of the changed variables and of their records a page transfer doesn't have to carry forward anymore
+		uint16_t Bytes = 0;
+		uint16_t CarriedBytes = 0;
+		for (uint16_t i = 0; i < Count; i++)
+		{
+			if (!EEPROM_BatchEntry(Handle, Variables, VariableNames, Count, i, &Name, &Value, &Size)) continue;
+			Bytes += EEPROM_RECORD_BYTES(Size);
+			uint16_t Slot = EEPROM_SLOT(Name);
+			if (Slot != EEPROM_SLOT_NONE && StartAddress < Handle->Index[Slot] && Handle->Index[Slot] < EndAddress) CarriedBytes += EEPROM_RecordBytes(Handle, Slot);
+		}
+		if (Bytes == 0)
+		{
+			Handle->ElidedWrites += Entries;
+			return EEPROM_SUCCESS;
+		}
+		uint16_t RequiredMemory = EEPROM_PAGE_HEADER + Bytes;
+		if (RequiredMemory > FLASH_PAGE_SIZE) return EEPROM_FULL;
+
+		//check if the batch fits on the writing page (space for a running page transfer reserved)
+		uint16_t ReservedBytes = 0;
+		if (Handle->ReceivingPage != EEPROM_PAGE_NONE) ReservedBytes = Handle->TransferBytes - CarriedBytes;
+		if (Handle->NextIndex != 0 && PageEndAddress - Handle->NextIndex >= Bytes + ReservedBytes) break;
+
+		//finish a running page transfer first (then check again)
+		if (Handle->ReceivingPage != EEPROM_PAGE_NONE)
+		{
+			result = EEPROM_PageTransfer(Handle, EEPROM_TRANSFER_ALL);
+			if (result == EEPROM_PENDING) result = EEPROM_FinishErase(1);
+			if (result != EEPROM_SUCCESS) return result;
+			continue;
+		}
+
+		//if more than one erased page is left, continue on next erased page
+		if (Handle->ErasedCount > 1)
+		{
+			result = EEPROM_SetPageStatus(Handle, Handle->ErasedPage, EEPROM_VALID);
+			if (result != EEPROM_SUCCESS) return result;
+
+			Handle->NextIndex = Handle->ActivePage + EEPROM_PAGE_HEADER;
+			Handle->CheckpointRecords = EEPROM_CHECKPOINT_INTERVAL;
+			Handle->CheckpointSlots = 0;
+			continue;
+		}
+
+		//check if data is too much to store on one page (batch, variables carried forward from the oldest page and transfer marker)
+		Handle->TransferBytes = EEPROM_PageMemory(Handle, Handle->ValidPage) + 2;
+		RequiredMemory = EEPROM_PAGE_HEADER + Bytes + Handle->TransferBytes - CarriedBytes;
+		if (RequiredMemory > FLASH_PAGE_SIZE) return EEPROM_FULL;
+
+		//mark the empty page as receiving
+		result = EEPROM_SetPageStatus(Handle, Handle->ErasedPage, EEPROM_RECEIVING);
+		if (result != EEPROM_SUCCESS) return result;
+
+		Handle->NextIndex = Handle->ReceivingPage + EEPROM_PAGE_HEADER;
+		Handle->CheckpointSlots = 0;
+		Handle->TransferName = EEPROM_FIRST_SLOT;
+		Handle->TransferMarked = 0;
+		Transfer = 1;
+	}
+
+	//write records (in one burst)
+	uint16_t Written = 0;
+	uint8_t Burst = EEPROM_BeginBurst();
+	result = EEPROM_SUCCESS;
+	for (uint16_t i = 0; i < Count; i++)
+	{
+		if (!EEPROM_BatchEntry(Handle, Variables, VariableNames, Count, i, &Name, &Value, &Size)) continue;
+
+		result = EEPROM_WriteRecord(Handle, Name, Value, Size, NULL);
+		if (result != EEPROM_SUCCESS) break;
+		EEPROM_SetShadow(Handle, EEPROM_SLOT(Name), Value, Size);
+		Written++;
+	}
+	result = EEPROM_EndBurst(Burst, result);
+	if (result != EEPROM_SUCCESS) return result;
+	Handle->ElidedWrites += Entries - Written;
+
+	//do page transfer (in incremental mode only start it, EEPROM_Poll carries the variables forward)
+	if (Transfer && !EEPROM_INCREMENTAL_TRANSFER)
+	{
+		result = EEPROM_PageTransfer(Handle, EEPROM_TRANSFER_ALL);
+		if (result != EEPROM_SUCCESS && result != EEPROM_PENDING) return result;
+	}
+
+	//write a due checkpoint
+	return EEPROM_WriteCheckpoint(Handle);
+}
+
+
+// gets one batch entry and checks if it has to be written (of the selected class, not overwritten by a later entry, value or size changed)
+//
+// Variables:		variables to write (NULL for deletes)
+// VariableNames:	names of the variables to delete (used if Variables is NULL)
+// Count:			number of entries
+// Entry:			entry to get
+// VariableName:	outputs the name of the entry
+// Value:			outputs the value of the entry
+// Size:			outputs the size of the entry
+// return:			1 if the entry has to be written, else 0
+static uint8_t EEPROM_BatchEntry(EEPROM_Handle* Handle, const EEPROM_Variable* Variables, const uint16_t* VariableNames, uint16_t Count, uint16_t Entry, uint16_t* VariableName, EEPROM_Value* Value, EEPROM_Size* Size)
+{
+	*VariableName = Variables != NULL ? Variables[Entry].Name : VariableNames[Entry];
+	*Value = Variables != NULL ? Variables[Entry].Value : (EEPROM_Value) (uint16_t) 0;
+	*Size = Variables != NULL ? Variables[Entry].Size : EEPROM_SIZE_DELETED;
+	if (EEPROM_NameClass(Handle, *VariableName) != Handle->Class) return 0;
+
+	for (uint16_t i = Entry + 1; i < Count; i++)
+	{
+		if ((Variables != NULL ? Variables[i].Name : VariableNames[i]) == *VariableName) return 0;
+	}
+	return !EEPROM_RecordUnchanged(Handle, EEPROM_SLOT(*VariableName), *Value, *Size);
+}
+
+
+// continues a running page transfer (started by EEPROM_WriteVariable or EEPROM_Init in incremental mode),
+// drains the ISR write queue and flushes the write-back cache when its flush period is over
+// call it regularly, e.g. in idle time of the main loop, until it returns EEPROM_SUCCESS
+// reads and writes keep working while the page transfer is running
+// with asynchronous erase it returns EEPROM_PENDING until the erase of the old page is finished
+// with several classes the page transfers of the classes are continued in class order
+// pre-compaction (EEPROM_COMPACT_THRESHOLD) starts the page transfer of a class here, if the garbage share of its oldest page reached the threshold
+//
+// Budget:	maximum number of variables to carry forward in this call per class (the page erase takes one call on its own)
+// return:	EEPROM_SUCCESS (no page transfer running), EEPROM_PENDING, EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+EEPROM_Result EEPROM_HandlePoll(EEPROM_Handle* Handle, uint16_t Budget)
+{
+	EEPROM_Result result = EEPROM_DrainQueue(Handle);
+	if (result != EEPROM_SUCCESS) return result;
+
+#if EEPROM_CACHE_SIZE > 0
+	EEPROM_Lock = 1;
+	if (EEPROM_CACHE_PERIOD != 0 && Handle->CacheCount != 0 && HAL_GetTick() - Handle->CacheTick >= EEPROM_CACHE_PERIOD) result = EEPROM_FlushCache(Handle, 0);
+#endif
+
+	for (uint8_t i = 0; i < Handle->ClassCount && result == EEPROM_SUCCESS; i++)
+	{
+		EEPROM_SelectClass(Handle, i);
+#if EEPROM_COMPACT_THRESHOLD > 0
+		//pre-compaction: start the page transfer of the oldest page, if its garbage share reached the threshold and only the erased
+		//page kept for page transfers is left (not during a transaction)
+		uint8_t Compact = Handle->ReceivingPage == EEPROM_PAGE_NONE && Handle->ErasedCount == 1 && Handle->ValidPage != EEPROM_PAGE_NONE;
+#if EEPROM_TRANSACTION_SIZE > 0
+		if (Handle->TransactionOpen) Compact = 0;
+#endif
+		if (Compact && EEPROM_PageGarbage(Handle, Handle->ValidPage) * 100U >= EEPROM_COMPACT_THRESHOLD * (FLASH_PAGE_SIZE - EEPROM_PAGE_HEADER))
+		{
+			result = EEPROM_StartTransfer(Handle, 0);
+			if (result != EEPROM_SUCCESS) break;
+		}
+#endif
+		if (Handle->ReceivingPage != EEPROM_PAGE_NONE) result = EEPROM_PageTransfer(Handle, Budget);
+	}
+
+#if EEPROM_CACHE_SIZE > 0
+	EEPROM_Lock = 0;
+#endif
+
+	return result;
+}
+
+
+// compacts the pages in idle time (e.g. after a motor stop): the page transfer of the oldest page of each class is done now, if its
+// garbage share reached the threshold, so the following writes find free space instead of doing it in a latency-critical write
+// - check that no transaction is open
+// - drain the ISR write queue and flush the write-back cache
+// - for each class: finish a running page transfer, then start the page transfer of the oldest page, if its garbage share
+//   reached the threshold, and finish it (in incremental mode too, the erase of the old page is waited for)
+//
+// Threshold:	garbage share of the oldest page in percent (0: compact every class, 100: only a page without latest records)
+// return:		EEPROM_SUCCESS, EEPROM_BUSY (a transaction is open), EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_TIMEOUT
+EEPROM_Result EEPROM_HandleCompact(EEPROM_Handle* Handle, uint8_t Threshold)
+{
+	//check that no transaction is open
+#if EEPROM_TRANSACTION_SIZE > 0
+	if (Handle->TransactionOpen) return EEPROM_BUSY;
+#endif
+
+	//drain the ISR write queue and flush the write-back cache
+	EEPROM_Result result = EEPROM_HandleFlush(Handle);
+
+	//for each class: finish a running page transfer, then start the page transfer of the oldest page and finish it
+#if EEPROM_CACHE_SIZE > 0
+	EEPROM_Lock = 1;
+#endif
+	for (uint8_t i = 0; i < Handle->ClassCount && result == EEPROM_SUCCESS; i++)
+	{
+		uint8_t Started = 0;
+		EEPROM_SelectClass(Handle, i);
+		while (result == EEPROM_SUCCESS)
+		{
+			if (Handle->ReceivingPage != EEPROM_PAGE_NONE)
+			{
+				result = EEPROM_PageTransfer(Handle, EEPROM_TRANSFER_ALL);
+				if (result == EEPROM_PENDING) result = EEPROM_FinishErase(1);
+			}
+			else if (!Started && Handle->ErasedCount > 0 && Handle->ValidPage != EEPROM_PAGE_NONE && EEPROM_PageGarbage(Handle, Handle->ValidPage) * 100U >= Threshold * (FLASH_PAGE_SIZE - EEPROM_PAGE_HEADER))
+			{
+				result = EEPROM_StartTransfer(Handle, 1);
+				Started = 1;
+			}
+			else break;
+		}
+	}
+#if EEPROM_CACHE_SIZE > 0
+	EEPROM_Lock = 0;
+#endif
+
+	return result;
+}
+
+
+// returns the free space: bytes which can be written before a page transfer is needed (all classes, running count)
+// the erased part of the page written to (less the variables a running page transfer still has to write there) and the erased
+// pages but the last one (it is kept for page transfers), checkpoints take some of it
+//
+// return:	free space in bytes
+uint32_t EEPROM_HandleGetFreeSpace(EEPROM_Handle* Handle)
+{
+	uint32_t FreeSpace = 0;
+	for (uint8_t i = 0; i < Handle->ClassCount; i++)
+	{
+		EEPROM_SelectClass(Handle, i);
+		EEPROM_Page WritingPage = Handle->ActivePage;
+		if (Handle->ReceivingPage != EEPROM_PAGE_NONE) WritingPage = Handle->ReceivingPage;
+		uint32_t Free = WritingPage != EEPROM_PAGE_NONE && Handle->NextIndex != 0 ? WritingPage + FLASH_PAGE_SIZE - Handle->NextIndex : 0;
+		if (Handle->ReceivingPage != EEPROM_PAGE_NONE) Free = Free > Handle->TransferBytes ? Free - Handle->TransferBytes : 0;
+		if (Handle->ErasedCount > 1) Free += (Handle->ErasedCount - 1) * (FLASH_PAGE_SIZE - EEPROM_PAGE_HEADER);
+		FreeSpace += Free;
+	}
+	return FreeSpace;
+}
+
+
+// returns the write counters (since EEPROM_Init)
+//
+// Writes:			outputs the written variables (single and batch writes, deletes included)
+// ElidedWrites:	outputs the writes not programmed, because value and size did not change (or a later batch entry overwrote it)
+void EEPROM_HandleGetWriteCounters(EEPROM_Handle* Handle, uint32_t* Writes, uint32_t* ElidedWrites)
+{
+	*Writes = Handle->Writes;
+	*ElidedWrites = Handle->ElidedWrites;
+}
+
+
+// returns the runtime statistics (since EEPROM_Init, erase counts since the first format)
+// without EEPROM_STATS only write counters, queue statistics, page fill and live bytes are reported, the other fields are 0
+// - copy the counters
+// - calculate write amplification (programmed bytes per byte of the records and counter ticks the application wrote)
+// - get the fill of the page written to and sum up the latest records of all variables
+//
+// Stats:	outputs the statistics
+void EEPROM_HandleGetStats(EEPROM_Handle* Handle, EEPROM_Stats* Stats)
+{
+	//copy the counters
+	*Stats = (EEPROM_Stats) {0};
+	Stats->Writes = Handle->Writes;
+	Stats->ElidedWrites = Handle->ElidedWrites;
+#if EEPROM_QUEUE_SIZE > 0
+	Stats->QueueHighWater = Handle->QueueHighWater;
+	Stats->QueueOverflows = Handle->QueueOverflows;
+#endif
+#if EEPROM_STATS
+	Stats->HalfwordPrograms = Handle->HalfwordPrograms;
+	Stats->PageErases = Handle->PageErases;
+	Stats->PageTransfers = Handle->PageTransfers;
+	Stats->TransferBytes = Handle->CopiedBytes;
+	Stats->MaxWriteLatency = Handle->MaxWriteLatency;
+	for (uint8_t i = 0; i < Handle->PageCount; i++) Stats->EraseCounts[i] = Handle->EraseCounts[i];
+
+	//calculate write amplification
+	if (Handle->WrittenBytes > Handle->CopiedBytes) Stats->WriteAmplification = 2.0f * Handle->HalfwordPrograms / (Handle->WrittenBytes - Handle->CopiedBytes);
+#endif
+
+	//get the fill of the page written to and sum up the live bytes of all pages (the latest records of all variables)
+	EEPROM_Page WritingPage = Handle->ActivePage;
+	if (Handle->ReceivingPage != EEPROM_PAGE_NONE) WritingPage = Handle->ReceivingPage;
+	if (WritingPage != EEPROM_PAGE_NONE) Stats->PageFill = Handle->NextIndex == 0 ? FLASH_PAGE_SIZE : Handle->NextIndex - WritingPage;
+	for (uint8_t i = 0; i < Handle->PageCount; i++) Stats->LiveBytes += Handle->LiveBytes[i];
+}
+
+
+// writes all queued writes of the ISR write queue and all dirty values of the write-back cache to flash (e.g. before a planned reset)
+//
+// return:	EEPROM_SUCCESS, EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+EEPROM_Result EEPROM_HandleFlush(EEPROM_Handle* Handle)
+{
+	EEPROM_Result result = EEPROM_DrainQueue(Handle);
+#if EEPROM_CACHE_SIZE > 0
+	if (result != EEPROM_SUCCESS) return result;
+	EEPROM_Lock = 1;
+	result = EEPROM_FlushCache(Handle, 0);
+	EEPROM_Lock = 0;
+#endif
+	return result;
+}
+
+
+// writes the dirty values of the write-back cache to flash from a brown-out (PVD) interrupt handler
+// only fills the free space of the current pages, it never starts or finishes a page transfer (no time for an erase)
+// values which don't fit stay in the cache
+//
+// return:	EEPROM_SUCCESS, EEPROM_BUSY (interrupted a library call or a running erase), EEPROM_FULL (not every value fits), EEPROM_ERROR, EEPROM_TIMEOUT
+EEPROM_Result EEPROM_HandleEmergencyFlush(EEPROM_Handle* Handle)
+{
+#if EEPROM_CACHE_SIZE > 0
+	if (EEPROM_Lock || EEPROM_ErasingPage != EEPROM_PAGE_NONE) return EEPROM_BUSY;
+	return EEPROM_FlushCache(Handle, 1);
+#else
+	return EEPROM_SUCCESS;
+#endif
+}
+
+
+// queues a write from an interrupt handler or from a task other than the writer context (see EEPROM_QUEUE_SIZE)
+// never accesses the flash and never waits: the writer context writes the queued value with its next EEPROM_Poll, EEPROM_Flush or write
+// - check if variable name and size exist
+// - check for a full queue (reject the write or overwrite the oldest queued write)
+// - claim the entry, write name, size and value, then publish it
+// - update the high-water mark
+//
+// VariableName:	name (number) of the variable to write
+// Value:			value to be written
+// Size:			size of "Value" as EEPROM_Size (EEPROM_SIZE_DELETED queues a delete)
+// return:			EEPROM_SUCCESS, EEPROM_INVALID_NAME, EEPROM_INVALID_SIZE, EEPROM_FULL (queue full with EEPROM_QUEUE_REJECT, or no queue)
+EEPROM_Result EEPROM_HandleWriteVariableFromISR(EEPROM_Handle* Handle, uint16_t VariableName, EEPROM_Value Value, EEPROM_Size Size)
+{
+	//check if variable name and size exist (the writer context must not fail on a queued write)
+	if (VariableName >= EEPROM_NAME_LIMIT) return EEPROM_INVALID_NAME;
+	if (EEPROM_SIZE_INVALID(VariableName, Size)) return EEPROM_INVALID_SIZE;
+
+#if EEPROM_QUEUE_SIZE > 0
+	//check for a full queue (reject the write or overwrite the oldest queued write)
+	uint32_t Head = Handle->QueueHead;
+	uint32_t Queued = Head - Handle->QueueTail;
+	if (Queued >= EEPROM_QUEUE_SIZE)
+	{
+		Handle->QueueOverflows++;
+		if (EEPROM_QUEUE_OVERFLOW == EEPROM_QUEUE_REJECT) return EEPROM_FULL;
+		Queued = EEPROM_QUEUE_SIZE - 1;
+	}
+
+	//claim the entry, write name, size and value, then publish it (the writer context only copies published entries)
+	volatile EEPROM_Variable* Entry = &Handle->Queue[Head % EEPROM_QUEUE_SIZE];
+	Handle->QueueClaim = Head + 1;
+	__DMB();
+	Entry->Name = VariableName;
+	Entry->Size = Size;
+	Entry->Value.uInt64 = Value.uInt64;
+	__DMB();
+	Handle->QueueHead = Head + 1;
+
+	//update the high-water mark
+	if (Queued + 1 > Handle->QueueHighWater) Handle->QueueHighWater = Queued + 1;
+	return EEPROM_SUCCESS;
+#else
+	return EEPROM_FULL;
+#endif
+}
+
+
+// writes the queued writes of the ISR write queue to flash (in the writer context)
+// - hold the queued writes back while a transaction is open (they are not part of it, EEPROM_Commit drains them)
+// - copy the published entries (skip the entries already overwritten with EEPROM_QUEUE_OVERWRITE)
+// - drop the copies of entries the producer overwrote during the copy
+// - release the entries and write the copies as one batch (a name queued more than once is written once with its latest value)
+//
+// return:	EEPROM_SUCCESS, EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+static EEPROM_Result EEPROM_DrainQueue(EEPROM_Handle* Handle)
+{
+#if EEPROM_QUEUE_SIZE > 0
+	EEPROM_Variable Variables[EEPROM_QUEUE_SIZE];
+	uint32_t Tail = Handle->QueueTail;
+	uint32_t Head = Handle->QueueHead;
+	if (Head == Tail) return EEPROM_SUCCESS;
+#if EEPROM_TRANSACTION_SIZE > 0
+	if (Handle->TransactionOpen) return EEPROM_SUCCESS;
+#endif
+
+	//copy the published entries (skip the entries already overwritten with EEPROM_QUEUE_OVERWRITE)
+	if (Head - Tail > EEPROM_QUEUE_SIZE) Tail = Head - EEPROM_QUEUE_SIZE;
+	__DMB();
+	uint16_t Count = 0;
+	for (uint32_t i = Tail; i != Head; i++)
+	{
+		volatile EEPROM_Variable* Entry = &Handle->Queue[i % EEPROM_QUEUE_SIZE];
+		Variables[Count].Name = Entry->Name;
+		Variables[Count].Size = Entry->Size;
+		Variables[Count].Value.uInt64 = Entry->Value.uInt64;
+		Count++;
+	}
+	__DMB();
+
+	//drop the copies of entries the producer overwrote during the copy (write number i is overwritten by write number i + EEPROM_QUEUE_SIZE)
+	uint32_t Overwritten = Handle->QueueClaim - EEPROM_QUEUE_SIZE - Tail;
+	uint16_t First = 0;
+	if ((int32_t) Overwritten > 0) First = Overwritten < Count ? Overwritten : Count;
+
+	//release the entries and write the copies as one batch
+	Handle->QueueTail = Head;
+	if (First == Count) return EEPROM_SUCCESS;
+	return EEPROM_WriteBatch(Handle, &Variables[First], NULL, Count - First);
+#else
+	return EEPROM_SUCCESS;
+#endif
+}
+
+
+// starts a transaction: the following writes (EEPROM_WriteVariable, EEPROM_UpdateVariable, EEPROM_DeleteVariable and the batch
+// functions, variables of one class) are stored all or none by EEPROM_Commit (see EEPROM_TRANSACTION_SIZE)
+// - check that no transaction is open
+// - drain the ISR write queue and flush the write-back cache (their writes are older than the transaction)
+// - finish running page transfers (a record of the transaction must not replace a value the transfer still has to carry forward)
+// - open the transaction
+//
+// return:	EEPROM_SUCCESS, EEPROM_BUSY (a transaction is open), EEPROM_FULL (no transactions), EEPROM_NO_VALID_PAGE, EEPROM_ERROR, EEPROM_TIMEOUT
+EEPROM_Result EEPROM_HandleBeginTransaction(EEPROM_Handle* Handle)
+{
+#if EEPROM_TRANSACTION_SIZE > 0
+	//check that no transaction is open
+	if (Handle->TransactionOpen) return EEPROM_BUSY;
+
+	//drain the ISR write queue and flush the write-back cache
+	EEPROM_Result result = EEPROM_HandleFlush(Handle);
+
+	//finish running page transfers (the asynchronous erase of the source page may keep running)
+#if EEPROM_CACHE_SIZE > 0
+	EEPROM_Lock = 1;
+#endif
+	for (uint8_t i = 0; i < Handle->ClassCount && result == EEPROM_SUCCESS; i++)
+	{
+		EEPROM_SelectClass(Handle, i);
+		if (Handle->ReceivingPage != EEPROM_PAGE_NONE) result = EEPROM_PageTransfer(Handle, EEPROM_TRANSFER_ALL);
+		if (result == EEPROM_PENDING) result = EEPROM_SUCCESS;
+	}
+#if EEPROM_CACHE_SIZE > 0
+	EEPROM_Lock = 0;
+#endif
+	if (result != EEPROM_SUCCESS) return result;
+
+	//open the transaction
+	Handle->TransactionOpen = 1;
+	Handle->TransactionCount = 0;
+	Handle->TransactionHeader = 0;
+	Handle->TransactionResult = EEPROM_SUCCESS;
+	return EEPROM_SUCCESS;
+#else
+	return EEPROM_FULL;
+#endif
+}
+
+
+// commits the open transaction: its writes are stored from now on (a power loss before leaves the values from before the transaction)
+// - return the error of a write that aborted the transaction
+// - program the commit halfword in front of the records of the transaction (the only program of the commit)
+// - close the transaction
+// - write a due checkpoint and the writes the ISR write queue held back
+//
+// return:	EEPROM_SUCCESS (also if no transaction is open), the error of a write of the transaction (nothing of it was stored),
+//			EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+EEPROM_Result EEPROM_HandleCommit(EEPROM_Handle* Handle)
+{
+#if EEPROM_TRANSACTION_SIZE > 0
+	EEPROM_Result result = EEPROM_SUCCESS;
+	if (!Handle->TransactionOpen) return EEPROM_SUCCESS;
+
+	//return the error of a write that aborted the transaction (its records are dropped already)
+	if (Handle->TransactionResult != EEPROM_SUCCESS)
+	{
+		Handle->TransactionOpen = 0;
+		return Handle->TransactionResult;
+	}
+
+	//program the commit halfword in front of the records of the transaction (no record: nothing changed)
+	EEPROM_SelectClass(Handle, Handle->TransactionClass);
+	if (Handle->TransactionHeader != 0)
+	{
+		result = EEPROM_FinishErase(1);
+		if (result == EEPROM_SUCCESS) result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Handle->TransactionHeader, EEPROM_TRANSACTION_HEADER);
+		if (result != EEPROM_SUCCESS) EEPROM_DropTransaction(Handle, 1);
+	}
+
+	//close the transaction
+	Handle->TransactionOpen = 0;
+	Handle->TransactionCount = 0;
+	Handle->TransactionHeader = 0;
+	if (result != EEPROM_SUCCESS) return result;
+
+	//write a due checkpoint and the writes the ISR write queue held back
+	result = EEPROM_WriteCheckpoint(Handle);
+	if (result == EEPROM_SUCCESS) result = EEPROM_DrainQueue(Handle);
+	return result;
+#else
+	return EEPROM_SUCCESS;
+#endif
+}
+
+
+// aborts the open transaction: its writes are dropped, the variables keep their values from before the transaction
+// - drop the records of the transaction (aborted transaction header, index, size table and shadow copy restored)
+// - close the transaction
+// - write a due checkpoint and the writes the ISR write queue held back
+//
+// return:	EEPROM_SUCCESS (also if no transaction is open), EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+EEPROM_Result EEPROM_HandleAbortTransaction(EEPROM_Handle* Handle)
+{
+#if EEPROM_TRANSACTION_SIZE > 0
+	if (!Handle->TransactionOpen) return EEPROM_SUCCESS;
+
+	//drop the records of the transaction (the records are ignored by EEPROM_Init even if the aborted header is not written)
+	EEPROM_SelectClass(Handle, Handle->TransactionClass);
+	EEPROM_Result result = EEPROM_DropTransaction(Handle, 1);
+
+	//close the transaction
+	Handle->TransactionOpen = 0;
+	Handle->TransactionCount = 0;
+	if (result != EEPROM_SUCCESS) return result;
+
+	//write a due checkpoint and the writes the ISR write queue held back
+	result = EEPROM_WriteCheckpoint(Handle);
+	if (result == EEPROM_SUCCESS) result = EEPROM_DrainQueue(Handle);
+	return result;
+#else
+	return EEPROM_SUCCESS;
+#endif
+}
+
+
+#if EEPROM_TRANSACTION_SIZE > 0
+// checks if variables can be written as part of the open transaction (nothing of them is written otherwise, the transaction stays)
+// - return the error of a write that aborted the transaction before
+// - check the classes of the variables (the first variable of the transaction selects its class)
+// - check if the transaction has a place for each variable it didn't write before (a name twice counted once)
+//
+// Variables:		variables to write (NULL for deletes)
+// VariableNames:	names of the variables to delete (used if Variables is NULL)
+// Count:			number of entries
+// return:			EEPROM_SUCCESS, EEPROM_INVALID_NAME (another class), EEPROM_FULL (transaction full), the error of a write that aborted the transaction
+static EEPROM_Result EEPROM_TransactionCheck(EEPROM_Handle* Handle, const EEPROM_Variable* Variables, const uint16_t* VariableNames, uint16_t Count)
+{
+	//return the error of a write that aborted the transaction before
+	if (Handle->TransactionResult != EEPROM_SUCCESS) return Handle->TransactionResult;
+	if (Count == 0) return EEPROM_SUCCESS;
+
+	//check the classes of the variables
+	uint8_t Class = Handle->TransactionCount != 0 ? Handle->TransactionClass : EEPROM_NameClass(Handle, Variables != NULL ? Variables[0].Name : VariableNames[0]);
+	for (uint16_t i = 0; i < Count; i++)
+	{
+		if (EEPROM_NameClass(Handle, Variables != NULL ? Variables[i].Name : VariableNames[i]) != Class) return EEPROM_INVALID_NAME;
+	}
+
+	//check if the transaction has a place for each variable it didn't write before
+	uint16_t Places = Handle->TransactionCount;
+	for (uint16_t i = 0; i < Count; i++)
+	{
+		uint16_t Name = Variables != NULL ? Variables[i].Name : VariableNames[i];
+		uint16_t Earlier = 0;
+		while (Earlier < i && (Variables != NULL ? Variables[Earlier].Name : VariableNames[Earlier]) != Name) Earlier++;
+		uint8_t j = 0;
+		while (j < Handle->TransactionCount && Handle->Transaction[j].Name != Name) j++;
+		if (Earlier == i && j == Handle->TransactionCount) Places++;
+	}
+	return Places > EEPROM_TRANSACTION_SIZE ? EEPROM_FULL : EEPROM_SUCCESS;
+}
+
+
+// writes a variable as part of the open transaction
+// - check if the variable can be written as part of it (class, place in the transaction), return the error without aborting the transaction
+// - coalesce with the variable if the transaction wrote it before, else add it (index entry and size kept for an abort)
+// - write the record behind the commit halfword (reserved in front of the first record), if it fits on the writing page
+// - else write the transaction again on a page with enough space (behind a page transfer or on the next erased page)
+// - abort the transaction on an error of the write (the following writes of the transaction return the error too)
+//
+// VariableName:	name (number) of the variable to write (must exist)
+// Value:			value to be written
+// Size:			size of "Value" as EEPROM_Size (variable sizes or EEPROM_SIZE_DELETED)
+// return:			EEPROM_SUCCESS, EEPROM_INVALID_NAME (another class), EEPROM_NO_VALID_PAGE, EEPROM_FULL (transaction full or doesn't fit on a page),
+//					EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+static EEPROM_Result EEPROM_TransactionWrite(EEPROM_Handle* Handle, uint16_t VariableName, EEPROM_Value Value, EEPROM_Size Size)
+{
+	//check if the variable can be written as part of the transaction
+	EEPROM_Result result = EEPROM_TransactionCheck(Handle, NULL, &VariableName, 1);
+	if (result != EEPROM_SUCCESS) return result;
+	if (Handle->TransactionCount == 0) Handle->TransactionClass = EEPROM_NameClass(Handle, VariableName);
+	EEPROM_SelectClass(Handle, Handle->TransactionClass);
+
+	//coalesce with the variable if the transaction wrote it before, else add it
+	uint8_t i = 0;
+	while (i < Handle->TransactionCount && Handle->Transaction[i].Name != VariableName) i++;
+	if (i == Handle->TransactionCount)
+	{
+		uint16_t Slot = EEPROM_SLOT(VariableName);
+		Handle->TransactionIndex[i] = Slot != EEPROM_SLOT_NONE ? Handle->Index[Slot] : 0;
+		Handle->TransactionSize[i] = Slot != EEPROM_SLOT_NONE ? Handle->SizeTable[Slot] : EEPROM_SIZE_DELETED;
+		Handle->Transaction[i].Name = VariableName;
+		Handle->TransactionCount++;
+	}
+	Handle->Transaction[i].Value = Value;
+	Handle->Transaction[i].Size = Size;
+
+	//write the record behind the commit halfword, if both fit on the writing page (space for a running page transfer reserved)
+	EEPROM_Page WritingPage = Handle->ActivePage;
+	if (Handle->ReceivingPage != EEPROM_PAGE_NONE) WritingPage = Handle->ReceivingPage;
+	uint16_t Bytes = EEPROM_RECORD_BYTES(Size) + (Handle->TransactionHeader == 0 ? 2 : 0);
+	uint16_t ReservedBytes = Handle->ReceivingPage != EEPROM_PAGE_NONE ? Handle->TransferBytes : 0;
+	if (WritingPage == EEPROM_PAGE_NONE) result = EEPROM_NO_VALID_PAGE;
+	else if (Handle->NextIndex != 0 && WritingPage + FLASH_PAGE_SIZE - Handle->NextIndex >= Bytes + ReservedBytes)
+	{
+		if (Handle->TransactionHeader == 0) EEPROM_ReserveTransaction(Handle);
+		result = EEPROM_WriteRecord(Handle, VariableName, Value, Size, NULL);
+		if (result == EEPROM_SUCCESS) EEPROM_SetShadow(Handle, EEPROM_SLOT(VariableName), Value, Size);
+	}
+
+	//else write the transaction again on a page with enough space
+	else result = EEPROM_MoveTransaction(Handle);
+
+	//abort the transaction on an error of the write (the values from before the transaction stay)
+	if (result != EEPROM_SUCCESS)
+	{
+		EEPROM_DropTransaction(Handle, 1);
+		Handle->TransactionCount = 0;
+		Handle->TransactionResult = result;
+	}
+	return result;
+}
+
+
+// writes the open transaction again on a page with enough space (its next record doesn't fit on the writing page)
+// a page transfer must carry forward the values from before the transaction (the transaction might still be aborted),
+// so the records written so far are dropped first and written again behind the transferred values
+// - drop the records written so far (index restored)
+// - sum up the memory of the changed variables and the commit halfword
+// - until they fit on the writing page
+//		- finish a running page transfer
+//		- if more than one erased page is left, continue on next erased page
+//		- else check if the transaction fits next to the values to carry forward, mark the empty page as receiving and
+//		  do the page transfer (in incremental mode too)
+// - reserve the commit halfword and write the records (in one burst)
+//
+// return:	EEPROM_SUCCESS, EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+static EEPROM_Result EEPROM_MoveTransaction(EEPROM_Handle* Handle)
+{
+	uint8_t Transfer = 0;
+
+	//drop the records written so far
+	EEPROM_Result result = EEPROM_DropTransaction(Handle, 0);
+	if (result != EEPROM_SUCCESS) return result;
+
+	//sum up the memory of the changed variables and the commit halfword
+	uint16_t Bytes = 2;
+	for (uint8_t i = 0; i < Handle->TransactionCount; i++)
+	{
+		EEPROM_Variable* Variable = &Handle->Transaction[i];
+		if (!EEPROM_RecordUnchanged(Handle, EEPROM_SLOT(Variable->Name), Variable->Value, Variable->Size)) Bytes += EEPROM_RECORD_BYTES(Variable->Size);
+	}
+	uint16_t RequiredMemory = EEPROM_PAGE_HEADER + Bytes;
+	if (Bytes == 2) return EEPROM_SUCCESS;
+	if (RequiredMemory > FLASH_PAGE_SIZE) return EEPROM_FULL;
+
+	//wait for a running asynchronous page erase
+	result = EEPROM_FinishErase(1);
+	if (result != EEPROM_SUCCESS) return result;
+
+	//until they fit on the writing page
+	while (1)
+	{
+		EEPROM_Page WritingPage = Handle->ActivePage;
+		if (Handle->ReceivingPage != EEPROM_PAGE_NONE) WritingPage = Handle->ReceivingPage;
+		if (WritingPage == EEPROM_PAGE_NONE) return EEPROM_NO_VALID_PAGE;
+		uint16_t ReservedBytes = Handle->ReceivingPage != EEPROM_PAGE_NONE ? Handle->TransferBytes : 0;
+		if (Handle->NextIndex != 0 && WritingPage + FLASH_PAGE_SIZE - Handle->NextIndex >= Bytes + ReservedBytes) break;
+
+		//finish a running page transfer (then check again)
+		if (Handle->ReceivingPage != EEPROM_PAGE_NONE)
+		{
+			result = EEPROM_PageTransfer(Handle, EEPROM_TRANSFER_ALL);
+			if (result == EEPROM_PENDING) result = EEPROM_FinishErase(1);
+			if (result != EEPROM_SUCCESS) return result;
+			continue;
+		}
+
+		//if more than one erased page is left, continue on next erased page
+		if (Handle->ErasedCount > 1)
+		{
+			result = EEPROM_SetPageStatus(Handle, Handle->ErasedPage, EEPROM_VALID);
+			if (result != EEPROM_SUCCESS) return result;
+
+			Handle->NextIndex = Handle->ActivePage + EEPROM_PAGE_HEADER;
+			Handle->CheckpointRecords = EEPROM_CHECKPOINT_INTERVAL;
+			Handle->CheckpointSlots = 0;
+			continue;
+		}
+
+		//check if the transaction fits next to the values to carry forward (and the transfer marker, a checkpoint written by the transfer
+		//can still take the space: then the transaction doesn't fit)
+		Handle->TransferBytes = EEPROM_PageMemory(Handle, Handle->ValidPage) + 2;
+		RequiredMemory = EEPROM_PAGE_HEADER + Bytes + Handle->TransferBytes;
+		if (Transfer || RequiredMemory > FLASH_PAGE_SIZE) return EEPROM_FULL;
+
+		//mark the empty page as receiving and do the page transfer
+		result = EEPROM_SetPageStatus(Handle, Handle->ErasedPage, EEPROM_RECEIVING);
+		if (result != EEPROM_SUCCESS) return result;
+
+		Handle->NextIndex = Handle->ReceivingPage + EEPROM_PAGE_HEADER;
+		Handle->CheckpointSlots = 0;
+		Handle->TransferName = EEPROM_FIRST_SLOT;
+		Handle->TransferMarked = 0;
+		result = EEPROM_PageTransfer(Handle, EEPROM_TRANSFER_ALL);
+		if (result == EEPROM_PENDING) result = EEPROM_SUCCESS;
+		if (result != EEPROM_SUCCESS) return result;
+		Transfer = 1;
+	}
+
+	//reserve the commit halfword and write the records (in one burst)
+	EEPROM_ReserveTransaction(Handle);
+	uint8_t Burst = EEPROM_BeginBurst();
+	for (uint8_t i = 0; i < Handle->TransactionCount && result == EEPROM_SUCCESS; i++)
+	{
+		EEPROM_Variable* Variable = &Handle->Transaction[i];
+		if (EEPROM_RecordUnchanged(Handle, EEPROM_SLOT(Variable->Name), Variable->Value, Variable->Size)) continue;
+		result = EEPROM_WriteRecord(Handle, Variable->Name, Variable->Value, Variable->Size, NULL);
+		if (result == EEPROM_SUCCESS) EEPROM_SetShadow(Handle, EEPROM_SLOT(Variable->Name), Variable->Value, Variable->Size);
+	}
+	return EEPROM_EndBurst(Burst, result);
+}
+
+
+// reserves the commit halfword of the open transaction at the next index (left erased, the records of the transaction follow)
+// the index holds no record of the transaction yet: its entries are the ones an abort restores
+static void EEPROM_ReserveTransaction(EEPROM_Handle* Handle)
+{
+	Handle->TransactionHeader = Handle->NextIndex;
+	Handle->NextIndex += 2;
+	for (uint8_t i = 0; i < Handle->TransactionCount; i++)
+	{
+		uint16_t Slot = EEPROM_SLOT(Handle->Transaction[i].Name);
+		Handle->TransactionIndex[i] = Slot != EEPROM_SLOT_NONE ? Handle->Index[Slot] : 0;
+		Handle->TransactionSize[i] = Slot != EEPROM_SLOT_NONE ? Handle->SizeTable[Slot] : EEPROM_SIZE_DELETED;
+	}
+}
+
+
+// drops the records of the open transaction (abort, or before the transaction is written again on another page)
+// - program the aborted transaction header (EEPROM_PageToIndex skips the halfwords up to the next index)
+// - restore index entry and size of the variables (latest variable first, sparse names: a variable whose entry was taken over
+//   by a later variable of the transaction gets an entry again)
+// - restore the shadow copy
+//
+// Restore:	1: restore the shadow copy too (abort), 0: keep the values of the transaction in it (written again)
+// return:	EEPROM_SUCCESS, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT (the index is restored anyway, EEPROM_Init ignores records without commit)
+static EEPROM_Result EEPROM_DropTransaction(EEPROM_Handle* Handle, uint8_t Restore)
+{
+	EEPROM_Result result = EEPROM_SUCCESS;
+
+	if (Handle->TransactionHeader != 0)
+	{
+		//program the aborted transaction header (up to the end of the page, if the records filled it)
+		uint32_t EndAddress = Handle->NextIndex;
+		if (EndAddress == 0) EndAddress = (Handle->TransactionHeader & ~(FLASH_PAGE_SIZE - 1)) + FLASH_PAGE_SIZE;
+		result = EEPROM_FinishErase(1);
+		if (result == EEPROM_SUCCESS) result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Handle->TransactionHeader, EEPROM_TRANSACTION_HEADER | ((EndAddress - Handle->TransactionHeader) / 2));
+		Handle->TransactionHeader = 0;
+
+		//restore index entry and size of the variables
+		for (uint8_t i = Handle->TransactionCount; i > 0; i--)
+		{
+			uint16_t Slot = EEPROM_SLOT(Handle->Transaction[i - 1].Name);
+#if EEPROM_SPARSE_NAMES
+			if (Slot == EEPROM_SLOT_NONE && Handle->TransactionIndex[i - 1] != 0) Slot = EEPROM_InsertSlot(Handle, Handle->Transaction[i - 1].Name);
+#endif
+			if (Slot == EEPROM_SLOT_NONE) continue;
+			EEPROM_CountLive(Handle, Slot, -1);
+			Handle->Index[Slot] = Handle->TransactionIndex[i - 1];
+			Handle->SizeTable[Slot] = Handle->TransactionSize[i - 1];
+			EEPROM_CountLive(Handle, Slot, 1);
+#if EEPROM_CRC == EEPROM_CRC_READ
+			Handle->Verified[Slot / 8] &= ~(1 << (Slot % 8));
+#endif
+		}
+	}
+
+	//restore the shadow copy
+	for (uint8_t i = 0; i < Handle->TransactionCount && Restore; i++)
+	{
+		EEPROM_Value Value = {0};
+		uint16_t Slot = EEPROM_SLOT(Handle->Transaction[i].Name);
+		EEPROM_ReadRecord(Handle, Slot, &Value);
+		EEPROM_SetShadow(Handle, Slot, Value, Slot != EEPROM_SLOT_NONE && Handle->Index[Slot] != 0 ? Handle->SizeTable[Slot] : EEPROM_SIZE_DELETED);
+	}
+	return result;
+}
+#endif
+
+
+// transfers latest variable values from oldest valid page to receiving page (newer valid pages stay untouched)
+// the transfer can be split in several calls, EEPROM_TransferName keeps the next variable to check
+// - get source page (page following the receiving page) and check if it is still valid
+// - get start & end address of source page
+// - copy each variable (until budget is used up, in one burst)
+//		- check if is stored on the source page
+//		- check the CRC of the record (a corrupted record is not carried forward)
+//		- copy a blob straight from the source page
+//		- read variable value
+//		- write variable to receiving page
+// - write transfer marker and a checkpoint
+// - erase source page (if budget left)
+// - wait for the end of an asynchronous erase (only check, EEPROM_PENDING while running)
+// - mark receiving page as valid
+//
+// Budget:	maximum number of variables to copy
+// return:	EEPROM_SUCCESS, EEPROM_PENDING, EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+static EEPROM_Result EEPROM_PageTransfer(EEPROM_Handle* Handle, uint16_t Budget)
+{
+	EEPROM_Result result;
+	EEPROM_Value Value;
+
+	//get source page and check if it is still valid (not erased yet)
+	uint32_t SourcePage = EEPROM_NextPage(Handle, Handle->ReceivingPage);
+	if (Handle->ValidPage == SourcePage)
+	{
+		//get start & end address of source page (as offset to EEPROM start)
+		uint32_t StartAddress = SourcePage - Handle->StartAddress;
+		uint32_t EndAddress = SourcePage - Handle->StartAddress + FLASH_PAGE_SIZE;
+
+		//copy each variable (of the class, sparse names: each entry) in one burst
+		uint8_t Burst = EEPROM_BeginBurst();
+		result = EEPROM_SUCCESS;
+		for (; Handle->TransferName < EEPROM_END_SLOT; Handle->TransferName++)
+		{
+			//check if is stored on the source page
+			uint16_t i = Handle->TransferName;
+			if (StartAddress < Handle->Index[i] && Handle->Index[i] < EndAddress)
+			{
+				//stop if budget is used up
+				if (Budget == 0)
+				{
+					result = EEPROM_PENDING;
+					break;
+				}
+				Budget--;
+
+				//check the CRC of the record (a corrupted record is not carried forward, the variable is lost with the source page,
+				//its bytes are no longer reserved for the page transfer)
+				if (EEPROM_CRC && !EEPROM_RecordValid(Handle->StartAddress + EEPROM_HEADER_OFFSET(Handle->Index[i])))
+				{
+					Handle->TransferBytes -= EEPROM_RecordBytes(Handle, i);
+					continue;
+				}
+#if EEPROM_STATS
+				Handle->CopiedBytes += EEPROM_RecordBytes(Handle, i);
+#endif
+
+				//copy a blob straight from the source page (zero-copy read of its data)
+				if (Handle->SizeTable[i] == EEPROM_SIZE_BLOB)
+				{
+					uint32_t Address = Handle->StartAddress + Handle->Index[i];
+					result = EEPROM_WriteRecord(Handle, EEPROM_SLOT_NAME(i), (EEPROM_Value) (uint16_t) EEPROM_READ16(Address), EEPROM_SIZE_BLOB, EEPROM_POINTER(Address + 2));
+					if (result != EEPROM_SUCCESS) break;
+				}
+
+				//read variable value (if possible)
+				else if (EEPROM_ReadRecord(Handle, i, &Value) == EEPROM_SUCCESS)
+				{
+					//write variable to receiving page
+					result = EEPROM_WriteRecord(Handle, EEPROM_SLOT_NAME(i), Value, Handle->SizeTable[i], NULL);
+					if (result != EEPROM_SUCCESS) break;
+				}
+			}
+		}
+		result = EEPROM_EndBurst(Burst, result);
+		if (result != EEPROM_SUCCESS) return result;
+
+		//write transfer marker (EEPROM_Init erases the source page again, if a power loss interrupts its erase)
+		if (!Handle->TransferMarked)
+		{
+			if (Handle->NextIndex != 0)
+			{
+				result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Handle->NextIndex, EEPROM_TRANSFER_MARKER);
+				if (result != EEPROM_SUCCESS) return result;
+
+				Handle->NextIndex += 2;
+				if (Handle->NextIndex >= Handle->ReceivingPage + FLASH_PAGE_SIZE) Handle->NextIndex = 0;
+			}
+			Handle->TransferMarked = 1;
+			Handle->TransferBytes -= 2;
+
+			//write a checkpoint (the receiving page holds all variables of the source page now)
+			Handle->CheckpointRecords = EEPROM_CHECKPOINT_INTERVAL;
+			result = EEPROM_WriteCheckpoint(Handle);
+			if (result != EEPROM_SUCCESS) return result;
+		}
+
+		//erase source page (in an own call if budget is used up, not before the asynchronous erase of another class ended)
+		if (Budget == 0) return EEPROM_PENDING;
+		result = EEPROM_FinishErase(0);
+		if (result != EEPROM_SUCCESS) return result;
+		result = EEPROM_SetPageStatus(Handle, SourcePage, EEPROM_ERASED);
+		if (result != EEPROM_SUCCESS) return result;
+	}
+
+	//wait for the end of an asynchronous erase (the receiving page must not become valid before the source page is erased)
+	result = EEPROM_FinishErase(0);
+	if (result != EEPROM_SUCCESS) return result;
+
+	//mark receiving page as valid
+	result = EEPROM_SetPageStatus(Handle, Handle->ReceivingPage, EEPROM_VALID);
+	if (result != EEPROM_SUCCESS) return result;
+
+	return EEPROM_SUCCESS;
+}
+
+
+// returns the memory of the latest variable values stored on a page (what a page transfer has to carry forward)
+//
+// Page:	page to check (as EEPROM_Page, of the selected class)
+// return:	memory in bytes (records of the variables, running count of EEPROM_CountLive)
+static uint16_t EEPROM_PageMemory(EEPROM_Handle* Handle, EEPROM_Page Page)
+{
+	return Handle->LiveBytes[(Page - Handle->StartAddress) / FLASH_PAGE_SIZE];
+}
+
+
+// adds the latest record of a variable to the live bytes of its page or removes it (before its index entry changes)
+//
+// Slot:	entry of the variable in the address index (not assigned: nothing to do)
+// Sign:	1: add the record, -1: remove it
+static void EEPROM_CountLive(EEPROM_Handle* Handle, uint16_t Slot, int8_t Sign)
+{
+	if (Slot == EEPROM_SLOT_NONE || Handle->Index[Slot] == 0) return;
+	Handle->LiveBytes[Handle->Index[Slot] / FLASH_PAGE_SIZE] += Sign * EEPROM_RecordBytes(Handle, Slot);
+}
+
+
+// returns the garbage of a page: its used bytes not holding a latest record (outdated records, checkpoints, markers and unused end)
+//
+// Page:	page to check (as EEPROM_Page, of the selected class, valid)
+// return:	garbage in bytes (page header excluded, page written to: only its used part)
+static uint16_t EEPROM_PageGarbage(EEPROM_Handle* Handle, EEPROM_Page Page)
+{
+	uint16_t Used = FLASH_PAGE_SIZE - EEPROM_PAGE_HEADER;
+	if (Page == Handle->ActivePage && Handle->ReceivingPage == EEPROM_PAGE_NONE && Handle->NextIndex != 0) Used = Handle->NextIndex - Page - EEPROM_PAGE_HEADER;
+	return Used - EEPROM_PageMemory(Handle, Page);
+}
+
+
+// starts a page transfer of the oldest page (marks the next erased page as receiving, the transfer itself is done by EEPROM_PageTransfer)
+// - wait for (or check) the end of a running asynchronous page erase
+// - sum up the memory to carry forward (and the transfer marker)
+// - mark the next erased page as receiving
+// - change next index to receiving page
+//
+// Wait:	0: return EEPROM_PENDING while an asynchronous erase is running, 1: wait for its end
+// return:	EEPROM_SUCCESS, EEPROM_PENDING, EEPROM_NO_VALID_PAGE (no erased page), EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+static EEPROM_Result EEPROM_StartTransfer(EEPROM_Handle* Handle, uint8_t Wait)
+{
+	//wait for (or check) the end of a running asynchronous page erase
+	EEPROM_Result result = EEPROM_FinishErase(Wait);
+	if (result != EEPROM_SUCCESS) return result;
+	if (Handle->ErasedCount == 0 || Handle->ValidPage == EEPROM_PAGE_NONE) return EEPROM_NO_VALID_PAGE;
+
+	//sum up the memory to carry forward (and the transfer marker)
+	Handle->TransferBytes = EEPROM_PageMemory(Handle, Handle->ValidPage) + 2;
+
+	//mark the next erased page as receiving
+	result = EEPROM_SetPageStatus(Handle, Handle->ErasedPage, EEPROM_RECEIVING);
+	if (result != EEPROM_SUCCESS) return result;
+
+	//change next index to receiving page
+	Handle->NextIndex = Handle->ReceivingPage + EEPROM_PAGE_HEADER;
+	Handle->CheckpointSlots = 0;
+	Handle->TransferName = EEPROM_FIRST_SLOT;
+	Handle->TransferMarked = 0;
+	return EEPROM_SUCCESS;
+}
+
+
+// writes a checkpoint (snapshot of index and size table) to the newest page, if it is due
+// - check if checkpoints are on, a checkpoint is due and a slot of the page header is free
+// - no checkpoint while the index holds records of an open transaction (EEPROM_Commit writes it)
+// - check if the newest page holds all variables of a running page transfer (transfer marker written) and has enough space
+// - wait for a running asynchronous page erase
+// - write variable count and checkpoint header (in one burst with the addresses, size codes and names)
+// - write addresses and size codes of all variables (blobs and counters have size code 0 like a deleted variable, but an address)
+//   and with sparse names the names of all entries
+// - write the checkpoint address to the next slot of the page header (the checkpoint is used from now on)
+// - update next index
+//
+// return:	EEPROM_SUCCESS (also if no checkpoint was written), EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+static EEPROM_Result EEPROM_WriteCheckpoint(EEPROM_Handle* Handle)
+{
+#if EEPROM_CHECKPOINT_INTERVAL > 0
+	EEPROM_Result result;
+
+	//check if checkpoints are on, a checkpoint is due and a slot of the page header is free
+	if (Handle->CheckpointRecords < EEPROM_CHECKPOINT_INTERVAL || Handle->CheckpointSlots >= EEPROM_CHECKPOINT_SLOTS) return EEPROM_SUCCESS;
+
+	//no checkpoint while the index holds records of an open transaction (a checkpoint would make them valid without commit)
+#if EEPROM_TRANSACTION_SIZE > 0
+	if (Handle->TransactionHeader != 0) return EEPROM_SUCCESS;
+#endif
+
+	//check if the newest page holds all variables of a running page transfer and has enough space
+	//(a checkpoint before the transfer marker would point to the source page, which is erased without a further checkpoint)
+	EEPROM_Page WritingPage = Handle->ActivePage;
+	if (Handle->ReceivingPage != EEPROM_PAGE_NONE) WritingPage = Handle->ReceivingPage;
+	if (WritingPage == EEPROM_PAGE_NONE || (Handle->ReceivingPage != EEPROM_PAGE_NONE && !Handle->TransferMarked)) return EEPROM_SUCCESS;
+	if (Handle->NextIndex == 0 || WritingPage + FLASH_PAGE_SIZE - Handle->NextIndex < EEPROM_CHECKPOINT_BYTES(Handle->VariableCount)) return EEPROM_SUCCESS;
+
+	//wait for a running asynchronous page erase
+	result = EEPROM_FinishErase(1);
+	if (result != EEPROM_SUCCESS) return result;
+
+	//write variable count and checkpoint header (in one burst with the addresses, size codes and names)
+	uint8_t Burst = EEPROM_BeginBurst();
+	uint32_t Address = Handle->NextIndex;
+	result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Address + 2, Handle->VariableCount);
+	if (result == EEPROM_SUCCESS) result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Address, EEPROM_CHECKPOINT_HEADER);
+	Address += 4;
+
+	//write addresses and size codes of all variables (blobs, counters and inline records have size code 0 like a deleted variable, but an address)
+	for (uint16_t i = 0; i < Handle->VariableCount && result == EEPROM_SUCCESS; i++, Address += 2)
+	{
+		result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Address, Handle->Index[i]);
+	}
+	for (uint16_t i = 0; i < Handle->VariableCount && result == EEPROM_SUCCESS; i += 8, Address += 2)
+	{
+		uint16_t SizeCodes = 0;
+		for (uint16_t j = i; j < i + 8 && j < Handle->VariableCount; j++) SizeCodes |= (Handle->SizeTable[j] > EEPROM_SIZE64 ? EEPROM_SIZE_DELETED : Handle->SizeTable[j]) << (2 * (j - i));
+		result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Address, SizeCodes);
+	}
+#if EEPROM_SPARSE_NAMES
+	for (uint16_t i = 0; i < Handle->VariableCount && result == EEPROM_SUCCESS; i++, Address += 2)
+	{
+		result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Address, Handle->Names[i]);
+	}
+#endif
+	result = EEPROM_EndBurst(Burst, result);
+	if (result != EEPROM_SUCCESS) return result;
+
+	//write the checkpoint address to the next slot of the page header (after the burst, its error flags are checked before)
+	result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, WritingPage + 2 + 2 * Handle->CheckpointSlots, Handle->NextIndex - WritingPage);
+	if (result != EEPROM_SUCCESS) return result;
+	Handle->CheckpointSlots++;
+	Handle->CheckpointRecords = 0;
+
+	//update next index
+	Handle->NextIndex = Address;
+	if (Handle->NextIndex >= WritingPage + FLASH_PAGE_SIZE) Handle->NextIndex = 0;
+#endif
+
+	return EEPROM_SUCCESS;
+}
+
+
+#if EEPROM_CACHE_SIZE > 0
+// writes the dirty values of the write-back cache to flash (in order of their first write)
+// - write each dirty value, unless the record in flash already holds it (emergency: without page transfer, values which don't fit are kept)
+// - remove written values from the cache (emergency: only if every value was written, the interrupted code might read the cache)
+// - write a due checkpoint (not in an emergency)
+//
+// Emergency:	1: called by EEPROM_EmergencyFlush
+// return:		EEPROM_SUCCESS, EEPROM_NO_VALID_PAGE, EEPROM_FULL, EEPROM_ERROR, EEPROM_BUSY, EEPROM_TIMEOUT
+static EEPROM_Result EEPROM_FlushCache(EEPROM_Handle* Handle, uint8_t Emergency)
+{
+	EEPROM_Result result = EEPROM_SUCCESS;
+	uint8_t Written = 0;
+
+	//write each dirty value (sparse names: the shadow copy of a new name gets its entry now)
+	EEPROM_Emergency = Emergency;
+	for (uint8_t i = 0; i < Handle->CacheCount; i++)
+	{
+		EEPROM_Result WriteResult = EEPROM_SUCCESS;
+		if (EEPROM_RecordUnchanged(Handle, EEPROM_SLOT(Handle->CacheName[i]), Handle->CacheValue[i], Handle->CacheSize[i])) Handle->ElidedWrites++;
+		else WriteResult = EEPROM_WriteRecord(Handle, Handle->CacheName[i], Handle->CacheValue[i], Handle->CacheSize[i], NULL);
+		if (WriteResult == EEPROM_SUCCESS && EEPROM_SPARSE_NAMES) EEPROM_SetShadow(Handle, EEPROM_SLOT(Handle->CacheName[i]), Handle->CacheValue[i], Handle->CacheSize[i]);
+		if (WriteResult == EEPROM_SUCCESS) Written++;
+		else
+		{
+			result = WriteResult;
+			if (!Emergency) break;
+		}
+	}
+	EEPROM_Emergency = 0;
+
+	//remove written values from the cache (keep the order of the rest)
+	if (Emergency)
+	{
+		if (result == EEPROM_SUCCESS) Handle->CacheCount = 0;
+	}
+	else
+	{
+		for (uint8_t i = Written; i < Handle->CacheCount; i++)
+		{
+			Handle->CacheName[i - Written] = Handle->CacheName[i];
+			Handle->CacheValue[i - Written] = Handle->CacheValue[i];
+			Handle->CacheSize[i - Written] = Handle->CacheSize[i];
+		}
+		Handle->CacheCount -= Written;
+		Handle->CacheTick = HAL_GetTick();
+	}
+
+	//write a due checkpoint (not in an emergency)
+	if (!Emergency && result == EEPROM_SUCCESS) result = EEPROM_WriteCheckpoint(Handle);
+
+	return result;
+}
+#endif
+
+
+// sets the page status and updates references from global variables (page of the selected class)
+// - check if erase operation required
+//		- remove every variable from index, that is stored on erase page
+//		- erase page (asynchronous erase: only start it)
+// - else write status to flash
+// - update global page status variables (erased page must be the oldest page, receiving or valid page the next erased page)
+//
+// Page:		page to change the status (as EEPROM_Page)
+// PageStatus:	page status to set for page (as EEPROM_PageStatus)
+// return:		EEPROM_SUCCESS, EEPROM_ERROR, EEPROM_BUSY or EEPROM_TIMEOUT
+static EEPROM_Result EEPROM_SetPageStatus(EEPROM_Handle* Handle, EEPROM_Page Page, EEPROM_PageStatus PageStatus)
+{
+	EEPROM_Result result;
+
+	//check if erase operation required
+	if (PageStatus == EEPROM_ERASED)
+	{
+		//remove every variable from index, that is stored on erase page (only variables of the class are stored on it)
+		uint32_t StartAddress = Page - Handle->StartAddress;
+		uint32_t EndAddress = Page - Handle->StartAddress + FLASH_PAGE_SIZE;
+		for (uint16_t i = EEPROM_FIRST_SLOT; i < EEPROM_END_SLOT; i++)
+		{
+			if (StartAddress < Handle->Index[i] && Handle->Index[i] < EndAddress)
+			{
+				Handle->Index[i] = 0;
+				EEPROM_SetShadow(Handle, i, (EEPROM_Value) (uint16_t) 0, EEPROM_SIZE_DELETED);
+			}
+		}
+		Handle->LiveBytes[StartAddress / FLASH_PAGE_SIZE] = 0;
+
+		//erase page (asynchronous erase: only start it)
+		result = EEPROM_ErasePage(Handle, Page);
+		if (result != EEPROM_SUCCESS) return result;
+	}
+
+	//else write status to flash
+	else
+	{
+		result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Page, PageStatus);
+		if (result != EEPROM_SUCCESS) return result;
+	}
+
+	//update global page status variables (pages leave the log at the oldest page and join it after the newest page)
+	if (PageStatus == EEPROM_ERASED)
+	{
+		//oldest page erased: following page is the new oldest valid page (if it is not the receiving page)
+		Handle->ValidPage = EEPROM_PAGE_NONE;
+		if (Handle->ActivePage == Page) Handle->ActivePage = EEPROM_PAGE_NONE;
+		else Handle->ValidPage = EEPROM_NextPage(Handle, Page);
+
+		//page joins the erased pages (asynchronous erase: when EEPROM_FinishErase sees the end of the erase)
+		if (EEPROM_ErasingPage != Page && Handle->ErasedCount++ == 0) Handle->ErasedPage = Page;
+	}
+	else
+	{
+		//erased page taken: next erased page follows in ring order
+		if (Handle->ErasedPage == Page)
+		{
+			Handle->ErasedCount--;
+			Handle->ErasedPage = EEPROM_PAGE_NONE;
+			if (Handle->ErasedCount > 0) Handle->ErasedPage = EEPROM_NextPage(Handle, Page);
+		}
+
+		if (PageStatus == EEPROM_RECEIVING)
+		{
+			Handle->ReceivingPage = Page;
+#if EEPROM_STATS
+			Handle->PageTransfers++;
+#endif
+		}
+		else
+		{
+			if (Handle->ReceivingPage == Page) Handle->ReceivingPage = EEPROM_PAGE_NONE;
+			if (Handle->ValidPage == EEPROM_PAGE_NONE) Handle->ValidPage = Page;
+			Handle->ActivePage = Page;
+		}
+	}
+
+	return EEPROM_SUCCESS;
+}
+
+
+// erases a page (asynchronous erase: only starts the erase, EEPROM_FinishErase completes it)
+// - setup erase definitions
+// - leave program mode of a running burst
+// - erase page and count the erase, or start interrupt driven erase
+//
+// Page:	page to erase (as EEPROM_Page)
+// return:	EEPROM_SUCCESS, EEPROM_ERROR, EEPROM_BUSY or EEPROM_TIMEOUT
+static EEPROM_Result EEPROM_ErasePage(EEPROM_Handle* Handle, EEPROM_Page Page)
+{
+	EEPROM_Result result;
+
+	//setup erase definitions
+	FLASH_EraseInitTypeDef EraseDefinitions;
+	EraseDefinitions.TypeErase = FLASH_TYPEERASE_PAGES;
+	EraseDefinitions.Banks = EEPROM_FLASH_BANK(Page);
+	EraseDefinitions.PageAddress = Page;
+	EraseDefinitions.NbPages = 1;
+
+#if EEPROM_BURST_PROGRAM
+	//leave program mode of a running burst (the flash can't erase meanwhile)
+	EEPROM_PauseBurst();
+#endif
+
+#if EEPROM_ASYNC_ERASE
+	//start interrupt driven erase (the flash interrupt calls HAL_FLASH_EndOfOperationCallback at the end)
+	EEPROM_EraseResult = EEPROM_PENDING;
+	EEPROM_ErasingPage = Page;
+	EEPROM_ErasingHandle = Handle;
+	result = HAL_FLASHEx_Erase_IT(&EraseDefinitions);
+	if (result != EEPROM_SUCCESS) EEPROM_ErasingPage = EEPROM_PAGE_NONE;
+#else
+	//erase page
+	uint32_t PageError;
+	result = HAL_FLASHEx_Erase(&EraseDefinitions, &PageError);
+	if (result == EEPROM_SUCCESS) result = EEPROM_CountErase(Handle, Page);
+#endif
+
+	return result;
+}
+
+
+// finishes a running asynchronous page erase (of any instance, the flash runs one erase at a time)
+// - check if an erase is running
+// - wait for the flash interrupt to report the end of the erase (if not waiting, return while running)
+// - if the erase failed, start it again (if that fails too, the page stays the erasing page, so the next call starts it again)
+// - count the erase, erased page joins the erased pages of its class
+//
+// Wait:	0: return EEPROM_PENDING while the erase is running, 1: wait for the end of the erase
+// return:	EEPROM_SUCCESS, EEPROM_PENDING, EEPROM_ERROR, EEPROM_BUSY or EEPROM_TIMEOUT
+static EEPROM_Result EEPROM_FinishErase(uint8_t Wait)
+{
+	//check if an erase is running
+	if (EEPROM_ErasingPage == EEPROM_PAGE_NONE) return EEPROM_SUCCESS;
+
+	//wait for the flash interrupt to report the end of the erase
+	if (!Wait && EEPROM_EraseResult == EEPROM_PENDING) return EEPROM_PENDING;
+	uint32_t Tick = HAL_GetTick();
+	while (EEPROM_EraseResult == EEPROM_PENDING)
+	{
+		if (HAL_GetTick() - Tick > EEPROM_ERASE_TIMEOUT) return EEPROM_TIMEOUT;
+	}
+
+	//if the erase failed, start it again
+	EEPROM_Handle* Handle = EEPROM_ErasingHandle;
+	if (EEPROM_EraseResult != EEPROM_SUCCESS)
+	{
+		EEPROM_Page Page = EEPROM_ErasingPage;
+		EEPROM_Result result = EEPROM_ErasePage(Handle, Page);
+		if (result == EEPROM_SUCCESS) return EEPROM_ERROR;
+		EEPROM_ErasingPage = Page;
+		EEPROM_EraseResult = EEPROM_ERROR;
+		return result;
+	}
+
+	//count the erase, erased page joins the erased pages of its class (of the instance which started the erase, its selected class stays selected)
+	EEPROM_Result result = EEPROM_CountErase(Handle, EEPROM_ErasingPage);
+	if (result != EEPROM_SUCCESS) return result;
+	uint8_t Class = Handle->Class;
+	EEPROM_SelectClass(Handle, EEPROM_PageClass(Handle, EEPROM_ErasingPage));
+	if (Handle->ErasedCount++ == 0) Handle->ErasedPage = EEPROM_ErasingPage;
+	EEPROM_SelectClass(Handle, Class);
+	EEPROM_ErasingPage = EEPROM_PAGE_NONE;
+
+	return EEPROM_SUCCESS;
+}
+
+
+#if EEPROM_ASYNC_ERASE
+// HAL flash interrupt callbacks: report the end of an asynchronous erase (ReturnValue 0xFFFFFFFF: all pages erased)
+void HAL_FLASH_EndOfOperationCallback(uint32_t ReturnValue)
+{
+	if (EEPROM_ErasingPage != EEPROM_PAGE_NONE && ReturnValue == 0xFFFFFFFF) EEPROM_EraseResult = EEPROM_SUCCESS;
+}
+
+void HAL_FLASH_OperationErrorCallback(uint32_t ReturnValue)
+{
+	if (EEPROM_ErasingPage != EEPROM_PAGE_NONE) EEPROM_EraseResult = EEPROM_ERROR;
+}
+#endif
+
+
+// starts a burst: the following programming of the library call is written back to back in program mode (see EEPROM_BURST_PROGRAM)
+// a burst started while another one is running becomes part of it
+//
+// return:	1 if the burst was started (the caller ends it with EEPROM_EndBurst), else 0 (burst running or burst programming off)
+static uint8_t EEPROM_BeginBurst(void)
+{
+#if EEPROM_BURST_PROGRAM
+	if (EEPROM_Burst != 0) return 0;
+	EEPROM_Burst = 1;
+	EEPROM_BurstResult = EEPROM_SUCCESS;
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+
+// ends a burst: leaves program mode and checks the error flags of all halfwords written in the burst once
+// a record of the burst is already checked before it enters the index (EEPROM_CheckBurst), an error found here belongs to a
+// halfword written after the last record (e.g. a transfer marker or checkpoint)
+//
+// Started:	return value of EEPROM_BeginBurst (0: the burst is part of another one and keeps running, the flags are checked anyway,
+//			so the caller can write a transfer marker or checkpoint slot after it)
+// result:	result of the programming of the caller
+// return:	result, if it isn't EEPROM_SUCCESS, else EEPROM_SUCCESS or EEPROM_ERROR (error flag set)
+static EEPROM_Result EEPROM_EndBurst(uint8_t Started, EEPROM_Result result)
+{
+#if EEPROM_BURST_PROGRAM
+	EEPROM_PauseBurst();
+	if (result == EEPROM_SUCCESS) result = EEPROM_BurstResult;
+	if (Started) EEPROM_Burst = 0;
+#endif
+	return result;
+}
+
+
+#if EEPROM_BURST_PROGRAM
+// leaves program mode of a running burst (before an erase or a change of the bank), its next halfword enters it again
+static void EEPROM_PauseBurst(void)
+{
+	if (EEPROM_Burst != 2) return;
+	EEPROM_Result result = EEPROM_BURST_END(EEPROM_BurstAddress);
+	if (EEPROM_BurstResult == EEPROM_SUCCESS) EEPROM_BurstResult = result;
+	EEPROM_Burst = 1;
+}
+#endif
+
+
+// checks the error flags of a running burst before a record is committed (its header or commit halfword is written) and indexed
+// the burst leaves program mode on an error (its flags are cleared), so the caller can stop like after a failed HAL_FLASH_Program
+//
+// return:	EEPROM_SUCCESS (no error flag or no burst in program mode) or EEPROM_ERROR (error flag set, also of a paused part of the burst)
+static EEPROM_Result EEPROM_CheckBurst(void)
+{
+#if EEPROM_BURST_PROGRAM
+	if (EEPROM_Burst == 2 && EEPROM_BURST_CHECK(EEPROM_BurstAddress) != HAL_OK) EEPROM_PauseBurst();
+	if (EEPROM_BurstResult != EEPROM_SUCCESS) return EEPROM_ERROR;
+#endif
+	return EEPROM_SUCCESS;
+}
+
+
+#if EEPROM_BURST_PROGRAM
+// programs a halfword, word or double word (with HAL_FLASH_Program, during a burst halfword by halfword in program mode)
+// - no burst: program with HAL_FLASH_Program
+// - leave program mode if the address is in another bank
+// - enter program mode with the first halfword
+// - write the halfwords
+//
+// TypeProgram:	FLASH_TYPEPROGRAM_HALFWORD, FLASH_TYPEPROGRAM_WORD or FLASH_TYPEPROGRAM_DOUBLEWORD
+// Address:		address to program
+// Data:		data to program
+// return:		EEPROM_SUCCESS, EEPROM_ERROR, EEPROM_BUSY or EEPROM_TIMEOUT (during a burst errors of the flags are returned by EEPROM_EndBurst)
+static EEPROM_Result EEPROM_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+	EEPROM_Result result;
+
+	//no burst: program with HAL_FLASH_Program
+	if (EEPROM_Burst == 0) return HAL_FLASH_Program(TypeProgram, Address, Data);
+
+	//leave program mode if the address is in another bank (e.g. page status of a page in the other bank)
+	if (EEPROM_Burst == 2 && EEPROM_FLASH_BANK(Address) != EEPROM_FLASH_BANK(EEPROM_BurstAddress)) EEPROM_PauseBurst();
+
+	//enter program mode with the first halfword
+	if (EEPROM_Burst == 1)
+	{
+		result = EEPROM_BURST_BEGIN(Address);
+		if (result != EEPROM_SUCCESS) return result;
+		EEPROM_Burst = 2;
+		EEPROM_BurstAddress = Address;
+	}
+
+	//write the halfwords
+	for (uint32_t i = 0; i < (1U << (TypeProgram - 1)); i++)
+	{
+		result = EEPROM_BURST_WRITE(Address + 2 * i, (uint16_t) (Data >> (16 * i)));
+		if (result != EEPROM_SUCCESS) return result;
+	}
+
+	return EEPROM_SUCCESS;
+}
+#endif
+
+
+#ifdef EEPROM_BURST_REGISTERS
+// burst programming hooks on the flash registers (see EEPROM_BURST_BEGIN)
+// - begin: take the lock of the flash driver (pFlash, held in program mode like by HAL_FLASH_Program), wait for the last operation (HAL),
+//   clear the error code, end of operation and error flags, set the program bit
+// - program: write the halfword, poll the busy flag (HAL_TIMEOUT after FLASH_TIMEOUT_VALUE like FLASH_WaitForLastOperation)
+// - check: read the error flags (they stay set until the end)
+// - end: clear the program bit, set the error code of the error flags (pFlash.ErrorCode), clear them, release the lock
+static HAL_StatusTypeDef EEPROM_BurstBegin(uint32_t Address)
+{
+	__HAL_LOCK(&pFlash);
+	HAL_StatusTypeDef status = FLASH_WaitForLastOperation(FLASH_TIMEOUT_VALUE);
+#if defined(FLASH_BANK2_END)
+	if (status == HAL_OK && Address > FLASH_BANK1_END) status = FLASH_WaitForLastOperationBank2(FLASH_TIMEOUT_VALUE);
+#endif
+	if (status != HAL_OK)
+	{
+		__HAL_UNLOCK(&pFlash);
+		return status;
+	}
+
+	pFlash.ErrorCode = HAL_FLASH_ERROR_NONE;
+	__HAL_FLASH_CLEAR_FLAG(EEPROM_FLASH_FLAG(Address, FLASH_FLAG_EOP) | EEPROM_FLASH_FLAG(Address, FLASH_FLAG_PGERR) | EEPROM_FLASH_FLAG(Address, FLASH_FLAG_WRPERR));
+	EEPROM_FLASH_CR(Address) |= FLASH_CR_PG;
+	return HAL_OK;
+}
+
+static HAL_StatusTypeDef EEPROM_BurstWrite(uint32_t Address, uint16_t Data)
+{
+	EEPROM_WRITE16(Address, Data);
+	uint32_t Tick = HAL_GetTick();
+	while (__HAL_FLASH_GET_FLAG(EEPROM_FLASH_FLAG(Address, FLASH_FLAG_BSY)))
+	{
+		if (HAL_GetTick() - Tick > FLASH_TIMEOUT_VALUE) return HAL_TIMEOUT;
+	}
+	return HAL_OK;
+}
+
+static HAL_StatusTypeDef EEPROM_BurstCheck(uint32_t Address)
+{
+	return __HAL_FLASH_GET_FLAG(EEPROM_FLASH_FLAG(Address, FLASH_FLAG_PGERR)) || __HAL_FLASH_GET_FLAG(EEPROM_FLASH_FLAG(Address, FLASH_FLAG_WRPERR)) ? HAL_ERROR : HAL_OK;
+}
+
+static HAL_StatusTypeDef EEPROM_BurstEnd(uint32_t Address)
+{
+	EEPROM_FLASH_CR(Address) &= ~FLASH_CR_PG;
+	if (__HAL_FLASH_GET_FLAG(EEPROM_FLASH_FLAG(Address, FLASH_FLAG_PGERR))) pFlash.ErrorCode |= HAL_FLASH_ERROR_PROG;
+	if (__HAL_FLASH_GET_FLAG(EEPROM_FLASH_FLAG(Address, FLASH_FLAG_WRPERR))) pFlash.ErrorCode |= HAL_FLASH_ERROR_WRP;
+	__HAL_FLASH_CLEAR_FLAG(EEPROM_FLASH_FLAG(Address, FLASH_FLAG_PGERR) | EEPROM_FLASH_FLAG(Address, FLASH_FLAG_WRPERR));
+	__HAL_UNLOCK(&pFlash);
+	return pFlash.ErrorCode != HAL_FLASH_ERROR_NONE ? HAL_ERROR : HAL_OK;
+}
+#endif
+
+
+// checks if a page is completely erased (an interrupted erase can leave programmed halfwords behind an erased page status)
+// the erase count written after the erase is not checked
+//
+// Page:	page to check (as EEPROM_Page)
+// return:	1 if every halfword is erased, else 0
+static uint8_t EEPROM_PageBlank(EEPROM_Page Page)
+{
+	for (uint32_t Address = Page; Address < Page + FLASH_PAGE_SIZE; Address += 4)
+	{
+		uint32_t Word = EEPROM_READ32(Address);
+		if (EEPROM_STATS && Address == ((Page + EEPROM_ERASE_COUNT_OFFSET) & ~3UL)) Word |= 0xFFFFUL << (8 * (EEPROM_ERASE_COUNT_OFFSET & 2));
+		if (Word != 0xFFFFFFFF) return 0;
+	}
+	return 1;
+}
+
+
+// reads a halfword of a page through a one word buffer (consecutive halfwords of the same word cost one flash access)
+//
+// Address:		address of the halfword
+// Word:		buffered word (updated when Address is outside of it)
+// WordAddress:	address of the buffered word (0: buffer empty)
+// return:		halfword at Address
+static uint16_t EEPROM_ReadHalfword(uint32_t Address, uint32_t* Word, uint32_t* WordAddress)
+{
+	if ((Address & ~3UL) != *WordAddress)
+	{
+		*WordAddress = Address & ~3UL;
+		*Word = EEPROM_READ32(*WordAddress);
+	}
+	return (Address & 2) ? (uint16_t) (*Word >> 16) : (uint16_t) *Word;
+}
+
+
+// finds the latest checkpoint of a page (the slots of the page header are used in order)
+//
+// Page:	page to check (as EEPROM_Page)
+// Slots:	outputs the number of used slots
+// return:	address of the checkpoint, 0 if the page has no checkpoint (or the latest one doesn't fit the build)
+static uint32_t EEPROM_PageCheckpoint(EEPROM_Handle* Handle, EEPROM_Page Page, uint8_t* Slots)
+{
+	*Slots = 0;
+	if (EEPROM_CHECKPOINT_INTERVAL == 0) return 0;
+
+	for (uint8_t i = EEPROM_CHECKPOINT_SLOTS; i > 0; i--)
+	{
+		uint16_t Offset = EEPROM_READ16(Page + 2 * i);
+		if (Offset == 0xFFFF) continue;
+		*Slots = i;
+
+		//check the checkpoint (an interrupted slot write leaves a wrong address, EEPROM_VARIABLE_COUNT might have changed between builds)
+		if (Offset < EEPROM_PAGE_HEADER || Offset > FLASH_PAGE_SIZE - EEPROM_CHECKPOINT_BYTES(Handle->VariableCount)) return 0;
+		if (EEPROM_READ32(Page + Offset) != (EEPROM_CHECKPOINT_HEADER | ((uint32_t) Handle->VariableCount << 16))) return 0;
+		return Page + Offset;
+	}
+	return 0;
+}
+
+
+// returns the page following the passed page in ring order (of the selected class)
+//
+// Page:	page address (as EEPROM_Page)
+// return:	address of the following page
+static uint32_t EEPROM_NextPage(EEPROM_Handle* Handle, uint32_t Page)
+{
+	Page += FLASH_PAGE_SIZE;
+	if (Page >= Handle->ClassEnd) Page = Handle->ClassStart;
+	return Page;
+}
+
+
+// selects a variable class: the page status, next index, page transfer and checkpoint variables refer to its pages afterwards
+// - keep the state of the selected class
+// - load the state of the new class
+//
+// Class:	class to select (0 ... EEPROM_CLASS_COUNT - 1)
+static void EEPROM_SelectClass(EEPROM_Handle* Handle, uint8_t Class)
+{
+#if EEPROM_MAX_CLASS_COUNT > 1
+	if (Class == Handle->Class) return;
+
+	//keep the state of the selected class
+	EEPROM_ClassState* State = &Handle->Classes[Handle->Class];
+	State->ValidPage = Handle->ValidPage;
+	State->ActivePage = Handle->ActivePage;
+	State->ReceivingPage = Handle->ReceivingPage;
+	State->ErasedPage = Handle->ErasedPage;
+	State->ErasedCount = Handle->ErasedCount;
+	State->NextIndex = Handle->NextIndex;
+	State->TransferName = Handle->TransferName;
+	State->TransferBytes = Handle->TransferBytes;
+	State->TransferMarked = Handle->TransferMarked;
+	State->CheckpointRecords = Handle->CheckpointRecords;
+	State->CheckpointSlots = Handle->CheckpointSlots;
+
+	//load the state of the new class
+	State = &Handle->Classes[Class];
+	Handle->ValidPage = State->ValidPage;
+	Handle->ActivePage = State->ActivePage;
+	Handle->ReceivingPage = State->ReceivingPage;
+	Handle->ErasedPage = State->ErasedPage;
+	Handle->ErasedCount = State->ErasedCount;
+	Handle->NextIndex = State->NextIndex;
+	Handle->TransferName = State->TransferName;
+	Handle->TransferBytes = State->TransferBytes;
+	Handle->TransferMarked = State->TransferMarked;
+	Handle->CheckpointRecords = State->CheckpointRecords;
+	Handle->CheckpointSlots = State->CheckpointSlots;
+	Handle->ClassStart = State->ClassStart;
+	Handle->ClassEnd = State->ClassEnd;
+	Handle->FirstName = State->FirstName;
+	Handle->EndName = State->EndName;
+	Handle->Class = Class;
+#endif
+}
+
+
+// returns the class of a variable (classes hold ascending ranges of names)
+//
+// VariableName:	name (number) of the variable (must exist)
+// return:			class of the variable
+static uint8_t EEPROM_NameClass(EEPROM_Handle* Handle, uint16_t VariableName)
+{
+	uint8_t Class = EEPROM_MAX_CLASS_COUNT > 1 ? Handle->ClassCount - 1 : 0;
+	while (Class > 0 && VariableName < Handle->Classes[Class].FirstName) Class--;
+	return Class;
+}
+
+
+// returns the class of a page (classes hold consecutive pages)
+//
+// Page:	page address (as EEPROM_Page)
+// return:	class of the page
+static uint8_t EEPROM_PageClass(EEPROM_Handle* Handle, EEPROM_Page Page)
+{
+	uint8_t Class = EEPROM_MAX_CLASS_COUNT > 1 ? Handle->ClassCount - 1 : 0;
+	while (Class > 0 && Page < Handle->Classes[Class].ClassStart) Class--;
+	return Class;
+}
+
+
+// reads the whole page, fills the index with variable addresses and the size table with variable sizes
+// the page is read word by word: a header sharing its word with the previous halfword read costs no flash access,
+// the end of data check and the torn write check need two word reads instead of four halfword reads
+// (the walk already stops at the first erased header, so the erased tail behind the data is never scanned)
+// - declare variables
 // - ignore call when Page is PAGE_NONE
 // - get page addresses
-// - loop through page addresses
+// - load the latest checkpoint of the page (replay only the records behind it, only the variables of the selected class)
+// - loop through page starting after page header (or checkpoint)
 // - read potential variable header
-// - if no header written
-//		- loop through next 4 halfword and check if there is anything written
-//		- while looping count the size of written data
-//		- if no data found, last variable of page was reached (return)
+// - if no header written (causes: end of data reached or reset while writing)
+//		- loop through next 4 halfword (5 with CRC) and check if there is anything written
+//		- while looping count the size of written data (resulting from reset while writing)
+//		- if no data found, last variable of page was reached (end loop)
+//		- else note the interrupted write (transactions: a transaction without commit halfword starts here, the records up to
+//		  the end of the data are ignored)
 // - else (if header written)
 //		- get size code
-//		- check for valid name
-//		- if everything valid, update the index and the size table
+//		- check for valid name (of the selected class)
 //		- calculate size in bytes from size code
+//		- blob or counter: get size and name from the blob header, ignore the record if its commit halfword is missing
+//		- transaction header: records of a committed transaction follow, an aborted transaction is skipped
+//		- if everything valid (and the CRC is right with EEPROM_CRC_INIT), update the index and the size table
+//		- note a transfer marker
+//		- no size for the marker, size of a checkpoint from its variable count
 // - go to next address on page
-// - set next free flash address
+// - cover an interrupted write at the end of the data with a padding header (records written behind it would look like its data),
+//   transactions: abort the transaction without commit halfword instead (it covers an interrupted write too)
+// - set next free flash address and the records behind the latest checkpoint
 // - return on loop end
 //
 // Page:	page to search for variables
-// return:	EEPROM_SUCCESS
-static EEPROM_Result EEPROM_PageToIndex(EEPROM_Page Page)
+// return:	EEPROM_SUCCESS, EEPROM_FULL (sparse names: more variables than entries), EEPROM_ERROR, EEPROM_BUSY or EEPROM_TIMEOUT
+static EEPROM_Result EEPROM_PageToIndex(EEPROM_Handle* Handle, EEPROM_Page Page)
 {
 	//declare variables
 	uint16_t VariableHeader;																			//header of current variable (first 2 bits size code, rest name)
 	uint8_t SizeCode;																					//size of current variable as Size code
-	uint8_t Size;																						//size of current variable in bytes
+	uint16_t Size;																						//size of current variable in bytes
 	uint16_t Name;																						//name of current variable
+	uint32_t Word = 0;																					//last word read from the page
+	uint32_t WordAddress = 0;																			//address of the last word read (0: none)
+	uint16_t Records = 0;																				//records behind the latest checkpoint
+	uint32_t TornAddress = 0;																			//header address of an interrupted write at the end of the data (0: none)
+	uint16_t TornSize = 0;																				//size of its written data in bytes
+	uint32_t TransactionAddress = 0;																	//header address of a transaction without commit halfword (0: none)
 
 	//ignore call when Page is PAGE_NONE
 	if (Page == EEPROM_PAGE_NONE) return EEPROM_SUCCESS;
 
 	//get page addresses
-	uint32_t Address = Page + 2;
+	uint32_t Address = Page + EEPROM_PAGE_HEADER;
 	uint32_t PageEndAddress = Page + FLASH_PAGE_SIZE;
 
+	//load the latest checkpoint of the page (on a receiving page it follows the transfer marker)
+	uint32_t Checkpoint = EEPROM_PageCheckpoint(Handle, Page, &Handle->CheckpointSlots);
+	if (Checkpoint != 0)
+	{
+		uint32_t SizeAddress = Checkpoint + 4 + 2 * Handle->VariableCount;
+		for (uint16_t i = EEPROM_FIRST_SLOT; i < EEPROM_END_SLOT; i++)
+		{
+			uint16_t Slot = i;
+#if EEPROM_SPARSE_NAMES
+			//sparse names: take an entry for each assigned variable of the class (entries of the checkpoint are restored by name)
+			uint32_t NameAddress = SizeAddress + 2 * ((Handle->VariableCount + 7) / 8) + 2 * i;
+			Name = EEPROM_ReadHalfword(NameAddress, &Word, &WordAddress);
+			if (Name < Handle->FirstName || Name >= Handle->EndName || EEPROM_ReadHalfword(Checkpoint + 4 + 2 * i, &Word, &WordAddress) == 0) continue;
+			Slot = EEPROM_InsertSlot(Handle, Name);
+			if (Slot == EEPROM_SLOT_NONE) return EEPROM_FULL;
+#endif
+			Handle->Index[Slot] = EEPROM_ReadHalfword(Checkpoint + 4 + 2 * i, &Word, &WordAddress);
+			Handle->SizeTable[Slot] = (EEPROM_ReadHalfword(SizeAddress + 2 * (i / 8), &Word, &WordAddress) >> (2 * (i % 8))) & 0b11;
+			if (Handle->SizeTable[Slot] == EEPROM_SIZE_DELETED && Handle->Index[Slot] != 0)
+			{
+				Handle->SizeTable[Slot] = EEPROM_SIZE_BLOB;
+				if (Handle->Index[Slot] & 1) Handle->SizeTable[Slot] = EEPROM_SIZE8;
+				else if (EEPROM_READ16(Handle->StartAddress + Handle->Index[Slot]) & EEPROM_COUNTER_FLAG) Handle->SizeTable[Slot] = EEPROM_SIZE_COUNTER;
+			}
+		}
+		if (EEPROM_READ16(Page) == EEPROM_RECEIVING) Handle->TransferMarked = 1;
+		Address = Checkpoint + EEPROM_CHECKPOINT_BYTES(Handle->VariableCount);
+	}
+
 	//loop through page starting after page header
 	while (Address < PageEndAddress)
 	{
 		//read potential variable header
-		VariableHeader = *((__IO uint16_t*) Address);
+		VariableHeader = EEPROM_ReadHalfword(Address, &Word, &WordAddress);
+
+		//inside a transaction without commit halfword only variable records can follow: a blob, counter, checkpoint, marker or
+		//transaction header is the value of an interrupted write
+		uint8_t Noise = TransactionAddress != 0 && VariableHeader != 0xFFFF && (EEPROM_TRANSACTION_RECORD(VariableHeader) ||
+			(VariableHeader >> 14 == EEPROM_SIZE_DELETED && (VariableHeader & EEPROM_BLOB_HEADER)));
 
 		//if no header written (causes: end of data reached or reset while writing)
-		if (VariableHeader == 0xFFFF)
+		if (VariableHeader == 0xFFFF || Noise)
 		{
-			//loop through next 4 halfword and check if there is anything written
+			//loop through next 4 halfword (5 with CRC, one more behind a commit halfword) and check if there is anything written
 			Size = 0;
-			for (uint8_t i = 2; i <= 8; i += 2)
+			for (uint8_t i = 2; i <= 8 + EEPROM_CRC_BYTES + (EEPROM_TRANSACTION_SIZE > 0 ? 2 : 0); i += 2)
 			{
 				if (Address + i >= PageEndAddress) break;
 				//while looping count the size of written data (resulting from reset while writing)
-				if (*((__IO uint16_t*) (Address + i)) != 0xFFFF) Size = i;
+				if (EEPROM_ReadHalfword(Address + i, &Word, &WordAddress) != 0xFFFF) Size = i;
 			}
 			//if no data found, last variable of page was reached (end loop)
-			if (Size == 0) break;
+			if (Size == 0 && !Noise) break;
+
+			//else note the interrupted write (transactions: a transaction without commit halfword starts here, the walk goes on
+			//behind the header, the records up to the end of the data are ignored, an interrupted write inside it is skipped)
+			if (EEPROM_TRANSACTION_SIZE > 0)
+			{
+				if (TransactionAddress == 0)
+				{
+					TransactionAddress = Address;
+					Size = 0;
+				}
+			}
+			else
+			{
+				TornAddress = Address;
+				TornSize = Size;
+			}
 		}
 
 		//else (if header written, proper variable value is following)
 		else
 		{
+			TornAddress = 0;
+
 			//get size code
 			SizeCode = VariableHeader >> 14;
 
-			//check for valid name (VARIABLE_COUNT might have been reduced between builds, but old variables are still in flash)
+			//check for valid name of the class (VARIABLE_COUNT might have been reduced between builds, but old variables are still in flash)
 			Name = VariableHeader & 0b0011111111111111;
-			if (Name < EEPROM_VARIABLE_COUNT)
+
+			//calculate size in bytes from size code (blob or counter: from its length or tick count, see below)
+			Size = EEPROM_RECORD_BYTES(SizeCode) - 2;
+
+			//blob or counter: get size and name from the blob header, ignore the record if its commit halfword is missing (interrupted write)
+			if (SizeCode == EEPROM_SIZE_DELETED && (Name & EEPROM_BLOB_HEADER) && VariableHeader != EEPROM_TRANSFER_MARKER && VariableHeader != EEPROM_CHECKPOINT_HEADER)
+			{
+				uint16_t Length = EEPROM_ReadHalfword(Address + 2, &Word, &WordAddress);
+				SizeCode = EEPROM_SIZE_BLOB;
+				Size = EEPROM_BLOB_BYTES(Length) - 2;
+				if (Length & EEPROM_COUNTER_FLAG)
+				{
+					SizeCode = EEPROM_SIZE_COUNTER;
+					Size = EEPROM_COUNTER_BYTES(Length & ~EEPROM_COUNTER_FLAG) - 2;
+				}
+				Name &= ~EEPROM_BLOB_HEADER;
+				if (Address + Size >= PageEndAddress || EEPROM_ReadHalfword(Address + Size, &Word, &WordAddress) != 0x0000) Name = 0xFFFF;
+			}
+
+			//inline record: get the name from the header (the value is the low byte of the header)
+			if (EEPROM_INLINE_RECORD(VariableHeader))
+			{
+				SizeCode = EEPROM_SIZE8;
+				Size = EEPROM_RECORD_BYTES(EEPROM_SIZE8) - 2;
+				Name = (VariableHeader >> 8) & 0x1F;
+			}
+
+			//transaction header: records of a committed transaction follow, an aborted transaction is skipped (halfwords from the header on)
+			if (EEPROM_TRANSACTION_RECORD(VariableHeader))
 			{
-				//if everything valid, update the index and the size table
-				EEPROM_Index[Name] = Address + 2 - EEPROM_START_ADDRESS;
-				EEPROM_SizeTable[Name] = SizeCode;
-				if (SizeCode == EEPROM_SIZE_DELETED) EEPROM_Index[Name] = 0;
+				Name = 0xFFFF;
+				Size = (VariableHeader & 0x1FFF) != 0 ? 2 * (VariableHeader & 0x1FFF) - 2 : 0;
 			}
 
-			//calculate size in bytes from size code
-			Size = 1 << SizeCode;
-			if (SizeCode == EEPROM_SIZE_DELETED) Size = 0;
+			if (TransactionAddress == 0 && Name >= Handle->FirstName && Name < Handle->EndName && (EEPROM_CRC != EEPROM_CRC_INIT || EEPROM_RecordValid(Address)))
+			{
+				//if everything valid (and the CRC is right), update the index and the size table (sparse names: entry of the name)
+				uint16_t Slot = EEPROM_SLOT(Name);
+#if EEPROM_SPARSE_NAMES
+				if (Slot == EEPROM_SLOT_NONE && SizeCode != EEPROM_SIZE_DELETED) Slot = EEPROM_InsertSlot(Handle, Name);
+				if (Slot == EEPROM_SLOT_NONE && SizeCode != EEPROM_SIZE_DELETED) return EEPROM_FULL;
+#endif
+				if (Slot != EEPROM_SLOT_NONE)
+				{
+					Handle->Index[Slot] = Address + 2 - Handle->StartAddress;
+					Handle->SizeTable[Slot] = SizeCode;
+					if (SizeCode == EEPROM_SIZE8) Handle->Index[Slot]--;
+					if (SizeCode == EEPROM_SIZE_DELETED) Handle->Index[Slot] = 0;
+				}
+			}
+			if (VariableHeader == EEPROM_TRANSFER_MARKER && TransactionAddress == 0) Handle->TransferMarked = 1;
+
+			//no size for the marker, size of a checkpoint from its variable count
+			if (VariableHeader == EEPROM_TRANSFER_MARKER) Size = 0;
+			if (VariableHeader == EEPROM_CHECKPOINT_HEADER) Size = EEPROM_CHECKPOINT_BYTES(EEPROM_ReadHalfword(Address + 2, &Word, &WordAddress)) - 2;
+			else Records++;
 		}
 
 		//go to next address on page
 		Address = Address + 2 + Size;
 	}
 
-	//set next free flash address
-	EEPROM_NextIndex = Address;
-	if (Address >= PageEndAddress) EEPROM_NextIndex = 0;
+	//cover an interrupted write at the end of the data with a padding header (smallest variable record covering its data)
+	if (TornAddress != 0)
+	{
+		SizeCode = EEPROM_SIZE16;
+		while (EEPROM_RECORD_BYTES(SizeCode) - 2 < TornSize) SizeCode++;
+		EEPROM_Result result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, TornAddress, (SizeCode << 14) | EEPROM_PADDING_NAME);
+		if (result != EEPROM_SUCCESS) return result;
+		Address = TornAddress + EEPROM_RECORD_BYTES(SizeCode);
+	}
+
+	//abort a transaction without commit halfword (its halfwords up to the end of the data, the next record is written behind them)
+	if (TransactionAddress != 0)
+	{
+		if (Address > PageEndAddress) Address = PageEndAddress;
+		EEPROM_Result result = EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, TransactionAddress, EEPROM_TRANSACTION_HEADER | ((Address - TransactionAddress) / 2));
+		if (result != EEPROM_SUCCESS) return result;
+	}
+
+	//set next free flash address and the records behind the latest checkpoint
+	Handle->NextIndex = Address;
+	if (Address >= PageEndAddress) Handle->NextIndex = 0;
+	Handle->CheckpointRecords = Records;
 
 	//return on loop end
 	return EEPROM_SUCCESS;
 }
+
+
+// checks the CRC of the latest record of a variable once (EEPROM_CRC_READ, the result is kept until the variable is written again)
+//
+// Slot:	entry of the variable in the address index (EEPROM_SLOT_NONE: not assigned)
+// return:	EEPROM_SUCCESS (also if not assigned or not checked by the policy), EEPROM_CORRUPTED
+static EEPROM_Result EEPROM_VerifyRecord(EEPROM_Handle* Handle, uint16_t Slot)
+{
+#if EEPROM_CRC == EEPROM_CRC_READ
+	if (Slot == EEPROM_SLOT_NONE || Handle->Index[Slot] == 0 || (Handle->Verified[Slot / 8] & (1 << (Slot % 8)))) return EEPROM_SUCCESS;
+	if (!EEPROM_RecordValid(Handle->StartAddress + EEPROM_HEADER_OFFSET(Handle->Index[Slot]))) return EEPROM_CORRUPTED;
+	Handle->Verified[Slot / 8] |= 1 << (Slot % 8);
+#endif
+	return EEPROM_SUCCESS;
+}
+
+
+// checks the CRC of a record in flash (read through a one word buffer)
+// - get the covered halfwords from the header (blob: from its length, counter: tick count and base value, the ticks are not covered,
+//   inline record: none)
+// - calculate the CRC of header and covered halfwords
+// - compare with the stored CRC
+//
+// Address:	address of the record header
+// return:	1 if the CRC is right, else 0
+static uint8_t EEPROM_RecordValid(uint32_t Address)
+{
+	uint32_t Word = 0;
+	uint32_t WordAddress = 0;
+
+	//get the covered halfwords from the header
+	uint16_t VariableHeader = EEPROM_ReadHalfword(Address, &Word, &WordAddress);
+	uint16_t Halfwords = (1 << (VariableHeader >> 14)) / 2;
+	uint16_t TickBytes = 0;
+	if ((VariableHeader >> 14) == EEPROM_SIZE_DELETED && (VariableHeader & EEPROM_BLOB_HEADER))
+	{
+		uint16_t Length = EEPROM_ReadHalfword(Address + 2, &Word, &WordAddress);
+		Halfwords = 1 + (Length + 1) / 2;
+		if (Length & EEPROM_COUNTER_FLAG)
+		{
+			Halfwords = 3;
+			TickBytes = 2 * (Length & ~EEPROM_COUNTER_FLAG);
+		}
+	}
+	if (EEPROM_INLINE_RECORD(VariableHeader)) Halfwords = 0;
+
+	//calculate the CRC of header and covered halfwords
+	uint32_t Crc = EEPROM_CrcUpdate(EEPROM_CrcStart(), VariableHeader);
+	for (uint16_t i = 1; i <= Halfwords; i++) Crc = EEPROM_CrcUpdate(Crc, EEPROM_ReadHalfword(Address + 2 * i, &Word, &WordAddress));
+
+	//compare with the stored CRC
+	return EEPROM_ReadHalfword(Address + 2 + 2 * Halfwords + TickBytes, &Word, &WordAddress) == (uint16_t) Crc;
+}
+
+
+// calculates the CRC of a record to write (same halfwords as checked by EEPROM_RecordValid)
+//
+// VariableHeader:	header of the record
+// Value:			value to be written (blob: length, counter: base value)
+// Size:			size of "Value" as EEPROM_Size
+// Data:			blob data
+// return:			CRC
+static uint16_t EEPROM_RecordCrc(uint16_t VariableHeader, EEPROM_Value Value, EEPROM_Size Size, const uint8_t* Data)
+{
+	uint32_t Crc = EEPROM_CrcUpdate(EEPROM_CrcStart(), VariableHeader);
+	if (Size == EEPROM_SIZE_BLOB)
+	{
+		Crc = EEPROM_CrcUpdate(Crc, Value.uInt16);
+		for (uint16_t i = 0; i < Value.uInt16; i += 2) Crc = EEPROM_CrcUpdate(Crc, EEPROM_BlobHalfword(Data, Value.uInt16, i));
+	}
+	else if (Size == EEPROM_SIZE_COUNTER)
+	{
+		Crc = EEPROM_CrcUpdate(Crc, EEPROM_COUNTER_TICKS | EEPROM_COUNTER_FLAG);
+		Crc = EEPROM_CrcUpdate(Crc, (uint16_t) Value.uInt32);
+		Crc = EEPROM_CrcUpdate(Crc, (uint16_t) (Value.uInt32 >> 16));
+	}
+	else if (Size != EEPROM_SIZE8)
+	{
+		for (uint8_t i = 0; i < (1 << Size) / 2; i++) Crc = EEPROM_CrcUpdate(Crc, (uint16_t) (Value.uInt64 >> (16 * i)));
+	}
+	return (uint16_t) Crc;
+}
+
+
+// starts a CRC calculation (CRC unit: reset)
+//
+// return:	initial CRC
+static uint32_t EEPROM_CrcStart()
+{
+#if EEPROM_CRC_HARDWARE
+	CRC->CR = CRC_CR_RESET;
+	return 0xFFFFFFFF;
+#else
+	return 0xFFFF;
+#endif
+}
+
+
+// adds a halfword to a CRC calculation (table driven: one table lookup per byte, low byte first, CRC unit: one word write)
+//
+// Crc:			CRC so far
+// Halfword:	halfword to add
+// return:		CRC including the halfword
+static uint32_t EEPROM_CrcUpdate(uint32_t Crc, uint16_t Halfword)
+{
+#if EEPROM_CRC_HARDWARE
+	CRC->DR = Halfword;
+	return CRC->DR;
+#elif EEPROM_CRC
+	Crc = (uint16_t) (Crc << 8) ^ EEPROM_CrcTable[((Crc >> 8) ^ Halfword) & 0xFF];
+	Crc = (uint16_t) (Crc << 8) ^ EEPROM_CrcTable[((Crc >> 8) ^ (Halfword >> 8)) & 0xFF];
+	return Crc;
+#else
+	return Crc;
+#endif
+}
+
+
+// counts a finished page erase and writes the erase count to the page header (EEPROM_STATS, the page status stays erased)
+// a count already written (erase reported twice) is kept
+//
+// Page:	erased page (as EEPROM_Page)
+// return:	EEPROM_SUCCESS, EEPROM_ERROR, EEPROM_BUSY or EEPROM_TIMEOUT
+static EEPROM_Result EEPROM_CountErase(EEPROM_Handle* Handle, EEPROM_Page Page)
+{
+#if EEPROM_STATS
+	uint8_t Number = (Page - Handle->StartAddress) / FLASH_PAGE_SIZE;
+	Handle->PageErases++;
+	if (Handle->EraseCounts[Number] < 0xFFFE) Handle->EraseCounts[Number]++;
+	if (EEPROM_READ16(Page + EEPROM_ERASE_COUNT_OFFSET) != 0xFFFF) return EEPROM_SUCCESS;
+	return EEPROM_PROGRAM(FLASH_TYPEPROGRAM_HALFWORD, Page + EEPROM_ERASE_COUNT_OFFSET, Handle->EraseCounts[Number]);
+#else
+	return EEPROM_SUCCESS;
+#endif
+}
+
+
+#if EEPROM_STATS
+// keeps the longest write call for the statistics
+//
+// Timestamp:	EEPROM_TIMESTAMP at the start of the call
+static void EEPROM_WriteLatency(EEPROM_Handle* Handle, uint32_t Timestamp)
+{
+	uint32_t Latency = EEPROM_TIMESTAMP() - Timestamp;
+	if (Latency > Handle->MaxWriteLatency) Handle->MaxWriteLatency = Latency;
+}
+#endif
+
+
+// functions of the default instance (same as the functions of an instance above, on the region of the library configuration)
+// EEPROM_Init sets up the default instance on the last EEPROM_PAGE_COUNT pages of flash with the configured classes
+EEPROM_Result EEPROM_Init()
+{
+	const EEPROM_Region Region = {EEPROM_START_ADDRESS, EEPROM_PAGE_COUNT, EEPROM_VARIABLE_COUNT, EEPROM_DefaultIndex, EEPROM_DefaultSizeTable,
+		EEPROM_CLASS_COUNT, EEPROM_ClassPages, EEPROM_ClassNames,
+#if EEPROM_SHADOW
+		EEPROM_DefaultShadow,
+#else
+		NULL,
+#endif
+#if EEPROM_SPARSE_NAMES
+		EEPROM_DefaultNames};
+#else
+		NULL};
+#endif
+	return EEPROM_HandleInit(&EEPROM_Default, &Region);
+}
+
+EEPROM_Result EEPROM_ReadVariable(uint16_t VariableName, EEPROM_Value* Value)
+{
+	return EEPROM_HandleReadVariable(&EEPROM_Default, VariableName, Value);
+}
+
+EEPROM_Result EEPROM_WriteVariable(uint16_t VariableName, EEPROM_Value Value, EEPROM_Size Size)
+{
+	return EEPROM_HandleWriteVariable(&EEPROM_Default, VariableName, Value, Size);
+}
+
+EEPROM_Result EEPROM_UpdateVariable(uint16_t VariableName, EEPROM_Value Value, EEPROM_Size Size)
+{
+	return EEPROM_HandleUpdateVariable(&EEPROM_Default, VariableName, Value, Size);
+}
+
+EEPROM_Result EEPROM_DeleteVariable(uint16_t VariableName)
+{
+	return EEPROM_HandleDeleteVariable(&EEPROM_Default, VariableName);
+}
+
+EEPROM_Result EEPROM_WriteVariables(const EEPROM_Variable* Variables, uint16_t Count)
+{
+	return EEPROM_HandleWriteVariables(&EEPROM_Default, Variables, Count);
+}
+
+EEPROM_Result EEPROM_DeleteVariables(const uint16_t* VariableNames, uint16_t Count)
+{
+	return EEPROM_HandleDeleteVariables(&EEPROM_Default, VariableNames, Count);
+}
+
+EEPROM_Result EEPROM_WriteBlob(uint16_t VariableName, const void* Data, uint16_t Length)
+{
+	return EEPROM_HandleWriteBlob(&EEPROM_Default, VariableName, Data, Length);
+}
+
+EEPROM_Result EEPROM_ReadBlob(uint16_t VariableName, const uint8_t** Data, uint16_t* Length)
+{
+	return EEPROM_HandleReadBlob(&EEPROM_Default, VariableName, Data, Length);
+}
+
+EEPROM_Result EEPROM_IncrementCounter(uint16_t VariableName, uint32_t* Value)
+{
+	return EEPROM_HandleIncrementCounter(&EEPROM_Default, VariableName, Value);
+}
+
+EEPROM_Result EEPROM_Poll(uint16_t Budget)
+{
+	return EEPROM_HandlePoll(&EEPROM_Default, Budget);
+}
+
+EEPROM_Result EEPROM_Flush()
+{
+	return EEPROM_HandleFlush(&EEPROM_Default);
+}
+
+EEPROM_Result EEPROM_EmergencyFlush()
+{
+	return EEPROM_HandleEmergencyFlush(&EEPROM_Default);
+}
+
+EEPROM_Result EEPROM_WriteVariableFromISR(uint16_t VariableName, EEPROM_Value Value, EEPROM_Size Size)
+{
+	return EEPROM_HandleWriteVariableFromISR(&EEPROM_Default, VariableName, Value, Size);
+}
+
+EEPROM_Result EEPROM_BeginTransaction()
+{
+	return EEPROM_HandleBeginTransaction(&EEPROM_Default);
+}
+
+EEPROM_Result EEPROM_Commit()
+{
+	return EEPROM_HandleCommit(&EEPROM_Default);
+}
+
+EEPROM_Result EEPROM_AbortTransaction()
+{
+	return EEPROM_HandleAbortTransaction(&EEPROM_Default);
+}
+
+EEPROM_Result EEPROM_Compact(uint8_t Threshold)
+{
+	return EEPROM_HandleCompact(&EEPROM_Default, Threshold);
+}
+
+uint32_t EEPROM_GetFreeSpace()
+{
+	return EEPROM_HandleGetFreeSpace(&EEPROM_Default);
+}
+
+void EEPROM_GetWriteCounters(uint32_t* Writes, uint32_t* ElidedWrites)
+{
+	EEPROM_HandleGetWriteCounters(&EEPROM_Default, Writes, ElidedWrites);
+}
+
+void EEPROM_GetStats(EEPROM_Stats* Stats)
+{
+	EEPROM_HandleGetStats(&EEPROM_Default, Stats);
+}
@@ -10,28 +10,276 @@
 #include "stm32f1xx_hal.h"
 
 //-------------------------------------------library configuration-------------------------------------------
+//(every option can also be overridden by the build, e.g. -DEEPROM_VARIABLE_COUNT=16)
 
-//number of variables (maximum variable name is EEPROM_VARIABLE_COUNT - 1)
+//number of variables (maximum variable name is EEPROM_VARIABLE_COUNT - 1, at most 8190, see EEPROM_SPARSE_NAMES for names above)
 //keep in mind it is limited by page size
 //maximum is also determined by your variable sizes
-//space utilization ratio X = (2 + 4*COUNT_16BIT + 6*COUNT_32BIT + 10*COUNT_64BIT) / PAGE_SIZE
+//space utilization ratio X = (2 + 4*COUNT_16BIT + 6*COUNT_32BIT + 10*COUNT_64BIT) / PAGE_SIZE (all variables must fit on one page)
 //if X is high, variable changes more often require a page transfer --> lifetime of the flash can be reduced significantly
-//depending on your variable change rate, X should be at least <50%
+//depending on your variable change rate, X should be at least <50% with two pages, more pages (EEPROM_PAGE_COUNT) allow higher ratios
+#ifndef EEPROM_VARIABLE_COUNT
 #define EEPROM_VARIABLE_COUNT	(uint16_t) 4
+#endif
+
+//number of flash pages used as circular log (at least 2, maximum total size 64 KByte)
+//a full page stays valid and writing continues on the next erased page, only when the last erased page is left,
+//the oldest page is reclaimed: variables not updated since it was written are carried forward, then it is erased
+//more pages --> less variables to carry forward per page transfer and less page erases for high space utilization ratios
+#ifndef EEPROM_PAGE_COUNT
+#define EEPROM_PAGE_COUNT		2
+#endif
+
+//variable classes with page sets of their own (e.g. hot and cold variables, 1: all variables share the pages)
+//each class is a circular log of its own: a page transfer of a class only carries its own variables forward,
+//so frequently changed variables never copy rarely changed ones (calibration constants, serial numbers, ...)
+//EEPROM_CLASS_PAGES:	pages of each class in order (at least 2 each, they must add up to EEPROM_PAGE_COUNT)
+//EEPROM_CLASS_NAMES:	first variable name of each class in ascending order (the first class starts with 0, a class ends
+//						before the first name of the next class), e.g. {0, 8}: variables 0..7 and 8..EEPROM_VARIABLE_COUNT-1
+//(EEPROM_Init returns EEPROM_NO_VALID_PAGE if the lists don't fit), the variables of a class must fit on one page of it,
+//a batch write is written back to back per class, PageFill of EEPROM_GetStats is the page of the class written last
+//the classes change the page format: stored variables can't be read after changing them (erase the pages)
+#ifndef EEPROM_CLASS_COUNT
+#define EEPROM_CLASS_COUNT		1
+#endif
+#ifndef EEPROM_CLASS_PAGES
+#define EEPROM_CLASS_PAGES		{EEPROM_PAGE_COUNT}
+#endif
+#ifndef EEPROM_CLASS_NAMES
+#define EEPROM_CLASS_NAMES		{0}
+#endif
+
+//instances: further regions with an address index of their own (EEPROM_HandleInit, e.g. a fast-churn region next to a provisioning region)
+//the functions without handle use the default instance on the region configured above (last EEPROM_PAGE_COUNT pages of flash)
+//the maximum page, variable and class count of all instances size the arrays of EEPROM_Handle and EEPROM_Stats (default: the configuration above)
+#ifndef EEPROM_MAX_PAGE_COUNT
+#define EEPROM_MAX_PAGE_COUNT	EEPROM_PAGE_COUNT
+#endif
+#ifndef EEPROM_MAX_VARIABLE_COUNT
+#define EEPROM_MAX_VARIABLE_COUNT	EEPROM_VARIABLE_COUNT
+#endif
+#ifndef EEPROM_MAX_CLASS_COUNT
+#define EEPROM_MAX_CLASS_COUNT	EEPROM_CLASS_COUNT
+#endif
+
+//sparse variable names (0: off, 1: on)
+//off: variable names are 0 ... EEPROM_VARIABLE_COUNT - 1, the address index has an entry for every name
+//on:  variable names are any of 0 ... EEPROM_NAME_COUNT - 1 (e.g. 0x1200 ... for the parameters of a module), the address index
+//     has EEPROM_VARIABLE_COUNT entries (the most variables assigned at once, keep about 1/4 free) and an open-addressing hash table
+//     maps the names to them (2 bytes more per entry: EEPROM_DefaultNames, an instance passes its own table in EEPROM_Region)
+//     reads stay O(1), page transfers and memory checks only walk the entries, a deleted variable frees its entry
+//     a write of a new name to a full address index returns EEPROM_FULL, EEPROM_CLASS_NAMES takes names of the whole range
+//     a checkpoint holds the names of the entries too (2*VARIABLE_COUNT bytes more)
+#ifndef EEPROM_SPARSE_NAMES
+#define EEPROM_SPARSE_NAMES		0
+#endif
+
+//incremental page transfer (0: off, 1: on)
+//off: the write which fills the page carries all variables forward and erases the old page (takes tens of milliseconds)
+//on:  the write only marks the receiving page and writes its variable, EEPROM_Poll carries the variables forward step by step
+//     and erases the old page, until then reads are served from both pages and writes go to the receiving page
+//     (a write which does not fit next to the variables still to carry forward finishes the transfer first)
+#ifndef EEPROM_INCREMENTAL_TRANSFER
+#define EEPROM_INCREMENTAL_TRANSFER	0
+#endif
+
+//asynchronous page erase (0: off, 1: on)
+//off: the page transfer waits for the erase of the old page (typical 20 ms, up to 40 ms)
+//on:  the erase is started with HAL_FLASHEx_Erase_IT and runs in the background, EEPROM_Poll (or the next write) finishes
+//     the page transfer when the flash interrupt reported the end of the erase --> the erased page is ready long before it's needed
+//     requires the flash interrupt (enable FLASH_IRQn, FLASH_IRQHandler calls HAL_FLASH_IRQHandler), the library implements
+//     HAL_FLASH_EndOfOperationCallback and HAL_FLASH_OperationErrorCallback
+//     the CPU still stalls on every access to the flash bank being erased, only code running from RAM or sleeping overlaps the erase
+//     (or code running from the other bank of an XL-density device, see EEPROM_BANK)
+#ifndef EEPROM_ASYNC_ERASE
+#define EEPROM_ASYNC_ERASE		0
+#endif
+
+//pre-compaction by EEPROM_Poll: garbage share of the oldest page in percent which starts its page transfer early (0: off, 1 ... 100)
+//garbage: bytes of the page not holding a latest record (outdated records, checkpoints, unused end), the used part only on the page written to
+//without it, the transfer starts in the write which doesn't fit on the page anymore, with it, an EEPROM_Poll call in idle time
+//takes it (the write finds a compacted page), a lower threshold erases the pages more often (EEPROM_Compact does it on demand)
+#ifndef EEPROM_COMPACT_THRESHOLD
+#define EEPROM_COMPACT_THRESHOLD	0
+#endif
+
+//burst programming of page transfers, batch writes and checkpoints (0: off, 1: on)
+//off: every part of a record is programmed with HAL_FLASH_Program (lock check, wait for the last operation, flag clearing per call)
+//on:  the records a page transfer (step) carries forward, the records of a batch write and a checkpoint are programmed as one burst:
+//     the flash controller stays in program mode, the halfwords are written back to back (only the busy flag is polled between
+//     them) and the error flags are checked before each record is committed by its header and enters the index (a failed record
+//     stops the burst like a failed HAL_FLASH_Program), the burst accesses the flash registers directly (EEPROM_BURST_BEGIN, see eeprom.c)
+//     and holds the lock of the HAL flash driver meanwhile (pFlash, its ErrorCode is set like by HAL_FLASH_Program)
+//     single writes keep using HAL_FLASH_Program, the page format does not change
+#ifndef EEPROM_BURST_PROGRAM
+#define EEPROM_BURST_PROGRAM	0
+#endif
+
+//write-back cache: number of variables whose latest value can be held in RAM (0: off)
+//writes only update the cache (repeated writes of a variable are coalesced), the dirty values are written to flash
+//by EEPROM_Flush, when EEPROM_CACHE_THRESHOLD values are dirty or when the oldest dirty value is EEPROM_CACHE_PERIOD ms old
+//(0: no period, checked by EEPROM_WriteVariable and EEPROM_Poll)
+//dirty values are lost on reset: call EEPROM_Flush before a planned reset and EEPROM_EmergencyFlush in the PVD interrupt handler
+#ifndef EEPROM_CACHE_SIZE
+#define EEPROM_CACHE_SIZE		0
+#endif
+#ifndef EEPROM_CACHE_THRESHOLD
+#define EEPROM_CACHE_THRESHOLD	EEPROM_CACHE_SIZE
+#endif
+#ifndef EEPROM_CACHE_PERIOD
+#define EEPROM_CACHE_PERIOD		1000
+#endif
+
+//ISR write queue: number of writes EEPROM_WriteVariableFromISR can queue per instance (0: off, else a power of 2 up to 256)
+//EEPROM_WriteVariableFromISR only puts the write into a lock-free ring (no flash access, constant time), the writer context
+//(the context calling all other library functions) drains the ring into flash with EEPROM_Poll, EEPROM_Flush or its next write,
+//the queued writes are written as one batch (a name queued more than once is written once with its latest value)
+//one producer per instance: EEPROM_WriteVariableFromISR calls must not interrupt each other (one interrupt priority or one task)
+//queued writes are not seen by reads and are lost on reset until they are drained
+//EEPROM_QUEUE_REJECT:		a write to a full queue is rejected with EEPROM_FULL (the queued writes are kept)
+//EEPROM_QUEUE_OVERWRITE:	a write to a full queue overwrites the oldest queued write (the latest values are kept)
+//the high-water mark and the lost writes are reported by EEPROM_GetStats
+#define EEPROM_QUEUE_REJECT		0
+#define EEPROM_QUEUE_OVERWRITE	1
+#ifndef EEPROM_QUEUE_SIZE
+#define EEPROM_QUEUE_SIZE		0
+#endif
+#ifndef EEPROM_QUEUE_OVERFLOW
+#define EEPROM_QUEUE_OVERFLOW	EEPROM_QUEUE_REJECT
+#endif
+
+//RAM shadow copy of the current value of every variable (0: off, 1: on)
+//on: EEPROM_ReadVariable returns the value from RAM (no flash access, no wait states, 64 bit values in one load), EEPROM_ReadShadow
+//    is an inline accessor for the hot path, writes, counter increments and EEPROM_Init keep the copy in sync
+//    the copy takes 8 bytes per variable (EEPROM_DefaultShadow, an instance passes its own storage in EEPROM_Region)
+#ifndef EEPROM_SHADOW
+#define EEPROM_SHADOW			0
+#endif
+
+//checkpoints: snapshot of the address index written every EEPROM_CHECKPOINT_INTERVAL records (0: off)
+//a checkpoint is also written when a page is opened and when a page transfer carried all variables forward,
+//EEPROM_Init loads the latest checkpoint of the newest page and replays only the records behind it (older pages are not read)
+//a checkpoint takes 4 + 2*VARIABLE_COUNT + VARIABLE_COUNT/4 bytes (sparse names: 2*VARIABLE_COUNT more), the page header holds EEPROM_CHECKPOINT_SLOTS checkpoint
+//addresses (a page takes no more checkpoints, when its slots are used)
+//the slots change the page format: stored variables can't be read after switching checkpoints on or off (erase the pages)
+#ifndef EEPROM_CHECKPOINT_INTERVAL
+#define EEPROM_CHECKPOINT_INTERVAL	0
+#endif
+#ifndef EEPROM_CHECKPOINT_SLOTS
+#define EEPROM_CHECKPOINT_SLOTS	4
+#endif
+
+//maximum length of a blob in bytes (EEPROM_WriteBlob)
+//a blob record takes 6 bytes plus the length rounded up to even, it is carried forward by page transfers like every variable
+#ifndef EEPROM_BLOB_MAX_SIZE
+#define EEPROM_BLOB_MAX_SIZE	64
+#endif
+
+//number of increments a counter record takes in place (EEPROM_IncrementCounter)
+//a counter record holds a 32 bit base value and EEPROM_COUNTER_TICKS halfwords, each increment overwrites the next
+//halfword with 0x0000 (one halfword program), only every (EEPROM_COUNTER_TICKS + 1)th increment appends a new record
+//a counter record takes 10 + 2*EEPROM_COUNTER_TICKS bytes (page transfers carry it forward with the ticks folded into the base)
+#ifndef EEPROM_COUNTER_TICKS
+#define EEPROM_COUNTER_TICKS	16
+#endif
+
+//inline records of 8 bit values (0: off, 1: on)
+//on: a variable of size EEPROM_SIZE8 (e.g. a bool or uint8_t) is stored in its record header next to its name (one halfword program,
+//    2 bytes per record plus the CRC instead of 4), only names 0 ... EEPROM_INLINE_NAMES - 1 fit into the header (EEPROM_INVALID_SIZE above)
+//    changes the page format: stored variables can't be read after switching it off (erase the pages)
+#ifndef EEPROM_INLINE_VALUES
+#define EEPROM_INLINE_VALUES	0
+#endif
+
+//transactions: number of variables a transaction can write (0: off, up to 255)
+//the writes between EEPROM_BeginTransaction and EEPROM_Commit (values and deletes, single and batch writes, variables of one class)
+//are stored all or none: their records are written right away behind a commit halfword, which EEPROM_Commit programs last
+//(one halfword per transaction), EEPROM_Init drops the records of a transaction without it, EEPROM_AbortTransaction drops them too
+//reads see the writes of the open transaction, queued ISR writes are held back until it ends, blobs and counters are rejected meanwhile
+//(EEPROM_INVALID_SIZE), so are variables of another class (EEPROM_INVALID_NAME) and more variables than fit (EEPROM_FULL), without
+//dropping the transaction (a flash error drops it, EEPROM_Commit returns the error), records which don't fit on the page are written again behind the page transfer (in any transfer mode)
+//changes the page format: stored variables can't be read after switching it off (erase the pages)
+#ifndef EEPROM_TRANSACTION_SIZE
+#define EEPROM_TRANSACTION_SIZE	0
+#endif
+
+//CRC of every variable record (0: off), checked by the selected policy
+//EEPROM_CRC_INIT:		EEPROM_Init checks the records it reads, a record with wrong CRC is ignored (the previous value stays valid)
+//EEPROM_CRC_READ:		the first read of a variable checks its record (result kept until the next write), EEPROM_CORRUPTED if wrong
+//EEPROM_CRC_TRANSFER:	only page transfers check the records they carry forward
+//every policy checks the records carried forward by page transfers (a record with wrong CRC is dropped, the variable is not assigned anymore)
+//the CRC takes 2 bytes per record and changes the page format: stored variables can't be read after switching it on or off (erase the pages)
+#define EEPROM_CRC_INIT			1
+#define EEPROM_CRC_READ			2
+#define EEPROM_CRC_TRANSFER		3
+#ifndef EEPROM_CRC
+#define EEPROM_CRC				0
+#endif
+
+//calculate the CRC with the CRC unit of the STM32F1XX (0: off, 1: on)
+//off: CRC-16/CCITT, table driven (512 byte table in flash)
+//on:  CRC-32 of the CRC unit (halfwords written as words, lower 16 bit stored), enable its clock (__HAL_RCC_CRC_CLK_ENABLE) before EEPROM_Init,
+//     the CRC unit must not be used by interrupts meanwhile
+#ifndef EEPROM_CRC_HARDWARE
+#define EEPROM_CRC_HARDWARE		0
+#endif
+
+//runtime statistics (0: off, 1: on): flash counters, write latency and erase counts of EEPROM_GetStats
+//the erase count of each page is written to its page header after every erase (changes the page format like checkpoints,
+//a power loss right after an erase loses the count of this page: it continues with the highest count of the other pages)
+//off: EEPROM_GetStats only reports what the library knows anyway (write counters, page fill, live bytes), no code in the write path
+#ifndef EEPROM_STATS
+#define EEPROM_STATS			0
+#endif
+
+//timestamp hook of the write latency statistic (e.g. DWT->CYCCNT for CPU cycles), default: HAL tick in ms
+#ifndef EEPROM_TIMESTAMP
+#define EEPROM_TIMESTAMP()		HAL_GetTick()
+#endif
 
 //flash size of used STM32F1XX device in KByte
+#ifndef EEPROM_FLASH_SIZE
 #define EEPROM_FLASH_SIZE		(uint16_t) 64
+#endif
+
+//flash bank of the default instance on XL-density devices (two banks with read-while-write, FLASH_BANK2_END defined by the CMSIS header)
+//2: last pages of bank 2 (end of flash), code running from bank 1 keeps executing while the library programs or erases,
+//   only accesses to bank 2 stall meanwhile (e.g. reads of the library during an asynchronous erase)
+//1: last pages of bank 1, every program and erase stalls the instruction fetch of the code in bank 1
+//devices with one bank always use the last pages of flash, erases always name the bank of their pages (instances too)
+#ifndef EEPROM_BANK
+#define EEPROM_BANK				2
+#endif
 
 //-------------------------------------------------constants-------------------------------------------------
 
-//EEPROM emulation start address in flash: use last two pages of flash memory
-#define EEPROM_START_ADDRESS	(uint32_t) (0x08000000 + 1024*EEPROM_FLASH_SIZE - 2*FLASH_PAGE_SIZE)
+//EEPROM emulation start address in flash of the default instance: use last EEPROM_PAGE_COUNT pages of flash memory (of bank 1 with EEPROM_BANK 1)
+#if defined(FLASH_BANK2_END) && EEPROM_BANK == 1
+#define EEPROM_START_ADDRESS	(uint32_t) (FLASH_BANK1_END + 1 - EEPROM_PAGE_COUNT*FLASH_PAGE_SIZE)
+#else
+#define EEPROM_START_ADDRESS	(uint32_t) (0x08000000 + 1024*EEPROM_FLASH_SIZE - EEPROM_PAGE_COUNT*FLASH_PAGE_SIZE)
+#endif
+
+//number of variable names with sparse names (names 0 ... EEPROM_NAME_COUNT - 1, bit 13 of a record name marks blobs and counters)
+#define EEPROM_NAME_COUNT		8190
+
+//number of names with inline records (EEPROM_INLINE_VALUES: names 0 ... EEPROM_INLINE_NAMES - 1 can be written with EEPROM_SIZE8)
+#define EEPROM_INLINE_NAMES		31
+
+//unused entry of the sparse name table (EEPROM_Region Names), also returned by EEPROM_FindSlot for a name without entry
+#define EEPROM_SLOT_NONE		0xFFFF
+
+//hash of a variable name (Fibonacci hashing, entries of the sparse name table are probed linearly from hash % entries)
+#define EEPROM_NAME_HASH(Name)	((uint16_t) (((uint32_t) (Name) * 0x9E3779B1U) >> 16))
+
+//address of used flash page number 0 ... EEPROM_PAGE_COUNT - 1 (default instance)
+#define EEPROM_PAGE_ADDRESS(Number)	(EEPROM_START_ADDRESS + (Number)*FLASH_PAGE_SIZE)
 
-//used flash pages for EEPROM emulation
+//used flash pages for EEPROM emulation (pages of an instance are passed as EEPROM_Page too)
 typedef enum
 {
 	EEPROM_PAGE0			= EEPROM_START_ADDRESS,						//Page0
-	EEPROM_PAGE1			= EEPROM_START_ADDRESS + FLASH_PAGE_SIZE,	//Page1
+	EEPROM_PAGE1			= EEPROM_START_ADDRESS + FLASH_PAGE_SIZE,	//Page1 (further pages: EEPROM_PAGE_ADDRESS)
 	EEPROM_PAGE_NONE		= 0x00000000								//no page
 } EEPROM_Page;
 
@@ -53,7 +301,11 @@ typedef enum
 	EEPROM_NO_VALID_PAGE	= 0x04,										//Error: no valid page found
 	EEPROM_NOT_ASSIGNED		= 0x05,										//Error: variable was never assigned
 	EEPROM_INVALID_NAME		= 0x06,										//Error: variable name to high for variable count
-	EEPROM_FULL				= 0x07										//Error: EEPROM is full
+	EEPROM_FULL				= 0x07,										//Error: EEPROM is full
+	EEPROM_PENDING			= 0x08,										//page transfer or page erase still running, call EEPROM_Poll again
+	EEPROM_UNCHANGED		= 0x09,										//write skipped, value and size did not change (EEPROM_UpdateVariable, EEPROM_WriteBlob)
+	EEPROM_INVALID_SIZE		= 0x0A,										//Error: size not allowed (blob or counter size for a variable, 8 bit without inline record, blob longer than EEPROM_BLOB_MAX_SIZE, blob or counter in a transaction)
+	EEPROM_CORRUPTED		= 0x0B										//Error: CRC of the variable record is wrong (EEPROM_CRC_READ)
 } EEPROM_Result;
 
 //sizes ( halfwords = 2 ^ (size-1) )
@@ -62,14 +314,19 @@ typedef enum
 	EEPROM_SIZE_DELETED		= 0x00,										//variable is deleted (no size)
 	EEPROM_SIZE16			= 0x01,										//variable size = 16 bit = 1 Halfword
 	EEPROM_SIZE32			= 0x02,										//variable size = 32 bit = 2 Halfwords
-	EEPROM_SIZE64			= 0x03										//variable size = 64 bit = 4 Halfwords
+	EEPROM_SIZE64			= 0x03,										//variable size = 64 bit = 4 Halfwords
+	EEPROM_SIZE_BLOB		= 0x04,										//variable is a blob (only written by EEPROM_WriteBlob)
+	EEPROM_SIZE_COUNTER		= 0x05,										//variable is a counter (only written by EEPROM_IncrementCounter, read as 32 bit)
+	EEPROM_SIZE8			= 0x06										//variable size = 8 bit, stored in the record header (EEPROM_INLINE_VALUES)
 } EEPROM_Size;
 
 typedef union
  {
+	int8_t Int8;
 	int16_t Int16;
 	int32_t Int32;
 	int64_t Int64;
+	uint8_t uInt8;
 	uint16_t uInt16;
 	uint32_t uInt32;
 	uint64_t uInt64;
@@ -77,11 +334,249 @@ typedef union
 	double Double;
  } EEPROM_Value;
 
+//variable of a batch write (EEPROM_WriteVariables)
+typedef struct
+{
+	uint16_t Name;															//name (number) of the variable
+	EEPROM_Size Size;														//size of "Value"
+	EEPROM_Value Value;														//value to be written
+} EEPROM_Variable;
+
+//runtime statistics (EEPROM_GetStats, counters since EEPROM_Init, the flash counters need EEPROM_STATS)
+typedef struct
+{
+	uint32_t Writes;														//written variables (single and batch writes, deletes, blobs and counter increments)
+	uint32_t ElidedWrites;													//writes not programmed, because the value did not change
+	uint32_t HalfwordPrograms;												//programmed halfwords (records, transfers, checkpoints, page status and erase counts)
+	uint32_t PageErases;													//erased pages
+	uint32_t PageTransfers;													//started page transfers
+	uint32_t TransferBytes;													//bytes of the records carried forward by page transfers
+	float WriteAmplification;												//programmed bytes per byte of the records the application wrote (1.0: no overhead)
+	uint16_t PageFill;														//used bytes of the page written to (page header included)
+	uint16_t LiveBytes;														//bytes of the latest records of all variables (what page transfers keep)
+	uint32_t MaxWriteLatency;												//longest write call in EEPROM_TIMESTAMP units
+	uint16_t EraseCounts[EEPROM_MAX_PAGE_COUNT];							//erases of each page (persisted in the page header)
+	uint16_t QueueHighWater;												//most writes waiting in the ISR write queue at once (EEPROM_QUEUE_SIZE)
+	uint32_t QueueOverflows;												//writes lost to a full ISR write queue (rejected or overwritten)
+} EEPROM_Stats;
+
+//flash region of an instance (EEPROM_HandleInit), regions of different instances must not overlap
+typedef struct
+{
+	uint32_t StartAddress;													//address of the first page (page aligned)
+	uint8_t PageCount;														//number of pages (at least 2, at most EEPROM_MAX_PAGE_COUNT and 64 KByte)
+	uint16_t VariableCount;													//number of variables (sparse names: entries of the address index, at least 1, at most EEPROM_MAX_VARIABLE_COUNT)
+	uint16_t* Index;														//address index: VariableCount halfwords of caller storage
+	uint8_t* SizeTable;														//size table: VariableCount bytes of caller storage
+	uint8_t ClassCount;														//number of variable classes (0: one class on all pages, at most EEPROM_MAX_CLASS_COUNT)
+	const uint8_t* ClassPages;												//pages of each class (see EEPROM_CLASS_PAGES)
+	const uint16_t* ClassNames;												//first variable name of each class (see EEPROM_CLASS_NAMES)
+	EEPROM_Value* Shadow;													//shadow copy: VariableCount values of caller storage (EEPROM_SHADOW, else unused)
+	uint16_t* Names;														//sparse name table: VariableCount halfwords of caller storage (EEPROM_SPARSE_NAMES, else unused)
+} EEPROM_Region;
+
+//state of a variable class (the state of the selected class is only up to date in EEPROM_Handle)
+typedef struct
+{
+	uint32_t ValidPage;
+	uint32_t ActivePage;
+	uint32_t ReceivingPage;
+	uint32_t ErasedPage;
+	uint8_t ErasedCount;
+	uint32_t NextIndex;
+	uint16_t TransferName;
+	uint16_t TransferBytes;
+	uint8_t TransferMarked;
+	uint16_t CheckpointRecords;
+	uint8_t CheckpointSlots;
+	uint32_t ClassStart;
+	uint32_t ClassEnd;
+	uint16_t FirstName;
+	uint16_t EndName;
+} EEPROM_ClassState;
+
+//instance of the EEPROM emulation (set up by EEPROM_HandleInit, the fields are private to the library)
+typedef struct
+{
+	uint32_t StartAddress;													//region (see EEPROM_Region)
+	uint8_t PageCount;
+	uint16_t VariableCount;
+	uint8_t ClassCount;
+	uint8_t* SizeTable;														//SizeTable[i]: actual size of variable i (as EEPROM_Size)
+	uint16_t* Index;														//Index[i]: actual address of variable i (physical address = StartAddress + Index[i])
+																			//if Index[i] = 0 variable i not assigned
+#if EEPROM_SPARSE_NAMES
+	uint16_t* Names;														//Names[i]: name of the variable of entry i (sparse names: the arrays are indexed by entry)
+#endif
+	uint16_t LiveBytes[EEPROM_MAX_PAGE_COUNT];								//LiveBytes[i]: bytes of the latest records on page i (what its page transfer carries forward)
+
+	//page set and variables of the selected class (see EEPROM_CLASS_COUNT), the page status, next index, page transfer and checkpoint
+	//fields below refer to it, EEPROM_SelectClass swaps them with the state of another class
+	uint8_t Class;
+	uint32_t ClassStart;													//first page of the class
+	uint32_t ClassEnd;														//end address of the last page of the class
+	uint16_t FirstName;														//variable names of the class: FirstName ... EndName - 1
+	uint16_t EndName;
+
+	uint32_t ValidPage;														//oldest valid page (source of the next page transfer)
+	uint32_t ActivePage;													//newest valid page (variables are written here, if there is no receiving page)
+	uint32_t ReceivingPage;
+	uint32_t ErasedPage;													//next erased page following the newest page in ring order
+	uint8_t ErasedCount;													//number of erased pages
+
+	uint32_t NextIndex;
+
+	uint16_t TransferName;													//next variable (sparse names: entry) to check by the running page transfer
+	uint16_t TransferBytes;													//memory of the variables (and the marker) the running page transfer still has to write
+	uint8_t TransferMarked;													//transfer marker written to the receiving page (set by EEPROM_PageToIndex too)
+
+	uint32_t Writes;														//written variables (single and batch writes, deletes included)
+	uint32_t ElidedWrites;													//writes not programmed, because the value did not change (or a later batch entry overwrote it)
+
+	uint16_t CheckpointRecords;												//records written to the newest page since its latest checkpoint (a checkpoint is due at EEPROM_CHECKPOINT_INTERVAL)
+	uint8_t CheckpointSlots;												//used checkpoint slots of the newest page
+
+	EEPROM_ClassState Classes[EEPROM_MAX_CLASS_COUNT];						//state of each variable class
+
+#if EEPROM_STATS
+	uint32_t HalfwordPrograms;												//statistics (see EEPROM_Stats)
+	uint32_t PageErases;
+	uint32_t PageTransfers;
+	uint32_t CopiedBytes;													//bytes of the records carried forward by page transfers
+	uint32_t WrittenBytes;													//bytes of all written records (carried forward records included) and counter ticks
+	uint32_t MaxWriteLatency;
+	uint16_t EraseCounts[EEPROM_MAX_PAGE_COUNT];							//erase count of each page (copy of the page headers)
+#endif
+
+#if EEPROM_SHADOW
+	EEPROM_Value* Shadow;													//Shadow[i]: current value of variable i (zero-extended, 0 if not assigned or a blob)
+#endif
+
+#if EEPROM_CRC == EEPROM_CRC_READ
+	uint8_t Verified[(EEPROM_MAX_VARIABLE_COUNT + 7) / 8];					//bit i: CRC of the latest record of variable i checked
+#endif
+
+#if EEPROM_CACHE_SIZE > 0
+	uint16_t CacheName[EEPROM_CACHE_SIZE];									//dirty variables of the write-back cache (in order of their first write)
+	EEPROM_Value CacheValue[EEPROM_CACHE_SIZE];
+	uint8_t CacheSize[EEPROM_CACHE_SIZE];
+	uint8_t CacheCount;														//number of dirty variables
+	uint32_t CacheTick;														//HAL tick of the oldest dirty value (start of flush period)
+#endif
+
+#if EEPROM_QUEUE_SIZE > 0
+	volatile EEPROM_Variable Queue[EEPROM_QUEUE_SIZE];						//ISR write queue (ring, entry i % EEPROM_QUEUE_SIZE holds write number i)
+	volatile uint32_t QueueHead;											//writes queued (only changed by the producer)
+	volatile uint32_t QueueClaim;											//write being queued + 1 (its entry is overwritten until QueueHead catches up)
+	volatile uint32_t QueueTail;											//writes drained (only changed by the writer context)
+	volatile uint16_t QueueHighWater;
+	volatile uint32_t QueueOverflows;
+#endif
+
+#if EEPROM_TRANSACTION_SIZE > 0
+	EEPROM_Variable Transaction[EEPROM_TRANSACTION_SIZE];					//variables written by the open transaction (latest value of each name)
+	uint16_t TransactionIndex[EEPROM_TRANSACTION_SIZE];						//index entry and size of each variable before the transaction (restored by an abort)
+	uint8_t TransactionSize[EEPROM_TRANSACTION_SIZE];
+	uint8_t TransactionCount;												//number of variables written by the open transaction
+	uint8_t TransactionOpen;
+	uint8_t TransactionClass;												//class of the variables of the transaction
+	uint32_t TransactionHeader;												//address of the commit halfword (0: no record of the transaction in the index)
+	EEPROM_Result TransactionResult;										//error of a write that aborted the open transaction (returned by EEPROM_Commit)
+#endif
+} EEPROM_Handle;
+
 //----------------------------------------------public functions---------------------------------------------
 
+//default instance (region of the library configuration)
+
 EEPROM_Result EEPROM_Init();
 EEPROM_Result EEPROM_ReadVariable(uint16_t VariableName, EEPROM_Value* Value);
 EEPROM_Result EEPROM_WriteVariable(uint16_t VariableName, EEPROM_Value Value, EEPROM_Size Size);
+EEPROM_Result EEPROM_UpdateVariable(uint16_t VariableName, EEPROM_Value Value, EEPROM_Size Size);
 EEPROM_Result EEPROM_DeleteVariable(uint16_t VariableName);
+EEPROM_Result EEPROM_WriteVariables(const EEPROM_Variable* Variables, uint16_t Count);
+EEPROM_Result EEPROM_DeleteVariables(const uint16_t* VariableNames, uint16_t Count);
+EEPROM_Result EEPROM_WriteBlob(uint16_t VariableName, const void* Data, uint16_t Length);
+EEPROM_Result EEPROM_ReadBlob(uint16_t VariableName, const uint8_t** Data, uint16_t* Length);
+EEPROM_Result EEPROM_IncrementCounter(uint16_t VariableName, uint32_t* Value);
+EEPROM_Result EEPROM_Poll(uint16_t Budget);
+EEPROM_Result EEPROM_Flush();
+EEPROM_Result EEPROM_EmergencyFlush();
+EEPROM_Result EEPROM_WriteVariableFromISR(uint16_t VariableName, EEPROM_Value Value, EEPROM_Size Size);
+EEPROM_Result EEPROM_BeginTransaction();
+EEPROM_Result EEPROM_Commit();
+EEPROM_Result EEPROM_AbortTransaction();
+EEPROM_Result EEPROM_Compact(uint8_t Threshold);
+uint32_t EEPROM_GetFreeSpace();
+void EEPROM_GetWriteCounters(uint32_t* Writes, uint32_t* ElidedWrites);
+void EEPROM_GetStats(EEPROM_Stats* Stats);
+
+//instances (same functions on the region of the handle, EEPROM_EmergencyFlush only flushes the passed instance)
+EEPROM_Result EEPROM_HandleInit(EEPROM_Handle* Handle, const EEPROM_Region* Region);
+EEPROM_Result EEPROM_HandleReadVariable(EEPROM_Handle* Handle, uint16_t VariableName, EEPROM_Value* Value);
+EEPROM_Result EEPROM_HandleWriteVariable(EEPROM_Handle* Handle, uint16_t VariableName, EEPROM_Value Value, EEPROM_Size Size);
+EEPROM_Result EEPROM_HandleUpdateVariable(EEPROM_Handle* Handle, uint16_t VariableName, EEPROM_Value Value, EEPROM_Size Size);
+EEPROM_Result EEPROM_HandleDeleteVariable(EEPROM_Handle* Handle, uint16_t VariableName);
+EEPROM_Result EEPROM_HandleWriteVariables(EEPROM_Handle* Handle, const EEPROM_Variable* Variables, uint16_t Count);
+EEPROM_Result EEPROM_HandleDeleteVariables(EEPROM_Handle* Handle, const uint16_t* VariableNames, uint16_t Count);
+EEPROM_Result EEPROM_HandleWriteBlob(EEPROM_Handle* Handle, uint16_t VariableName, const void* Data, uint16_t Length);
+EEPROM_Result EEPROM_HandleReadBlob(EEPROM_Handle* Handle, uint16_t VariableName, const uint8_t** Data, uint16_t* Length);
+EEPROM_Result EEPROM_HandleIncrementCounter(EEPROM_Handle* Handle, uint16_t VariableName, uint32_t* Value);
+EEPROM_Result EEPROM_HandlePoll(EEPROM_Handle* Handle, uint16_t Budget);
+EEPROM_Result EEPROM_HandleFlush(EEPROM_Handle* Handle);
+EEPROM_Result EEPROM_HandleEmergencyFlush(EEPROM_Handle* Handle);
+EEPROM_Result EEPROM_HandleWriteVariableFromISR(EEPROM_Handle* Handle, uint16_t VariableName, EEPROM_Value Value, EEPROM_Size Size);
+EEPROM_Result EEPROM_HandleBeginTransaction(EEPROM_Handle* Handle);
+EEPROM_Result EEPROM_HandleCommit(EEPROM_Handle* Handle);
+EEPROM_Result EEPROM_HandleAbortTransaction(EEPROM_Handle* Handle);
+EEPROM_Result EEPROM_HandleCompact(EEPROM_Handle* Handle, uint8_t Threshold);
+uint32_t EEPROM_HandleGetFreeSpace(EEPROM_Handle* Handle);
+void EEPROM_HandleGetWriteCounters(EEPROM_Handle* Handle, uint32_t* Writes, uint32_t* ElidedWrites);
+void EEPROM_HandleGetStats(EEPROM_Handle* Handle, EEPROM_Stats* Stats);
+
+//sparse names (EEPROM_SPARSE_NAMES): entry of a variable name in a name table of "Count" entries (EEPROM_SLOT_NONE if the name has none)
+//the table is probed linearly from the hash of the name up to the name or an unused entry
+#if EEPROM_SPARSE_NAMES
+extern uint16_t EEPROM_DefaultNames[];
+
+static inline uint16_t EEPROM_FindSlot(const uint16_t* Names, uint16_t Count, uint16_t VariableName)
+{
+	uint16_t Slot = EEPROM_NAME_HASH(VariableName) % Count;
+	for (uint16_t i = 0; i < Count && Names[Slot] != EEPROM_SLOT_NONE; i++)
+	{
+		if (Names[Slot] == VariableName) return Slot;
+		if (++Slot == Count) Slot = 0;
+	}
+	return EEPROM_SLOT_NONE;
+}
+#endif
+
+//shadow copy (EEPROM_SHADOW): current value of a variable as plain RAM load, without checks (the name must exist,
+//a variable which is not assigned or a blob reads 0, use EEPROM_ReadVariable to tell them apart)
+#if EEPROM_SHADOW
+extern EEPROM_Value EEPROM_DefaultShadow[];
+
+static inline EEPROM_Value EEPROM_ReadShadow(uint16_t VariableName)
+{
+#if EEPROM_SPARSE_NAMES
+	uint16_t Slot = EEPROM_FindSlot(EEPROM_DefaultNames, EEPROM_VARIABLE_COUNT, VariableName);
+	EEPROM_Value Unassigned = {0};
+	return Slot != EEPROM_SLOT_NONE ? EEPROM_DefaultShadow[Slot] : Unassigned;
+#else
+	return EEPROM_DefaultShadow[VariableName];
+#endif
+}
+
+static inline EEPROM_Value EEPROM_HandleReadShadow(const EEPROM_Handle* Handle, uint16_t VariableName)
+{
+#if EEPROM_SPARSE_NAMES
+	uint16_t Slot = EEPROM_FindSlot(Handle->Names, Handle->VariableCount, VariableName);
+	EEPROM_Value Unassigned = {0};
+	return Slot != EEPROM_SLOT_NONE ? Handle->Shadow[Slot] : Unassigned;
+#else
+	return Handle->Shadow[VariableName];
+#endif
+}
+#endif
 
 #endif
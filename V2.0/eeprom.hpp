@@ -0,0 +1,227 @@
+//typed C++17 front end of the EEPROM emulation library for STM32F1XX with HAL-Driver (header only)
+//V2.0
+//
+//variables are declared as typed descriptors, the size code is derived from the type at compile time:
+//	using Brightness = EEPROM::Var<0, uint16_t>;
+//	using Gain = EEPROM::Var<1, float>;
+//	using Offset = EEPROM::Var<2, double>;
+//	using Boots = EEPROM::Counter<3>;
+//	using Serial = EEPROM::Blob<4, 16>;
+//	static_assert(EEPROM::Layout<Brightness, Gain, Offset, Boots, Serial>::Valid);	//checks names and space utilization ratio
+//
+//	Brightness::Write(800);
+//	float Value;
+//	if (Gain::Read(Value) == EEPROM_SUCCESS) ...
+//
+//every access compiles down to one call of the C API with a constant name and size (no runtime size dispatch)
+
+
+//define to prevent recursive inclusion
+#ifndef __EEPROM_HPP
+#define __EEPROM_HPP
+
+//includes
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+extern "C"
+{
+#include "eeprom.h"
+}
+
+//-------------------------------------------front end configuration-------------------------------------------
+
+//space utilization ratio ceiling in percent checked by EEPROM::Layout (see EEPROM_VARIABLE_COUNT in eeprom.h)
+//depending on your variable change rate, keep it below 50% with two pages, more pages allow higher ratios
+#ifndef EEPROM_UTILIZATION_CEILING
+#define EEPROM_UTILIZATION_CEILING	50
+#endif
+
+namespace EEPROM
+{
+
+//-------------------------------------------------constants-------------------------------------------------
+
+//bytes of the page header (page status, checkpoint slots, erase count)
+constexpr uint32_t PageHeaderBytes = 2 + (EEPROM_CHECKPOINT_INTERVAL > 0 ? 2 * EEPROM_CHECKPOINT_SLOTS : 0) + (EEPROM_STATS ? 2 : 0);
+
+//number of variable names (dense names: below EEPROM_VARIABLE_COUNT, sparse names: any 14 bit name below EEPROM_NAME_COUNT)
+constexpr uint16_t NameCount = EEPROM_SPARSE_NAMES ? EEPROM_NAME_COUNT : EEPROM_VARIABLE_COUNT;
+
+//bytes of the CRC of a record
+constexpr uint32_t CrcBytes = EEPROM_CRC ? 2 : 0;
+
+//size code of a value type (a value is stored in the smallest size holding it)
+template <typename T>
+constexpr EEPROM_Size SizeOf()
+{
+	static_assert(std::is_trivially_copyable_v<T>, "EEPROM variable type must be trivially copyable");
+	static_assert(sizeof(T) <= 8, "EEPROM variable type must not exceed 64 bit");
+	return sizeof(T) <= 2 ? EEPROM_SIZE16 : sizeof(T) <= 4 ? EEPROM_SIZE32 : EEPROM_SIZE64;
+}
+
+//---------------------------------------------variable descriptors--------------------------------------------
+
+//value variable (16, 32 or 64 bit, e.g. uint16_t, int32_t, float, double, an enum or a small struct,
+//EEPROM_INLINE_VALUES: an 8 bit type like bool or uint8_t with a name below EEPROM_INLINE_NAMES is stored in its record header)
+template <uint16_t Name, typename T>
+struct Var
+{
+	static_assert(Name < NameCount, "EEPROM variable name must be below EEPROM_VARIABLE_COUNT (sparse names: EEPROM_NAME_COUNT)");
+
+	using Type = T;
+	static constexpr uint16_t VariableName = Name;
+	static constexpr EEPROM_Size Size = EEPROM_INLINE_VALUES && sizeof(T) == 1 && Name < EEPROM_INLINE_NAMES ? EEPROM_SIZE8 : SizeOf<T>();
+	static constexpr uint32_t RecordBytes = (Size == EEPROM_SIZE8 ? 2 : 2 + (1U << Size)) + CrcBytes;
+
+	//reads the variable (Value is unchanged if the result is not EEPROM_SUCCESS)
+	static EEPROM_Result Read(T& Value)
+	{
+		EEPROM_Value Stored;
+		EEPROM_Result result = EEPROM_ReadVariable(Name, &Stored);
+		if (result == EEPROM_SUCCESS) std::memcpy(&Value, &Stored, sizeof(T));
+		return result;
+	}
+
+#if EEPROM_SHADOW
+	//reads the variable from the shadow copy without checks (EEPROM_ReadShadow, a variable which is not assigned reads 0)
+	static T Shadow()
+	{
+		EEPROM_Value Stored = EEPROM_ReadShadow(Name);
+		T Value;
+		std::memcpy(&Value, &Stored, sizeof(T));
+		return Value;
+	}
+#endif
+
+	//writes the variable (EEPROM_WriteVariable), if it changed (EEPROM_UpdateVariable)
+	static EEPROM_Result Write(const T& Value)
+	{
+		return EEPROM_WriteVariable(Name, Pack(Value), Size);
+	}
+
+	static EEPROM_Result Update(const T& Value)
+	{
+		return EEPROM_UpdateVariable(Name, Pack(Value), Size);
+	}
+
+	//queues the write from an interrupt handler (EEPROM_WriteVariableFromISR, see EEPROM_QUEUE_SIZE)
+	static EEPROM_Result WriteFromISR(const T& Value)
+	{
+		return EEPROM_WriteVariableFromISR(Name, Pack(Value), Size);
+	}
+
+	//deletes the variable
+	static EEPROM_Result Delete()
+	{
+		return EEPROM_DeleteVariable(Name);
+	}
+
+	//entry of a batch write (EEPROM_WriteVariables)
+	static EEPROM_Variable Entry(const T& Value)
+	{
+		return EEPROM_Variable{Name, Size, Pack(Value)};
+	}
+
+private:
+	static EEPROM_Value Pack(const T& Value)
+	{
+		EEPROM_Value Packed{};
+		std::memcpy(&Packed, &Value, sizeof(T));
+		return Packed;
+	}
+};
+
+//counter variable (EEPROM_IncrementCounter)
+template <uint16_t Name>
+struct Counter
+{
+	static_assert(Name < NameCount, "EEPROM variable name must be below EEPROM_VARIABLE_COUNT (sparse names: EEPROM_NAME_COUNT)");
+
+	static constexpr uint16_t VariableName = Name;
+	static constexpr uint32_t RecordBytes = 10 + 2 * EEPROM_COUNTER_TICKS + CrcBytes;
+
+	static EEPROM_Result Read(uint32_t& Value)
+	{
+		EEPROM_Value Stored;
+		EEPROM_Result result = EEPROM_ReadVariable(Name, &Stored);
+		if (result == EEPROM_SUCCESS) Value = Stored.uInt32;
+		return result;
+	}
+
+	static EEPROM_Result Increment(uint32_t* Value = nullptr)
+	{
+		return EEPROM_IncrementCounter(Name, Value);
+	}
+
+	static EEPROM_Result Delete()
+	{
+		return EEPROM_DeleteVariable(Name);
+	}
+};
+
+//blob variable of at most MaxLength bytes (EEPROM_WriteBlob, EEPROM_ReadBlob)
+template <uint16_t Name, uint16_t MaxLength>
+struct Blob
+{
+	static_assert(Name < NameCount, "EEPROM variable name must be below EEPROM_VARIABLE_COUNT (sparse names: EEPROM_NAME_COUNT)");
+	static_assert(MaxLength <= EEPROM_BLOB_MAX_SIZE, "EEPROM blob must not exceed EEPROM_BLOB_MAX_SIZE");
+
+	static constexpr uint16_t VariableName = Name;
+	static constexpr uint32_t RecordBytes = 6 + ((MaxLength + 1) & ~1U) + CrcBytes;
+
+	//reads the blob (zero-copy: Data points into flash until the next library call which writes to flash)
+	static EEPROM_Result Read(const uint8_t*& Data, uint16_t& Length)
+	{
+		return EEPROM_ReadBlob(Name, &Data, &Length);
+	}
+
+	static EEPROM_Result Write(const void* Data, uint16_t Length)
+	{
+		return Length > MaxLength ? EEPROM_INVALID_SIZE : EEPROM_WriteBlob(Name, Data, Length);
+	}
+
+	static EEPROM_Result Delete()
+	{
+		return EEPROM_DeleteVariable(Name);
+	}
+};
+
+//----------------------------------------------layout validation----------------------------------------------
+
+//set of all variables with a given space utilization ratio ceiling in percent
+//checks at compile time that names are unique and that page header and the largest record of every variable fit the ceiling
+template <uint32_t Ceiling, typename... Vars>
+struct BoundedLayout
+{
+	static constexpr uint32_t Bytes = PageHeaderBytes + (0 + ... + Vars::RecordBytes);
+	static constexpr float Utilization = static_cast<float>(Bytes) / FLASH_PAGE_SIZE;
+
+	static constexpr bool UniqueNames()
+	{
+		constexpr uint16_t Names[] = {Vars::VariableName..., 0};
+		for (uint32_t i = 0; i < sizeof...(Vars); i++)
+		{
+			for (uint32_t j = i + 1; j < sizeof...(Vars); j++)
+			{
+				if (Names[i] == Names[j]) return false;
+			}
+		}
+		return true;
+	}
+
+	static_assert(UniqueNames(), "EEPROM variable names must be unique");
+	static_assert(Bytes <= FLASH_PAGE_SIZE, "EEPROM variables don't fit on one page");
+	static_assert(Bytes * 100 <= Ceiling * FLASH_PAGE_SIZE, "EEPROM space utilization ratio exceeds the ceiling");
+
+	//true, if the checks above passed (use it in a static_assert to run them)
+	static constexpr bool Valid = true;
+};
+
+//set of all variables checked against EEPROM_UTILIZATION_CEILING
+template <typename... Vars>
+using Layout = BoundedLayout<EEPROM_UTILIZATION_CEILING, Vars...>;
+
+}
+
+#endif
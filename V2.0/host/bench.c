@@ -0,0 +1,591 @@
+//benchmark suite for the EEPROM emulation library on the host flash simulator
+//V2.0
+//
+//runs realistic write mixes against the library and reports per call:
+//halfword programs, page erases, page transfers, flash read accesses, modeled latency and stall of the code in flash bank 1 (and the RAM of the shadow copy)
+//usage: bench [writes per mix]
+
+
+//includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "eeprom.h"
+
+
+//variables carried forward per EEPROM_Poll call after each write (incremental page transfer)
+#ifndef BENCH_POLL_BUDGET
+#define BENCH_POLL_BUDGET		4
+#endif
+
+//idle time of the control loop after each write in ns (an asynchronous erase continues in the background meanwhile)
+#ifndef BENCH_IDLE_TIME
+#define BENCH_IDLE_TIME			50000000
+#endif
+
+//blob scenario: number of blob variables and maximum blob length in bytes
+#ifndef BENCH_BLOB_COUNT
+#define BENCH_BLOB_COUNT		4
+#endif
+#ifndef BENCH_BLOB_SIZE
+#define BENCH_BLOB_SIZE			32
+#endif
+
+//variable name of bench variable i (sparse names: spread over the 14 bit name space in ascending order, 8 names per 256)
+#if EEPROM_SPARSE_NAMES
+#define BENCH_NAME(i)			(0x1000 + ((i) / 8) * 0x100 + (i) % 8)
+#else
+#define BENCH_NAME(i)			(i)
+#endif
+
+//operation statistics of one library function
+typedef struct
+{
+	uint64_t Calls;
+	uint64_t HalfwordPrograms;
+	uint64_t MaxHalfwordPrograms;
+	uint64_t PageErases;
+	uint64_t Transfers;
+	uint64_t Reads;
+	uint64_t Time;
+	uint64_t MaxTime;
+	uint64_t Stall;
+	uint64_t MaxStall;
+} BENCH_Stats;
+
+//write mix: how variable names are picked and which size they have
+typedef enum
+{
+	BENCH_MIX_COUNTER,															//one 16 bit counter updated all the time
+	BENCH_MIX_CONFIG,															//mixed sizes, few hot variables, rest updated rarely
+	BENCH_MIX_UNIFORM,															//mixed sizes, every variable updated equally often
+	BENCH_MIX_WIDE,																//only 64 bit variables, every variable updated equally often
+	BENCH_MIX_REFRESH,															//like uniform, but 90% of the writes repeat the current value ("just in case" writes)
+	BENCH_MIX_HOTCOLD															//mixed sizes, 99% of the writes on 4 hot variables, the rest (calibration) written rarely
+} BENCH_Mix;
+
+static const char* BENCH_MixNames[] = {"counter", "config", "uniform", "wide", "refresh", "hotcold"};
+
+
+//global variables
+static uint64_t BENCH_Transfers = 0;											//page transfers seen by the program hook
+static uint64_t BENCH_TransfersBefore;
+static FLASHSIM_Counters BENCH_Before;
+static uint32_t BENCH_Random = 0x12345678;
+static EEPROM_Value BENCH_Expected[EEPROM_VARIABLE_COUNT];
+static uint8_t BENCH_ExpectedSize[EEPROM_VARIABLE_COUNT];
+
+
+// counts page transfers: a transfer starts when an erased page is marked as receiving
+static void BENCH_ProgramHook(uint32_t Address, uint16_t Data)
+{
+	if (Data == EEPROM_RECEIVING && Address >= EEPROM_START_ADDRESS && (Address - EEPROM_START_ADDRESS) % FLASH_PAGE_SIZE == 0) BENCH_Transfers++;
+}
+
+
+// xorshift32 pseudo random numbers (reproducible runs)
+static uint32_t BENCH_Rand(void)
+{
+	BENCH_Random ^= BENCH_Random << 13;
+	BENCH_Random ^= BENCH_Random >> 17;
+	BENCH_Random ^= BENCH_Random << 5;
+	return BENCH_Random;
+}
+
+
+// starts / ends the measurement of one library call
+static void BENCH_Begin(void)
+{
+	FLASHSIM_GetCounters(&BENCH_Before);
+	BENCH_TransfersBefore = BENCH_Transfers;
+}
+
+static void BENCH_End(BENCH_Stats* Stats)
+{
+	FLASHSIM_Counters After;
+	FLASHSIM_GetCounters(&After);
+
+	uint64_t HalfwordPrograms = After.HalfwordPrograms - BENCH_Before.HalfwordPrograms;
+	uint64_t Time = After.Time - BENCH_Before.Time;
+	uint64_t Stall = After.CodeStall - BENCH_Before.CodeStall;
+
+	Stats->Calls++;
+	Stats->HalfwordPrograms += HalfwordPrograms;
+	Stats->PageErases += After.PageErases - BENCH_Before.PageErases;
+	Stats->Transfers += BENCH_Transfers - BENCH_TransfersBefore;
+	Stats->Reads += After.Reads - BENCH_Before.Reads;
+	Stats->Time += Time;
+	if (HalfwordPrograms > Stats->MaxHalfwordPrograms) Stats->MaxHalfwordPrograms = HalfwordPrograms;
+	if (Time > Stats->MaxTime) Stats->MaxTime = Time;
+	Stats->Stall += Stall;
+	if (Stall > Stats->MaxStall) Stats->MaxStall = Stall;
+}
+
+
+// lets the idle time of the control loop pass and counts the page erases which ended meanwhile
+static void BENCH_Idle(BENCH_Stats* Stats)
+{
+	FLASHSIM_Counters Before, After;
+	FLASHSIM_GetCounters(&Before);
+	FLASHSIM_Elapse(BENCH_IDLE_TIME);
+	FLASHSIM_GetCounters(&After);
+
+	Stats->Calls++;
+	Stats->PageErases += After.PageErases - Before.PageErases;
+}
+
+
+// prints one result line
+static void BENCH_Print(const char* Mix, const char* Function, const BENCH_Stats* Stats)
+{
+	if (Stats->Calls == 0) return;
+	double Calls = (double) Stats->Calls;
+	printf("%-10s %-16s %8llu %9.3f %7llu %8llu %9llu %8.2f %10.2f %10.2f %10.2f %10.2f\n", Mix, Function,
+		(unsigned long long) Stats->Calls, Stats->HalfwordPrograms / Calls, (unsigned long long) Stats->MaxHalfwordPrograms,
+		(unsigned long long) Stats->PageErases, (unsigned long long) Stats->Transfers, Stats->Reads / Calls,
+		Stats->Time / Calls / 1000.0, Stats->MaxTime / 1000.0, Stats->Stall / Calls / 1000.0, Stats->MaxStall / 1000.0);
+}
+
+
+// prints the library statistics of the write phase (EEPROM_STATS)
+static void BENCH_PrintStats(const char* Mix, const EEPROM_Stats* Stats)
+{
+	uint16_t MinErases = 0xFFFF, MaxErases = 0;
+	for (uint8_t i = 0; i < EEPROM_PAGE_COUNT; i++)
+	{
+		if (Stats->EraseCounts[i] < MinErases) MinErases = Stats->EraseCounts[i];
+		if (Stats->EraseCounts[i] > MaxErases) MaxErases = Stats->EraseCounts[i];
+	}
+	printf("%-10s %-16s WA %.2f, %u transfers (%u B copied), %u erases (%u..%u per page), fill %u B, live %u B, max write %u us\n", Mix, "(stats)",
+		Stats->WriteAmplification, (unsigned) Stats->PageTransfers, (unsigned) Stats->TransferBytes, (unsigned) Stats->PageErases, MinErases, MaxErases,
+		Stats->PageFill, Stats->LiveBytes, (unsigned) Stats->MaxWriteLatency);
+}
+
+
+// prints the programming overhead of a whole mix since FLASHSIM_Reset (HAL_FLASH_Program calls and bursts, EEPROM_BURST_PROGRAM)
+static void BENCH_PrintProgramming(const char* Mix)
+{
+	FLASHSIM_Counters Counters;
+	FLASHSIM_GetCounters(&Counters);
+	if (Counters.HalfwordPrograms == 0) return;
+	printf("%-10s %-16s %llu hw: %llu program calls, %llu bursts (%.1f hw each), overhead %.3f us/hw\n", Mix, "(programming)",
+		(unsigned long long) Counters.HalfwordPrograms, (unsigned long long) Counters.ProgramCalls, (unsigned long long) Counters.BurstCalls,
+		Counters.BurstCalls != 0 ? (double) Counters.BurstHalfwords / Counters.BurstCalls : 0.0, Counters.ProgramOverhead / 1000.0 / Counters.HalfwordPrograms);
+}
+
+
+// picks the next variable of a write mix
+// - name: one variable, skewed (60% name 0, 25% name 1, 15% rest), hot and cold (99% names 0..3, 1% rest) or uniform
+// - size: as in project.c (16, 32, 64, 32, ...) or always 64 bit
+static uint16_t BENCH_PickName(BENCH_Mix Mix)
+{
+	uint32_t Random = BENCH_Rand();
+	uint16_t Hot = EEPROM_VARIABLE_COUNT < 4 ? EEPROM_VARIABLE_COUNT : 4;
+	switch (Mix)
+	{
+		case BENCH_MIX_COUNTER: return 0;
+		case BENCH_MIX_CONFIG:
+			if (Random % 100 < 60 || EEPROM_VARIABLE_COUNT < 2) return 0;
+			if (Random % 100 < 85 || EEPROM_VARIABLE_COUNT < 3) return 1;
+			return 2 + (Random >> 8) % (EEPROM_VARIABLE_COUNT - 2);
+		case BENCH_MIX_HOTCOLD:
+			if (Random % 100 < 99 || EEPROM_VARIABLE_COUNT == Hot) return (Random >> 8) % Hot;
+			return Hot + (Random >> 8) % (EEPROM_VARIABLE_COUNT - Hot);
+		default: return Random % EEPROM_VARIABLE_COUNT;
+	}
+}
+
+static EEPROM_Size BENCH_PickSize(BENCH_Mix Mix, uint16_t Name)
+{
+	static const EEPROM_Size Sizes[] = {EEPROM_SIZE16, EEPROM_SIZE32, EEPROM_SIZE64, EEPROM_SIZE32};
+	if (Mix == BENCH_MIX_WIDE) return EEPROM_SIZE64;
+	if (EEPROM_INLINE_VALUES && Sizes[Name % 4] == EEPROM_SIZE16 && BENCH_NAME(Name) < EEPROM_INLINE_NAMES) return EEPROM_SIZE8;
+	return Sizes[Name % 4];
+}
+
+
+// checks that every variable holds the last written value (results of a broken engine are worthless)
+static void BENCH_Verify(const char* Mix)
+{
+	EEPROM_Value Value;
+	for (uint16_t i = 0; i < EEPROM_VARIABLE_COUNT; i++)
+	{
+		EEPROM_Result result = EEPROM_ReadVariable(BENCH_NAME(i), &Value);
+		if (BENCH_ExpectedSize[i] == EEPROM_SIZE_DELETED)
+		{
+			if (result == EEPROM_NOT_ASSIGNED) continue;
+		}
+		else if (result == EEPROM_SUCCESS)
+		{
+			uint64_t Mask = BENCH_ExpectedSize[i] == EEPROM_SIZE64 ? ~0ull : BENCH_ExpectedSize[i] == EEPROM_SIZE8 ? 0xFF : (1ull << (8 << BENCH_ExpectedSize[i])) - 1;
+#if EEPROM_SHADOW
+			if (EEPROM_ReadShadow(BENCH_NAME(i)).uInt64 != (BENCH_Expected[i].uInt64 & Mask)) { fprintf(stderr, "bench: %s: shadow copy of variable %u out of sync\n", Mix, i); exit(1); }
+#endif
+			if (((Value.uInt64 ^ BENCH_Expected[i].uInt64) & Mask) == 0) continue;
+		}
+		fprintf(stderr, "bench: %s: variable %u lost its value (result %d)\n", Mix, i, result);
+		exit(1);
+	}
+}
+
+
+// runs one write mix
+// - format the blank flash (EEPROM_Init)
+// - write random values to the variables picked by the mix (poll a running page transfer and idle after each write)
+// - read random variables (and their shadow copy, EEPROM_SHADOW)
+// - flush the write-back cache, reinitialize from the used flash (EEPROM_Init) and verify all values
+// - restore every variable with one batch write (configuration restore), reinitialize and verify all values
+static void BENCH_Run(BENCH_Mix Mix, uint32_t Writes)
+{
+	BENCH_Stats InitBlank = {0}, Write = {0}, Poll = {0}, Idle = {0}, Read = {0}, Shadow = {0}, Flush = {0}, InitUsed = {0}, Restore = {0};
+	EEPROM_Value Value;
+	EEPROM_Variable Batch[EEPROM_VARIABLE_COUNT];
+
+	FLASHSIM_Reset();
+	memset(BENCH_ExpectedSize, EEPROM_SIZE_DELETED, sizeof(BENCH_ExpectedSize));
+
+	BENCH_Begin();
+	if (EEPROM_Init() != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_Init failed\n"); exit(1); }
+	BENCH_End(&InitBlank);
+
+	for (uint32_t i = 0; i < Writes; i++)
+	{
+		uint16_t Name = BENCH_PickName(Mix);
+		EEPROM_Size Size = BENCH_PickSize(Mix, Name);
+		Value.uInt64 = ((uint64_t) BENCH_Rand() << 32) | BENCH_Rand();
+		if (Mix == BENCH_MIX_REFRESH && BENCH_ExpectedSize[Name] == Size && Value.uInt32 % 10 != 0) Value = BENCH_Expected[Name];
+
+		BENCH_Begin();
+		EEPROM_Result result = EEPROM_WriteVariable(BENCH_NAME(Name), Value, Size);
+		BENCH_End(&Write);
+
+		if (result != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_WriteVariable failed (%d)\n", result); exit(1); }
+		BENCH_Expected[Name] = Value;
+		BENCH_ExpectedSize[Name] = Size;
+
+		//continue running page transfer (pre-compaction: start it) and flush the write-back cache between writes (idle time of the control loop)
+		if (EEPROM_INCREMENTAL_TRANSFER || EEPROM_CACHE_SIZE > 0 || EEPROM_COMPACT_THRESHOLD > 0)
+		{
+			BENCH_Begin();
+			result = EEPROM_Poll(BENCH_POLL_BUDGET);
+			BENCH_End(&Poll);
+
+			if (result != EEPROM_SUCCESS && result != EEPROM_PENDING) { fprintf(stderr, "bench: EEPROM_Poll failed (%d)\n", result); exit(1); }
+		}
+
+		BENCH_Idle(&Idle);
+	}
+
+	uint32_t WriteCalls, ElidedWrites;
+	EEPROM_GetWriteCounters(&WriteCalls, &ElidedWrites);
+	EEPROM_Stats Stats;
+	EEPROM_GetStats(&Stats);
+
+	for (uint32_t i = 0; i < Writes; i++)
+	{
+		BENCH_Begin();
+		EEPROM_ReadVariable(BENCH_NAME(BENCH_Rand() % EEPROM_VARIABLE_COUNT), &Value);
+		BENCH_End(&Read);
+	}
+#if EEPROM_SHADOW
+	for (uint32_t i = 0; i < Writes; i++)
+	{
+		BENCH_Begin();
+		Value = EEPROM_ReadShadow(BENCH_NAME(BENCH_Rand() % EEPROM_VARIABLE_COUNT));
+		BENCH_End(&Shadow);
+	}
+#endif
+
+	BENCH_Begin();
+	if (EEPROM_Flush() != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_Flush failed\n"); exit(1); }
+	BENCH_End(&Flush);
+
+	BENCH_Begin();
+	if (EEPROM_Init() != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_Init failed\n"); exit(1); }
+	BENCH_End(&InitUsed);
+	BENCH_Verify(BENCH_MixNames[Mix]);
+
+	for (uint16_t i = 0; i < EEPROM_VARIABLE_COUNT; i++)
+	{
+		Batch[i].Name = BENCH_NAME(i);
+		Batch[i].Size = BENCH_PickSize(Mix, i);
+		Batch[i].Value.uInt64 = ((uint64_t) BENCH_Rand() << 32) | BENCH_Rand();
+		BENCH_Expected[i] = Batch[i].Value;
+		BENCH_ExpectedSize[i] = Batch[i].Size;
+	}
+	BENCH_Begin();
+	EEPROM_Result result = EEPROM_WriteVariables(Batch, EEPROM_VARIABLE_COUNT);
+	BENCH_End(&Restore);
+	if (result != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_WriteVariables failed (%d)\n", result); exit(1); }
+	while (EEPROM_Poll(EEPROM_VARIABLE_COUNT) == EEPROM_PENDING) FLASHSIM_Elapse(BENCH_IDLE_TIME);
+	if (EEPROM_Init() != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_Init failed\n"); exit(1); }
+	BENCH_Verify(BENCH_MixNames[Mix]);
+
+	BENCH_Print(BENCH_MixNames[Mix], "Init (blank)", &InitBlank);
+	BENCH_Print(BENCH_MixNames[Mix], "WriteVariable", &Write);
+	BENCH_Print(BENCH_MixNames[Mix], "Poll", &Poll);
+	if (Idle.PageErases != 0) BENCH_Print(BENCH_MixNames[Mix], "(idle)", &Idle);
+	BENCH_Print(BENCH_MixNames[Mix], "ReadVariable", &Read);
+	BENCH_Print(BENCH_MixNames[Mix], "ReadShadow", &Shadow);
+	if (EEPROM_CACHE_SIZE > 0) BENCH_Print(BENCH_MixNames[Mix], "Flush", &Flush);
+	BENCH_Print(BENCH_MixNames[Mix], "Init (used)", &InitUsed);
+	BENCH_Print(BENCH_MixNames[Mix], "WriteVariables", &Restore);
+	if (ElidedWrites != 0) printf("%-10s %-16s %8u\n", BENCH_MixNames[Mix], "(elided writes)", (unsigned) ElidedWrites);
+	if (EEPROM_STATS) BENCH_PrintStats(BENCH_MixNames[Mix], &Stats);
+	BENCH_PrintProgramming(BENCH_MixNames[Mix]);
+}
+
+
+// measures EEPROM_Init on a half-full and a full page (one variable rewritten until the page holds the wanted number of records)
+static void BENCH_InitFill(void)
+{
+	static const EEPROM_Size Sizes[] = {EEPROM_SIZE16, EEPROM_SIZE64};
+	static const char* Names[] = {"Init (16b, 50%)", "Init (16b, 100%)", "Init (64b, 50%)", "Init (64b, 100%)"};
+	EEPROM_Value Value;
+
+	for (uint8_t s = 0; s < 2; s++)
+	{
+		for (uint8_t Fill = 1; Fill <= 2; Fill++)
+		{
+			BENCH_Stats Init = {0};
+			uint32_t Records = (FLASH_PAGE_SIZE - 2) / (2 + (1 << Sizes[s])) * Fill / 2;
+
+			FLASHSIM_Reset();
+			memset(BENCH_ExpectedSize, EEPROM_SIZE_DELETED, sizeof(BENCH_ExpectedSize));
+			if (EEPROM_Init() != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_Init failed\n"); exit(1); }
+			for (uint32_t i = 0; i < Records; i++)
+			{
+				Value.uInt64 = ((uint64_t) BENCH_Rand() << 32) | BENCH_Rand();
+				if (EEPROM_WriteVariable(BENCH_NAME(0), Value, Sizes[s]) != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_WriteVariable failed\n"); exit(1); }
+				BENCH_Expected[0] = Value;
+				BENCH_ExpectedSize[0] = Sizes[s];
+			}
+			if (EEPROM_Flush() != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_Flush failed\n"); exit(1); }
+
+			BENCH_Begin();
+			if (EEPROM_Init() != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_Init failed\n"); exit(1); }
+			BENCH_End(&Init);
+			BENCH_Verify("fill");
+
+			BENCH_Print("fill", Names[s * 2 + Fill - 1], &Init);
+		}
+	}
+}
+
+
+// runs blob writes: blobs of 1 to BENCH_BLOB_SIZE bytes round robin on the first BENCH_BLOB_COUNT variables
+// - format the blank flash (EEPROM_Init)
+// - write random blobs (poll a running page transfer and idle after each write)
+// - read random blobs (zero-copy)
+// - reinitialize from the used flash (EEPROM_Init) and verify all blobs
+static void BENCH_Blob(uint32_t Writes)
+{
+	BENCH_Stats Write = {0}, Poll = {0}, Idle = {0}, Read = {0}, InitUsed = {0};
+	uint8_t Expected[BENCH_BLOB_COUNT][BENCH_BLOB_SIZE];
+	uint16_t ExpectedLength[BENCH_BLOB_COUNT];
+	const uint8_t* Data;
+	uint16_t Length;
+
+	FLASHSIM_Reset();
+	if (EEPROM_Init() != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_Init failed\n"); exit(1); }
+
+	for (uint32_t i = 0; i < Writes; i++)
+	{
+		uint16_t Name = i % BENCH_BLOB_COUNT;
+		ExpectedLength[Name] = 1 + BENCH_Rand() % BENCH_BLOB_SIZE;
+		for (uint16_t j = 0; j < ExpectedLength[Name]; j++) Expected[Name][j] = (uint8_t) BENCH_Rand();
+
+		BENCH_Begin();
+		EEPROM_Result result = EEPROM_WriteBlob(BENCH_NAME(Name), Expected[Name], ExpectedLength[Name]);
+		BENCH_End(&Write);
+		if (result != EEPROM_SUCCESS && result != EEPROM_UNCHANGED) { fprintf(stderr, "bench: EEPROM_WriteBlob failed (%d)\n", result); exit(1); }
+
+		if (EEPROM_INCREMENTAL_TRANSFER || EEPROM_CACHE_SIZE > 0 || EEPROM_COMPACT_THRESHOLD > 0)
+		{
+			BENCH_Begin();
+			result = EEPROM_Poll(BENCH_POLL_BUDGET);
+			BENCH_End(&Poll);
+			if (result != EEPROM_SUCCESS && result != EEPROM_PENDING) { fprintf(stderr, "bench: EEPROM_Poll failed (%d)\n", result); exit(1); }
+		}
+
+		BENCH_Idle(&Idle);
+	}
+
+	for (uint32_t i = 0; i < Writes; i++)
+	{
+		BENCH_Begin();
+		EEPROM_ReadBlob(BENCH_NAME(BENCH_Rand() % BENCH_BLOB_COUNT), &Data, &Length);
+		BENCH_End(&Read);
+	}
+
+	BENCH_Begin();
+	if (EEPROM_Init() != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_Init failed\n"); exit(1); }
+	BENCH_End(&InitUsed);
+	for (uint16_t i = 0; i < BENCH_BLOB_COUNT && i < Writes; i++)
+	{
+		EEPROM_Result result = EEPROM_ReadBlob(BENCH_NAME(i), &Data, &Length);
+		if (result != EEPROM_SUCCESS || Length != ExpectedLength[i] || memcmp(Data, Expected[i], Length) != 0)
+		{
+			fprintf(stderr, "bench: blob: variable %u lost its value (result %d)\n", i, result);
+			exit(1);
+		}
+	}
+
+	BENCH_Print("blob", "WriteBlob", &Write);
+	BENCH_Print("blob", "Poll", &Poll);
+	if (Idle.PageErases != 0) BENCH_Print("blob", "(idle)", &Idle);
+	BENCH_Print("blob", "ReadBlob", &Read);
+	BENCH_Print("blob", "Init (used)", &InitUsed);
+}
+
+
+// runs a boot / event counter: increments of one variable as 32 bit value and as counter record
+// - format the blank flash, increment the counter with EEPROM_WriteVariable (poll and idle after each write)
+// - format the blank flash, increment the counter with EEPROM_IncrementCounter (poll and idle after each write)
+// - reinitialize from the used flash (EEPROM_Init) and verify the counter
+static void BENCH_Counter(uint32_t Writes)
+{
+	BENCH_Stats Write = {0}, Increment = {0}, Idle = {0}, InitUsed = {0};
+	EEPROM_Value Value;
+	uint32_t Counter = 0;
+
+	for (uint8_t Mode = 0; Mode < 2; Mode++)
+	{
+		FLASHSIM_Reset();
+		if (EEPROM_Init() != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_Init failed\n"); exit(1); }
+
+		for (uint32_t i = 0; i < Writes; i++)
+		{
+			EEPROM_Result result;
+			BENCH_Begin();
+			if (Mode == 0)
+			{
+				Value.uInt32 = i + 1;
+				result = EEPROM_WriteVariable(BENCH_NAME(0), Value, EEPROM_SIZE32);
+				BENCH_End(&Write);
+			}
+			else
+			{
+				result = EEPROM_IncrementCounter(BENCH_NAME(0), &Counter);
+				BENCH_End(&Increment);
+				if (Counter != i + 1) result = EEPROM_ERROR;
+			}
+			if (result != EEPROM_SUCCESS) { fprintf(stderr, "bench: counter increment failed (%d)\n", result); exit(1); }
+
+			if (EEPROM_INCREMENTAL_TRANSFER || EEPROM_CACHE_SIZE > 0 || EEPROM_COMPACT_THRESHOLD > 0)
+			{
+				result = EEPROM_Poll(BENCH_POLL_BUDGET);
+				if (result != EEPROM_SUCCESS && result != EEPROM_PENDING) { fprintf(stderr, "bench: EEPROM_Poll failed (%d)\n", result); exit(1); }
+			}
+			BENCH_Idle(&Idle);
+		}
+	}
+
+	if (EEPROM_Flush() != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_Flush failed\n"); exit(1); }
+	BENCH_Begin();
+	if (EEPROM_Init() != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_Init failed\n"); exit(1); }
+	BENCH_End(&InitUsed);
+	if (EEPROM_ReadVariable(BENCH_NAME(0), &Value) != EEPROM_SUCCESS || Value.uInt32 != Writes) { fprintf(stderr, "bench: increment: counter lost its value\n"); exit(1); }
+
+	BENCH_Print("increment", "WriteVariable", &Write);
+	BENCH_Print("increment", "IncrementCounter", &Increment);
+	BENCH_Print("increment", "Init (used)", &InitUsed);
+}
+
+
+// runs sensor writes of an interrupt handler: bursts queued by EEPROM_WriteVariableFromISR (ISR write queue)
+// - format the blank flash (EEPROM_Init)
+// - queue a burst of 1 to EEPROM_QUEUE_SIZE writes picked by the config mix, drain the queue with EEPROM_Poll and idle after each burst
+// - drain the queue (EEPROM_Flush), reinitialize from the used flash (EEPROM_Init) and verify all values
+#if EEPROM_QUEUE_SIZE > 0
+static void BENCH_Queue(uint32_t Writes)
+{
+	BENCH_Stats Queue = {0}, Poll = {0}, Idle = {0};
+	EEPROM_Value Value;
+
+	FLASHSIM_Reset();
+	memset(BENCH_ExpectedSize, EEPROM_SIZE_DELETED, sizeof(BENCH_ExpectedSize));
+	if (EEPROM_Init() != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_Init failed\n"); exit(1); }
+
+	for (uint32_t i = 0; i < Writes; )
+	{
+		uint32_t Burst = 1 + BENCH_Rand() % EEPROM_QUEUE_SIZE;
+		for (uint32_t j = 0; j < Burst && i < Writes; j++, i++)
+		{
+			uint16_t Name = BENCH_PickName(BENCH_MIX_CONFIG);
+			EEPROM_Size Size = BENCH_PickSize(BENCH_MIX_CONFIG, Name);
+			Value.uInt64 = ((uint64_t) BENCH_Rand() << 32) | BENCH_Rand();
+
+			BENCH_Begin();
+			EEPROM_Result result = EEPROM_WriteVariableFromISR(BENCH_NAME(Name), Value, Size);
+			BENCH_End(&Queue);
+
+			if (result != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_WriteVariableFromISR failed (%d)\n", result); exit(1); }
+			BENCH_Expected[Name] = Value;
+			BENCH_ExpectedSize[Name] = Size;
+		}
+
+		BENCH_Begin();
+		EEPROM_Result result = EEPROM_Poll(BENCH_POLL_BUDGET);
+		BENCH_End(&Poll);
+
+		if (result != EEPROM_SUCCESS && result != EEPROM_PENDING) { fprintf(stderr, "bench: EEPROM_Poll failed (%d)\n", result); exit(1); }
+		BENCH_Idle(&Idle);
+	}
+
+	EEPROM_Stats Stats;
+	EEPROM_GetStats(&Stats);
+	if (EEPROM_Flush() != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_Flush failed\n"); exit(1); }
+	while (EEPROM_Poll(EEPROM_VARIABLE_COUNT) == EEPROM_PENDING) FLASHSIM_Elapse(BENCH_IDLE_TIME);
+	if (EEPROM_Init() != EEPROM_SUCCESS) { fprintf(stderr, "bench: EEPROM_Init failed\n"); exit(1); }
+	BENCH_Verify("isr");
+
+	BENCH_Print("isr", "WriteFromISR", &Queue);
+	BENCH_Print("isr", "Poll (drain)", &Poll);
+	if (Idle.PageErases != 0) BENCH_Print("isr", "(idle)", &Idle);
+	printf("%-10s %-16s high water %u of %u, %u overflows, %u coalesced or unchanged\n", "isr", "(queue)", Stats.QueueHighWater,
+		(unsigned) EEPROM_QUEUE_SIZE, (unsigned) Stats.QueueOverflows, (unsigned) Stats.ElidedWrites);
+}
+#endif
+
+
+int main(int argc, char** argv)
+{
+	uint32_t Writes = 20000;
+	if (argc > 1) Writes = (uint32_t) strtoul(argv[1], NULL, 0);
+
+	FLASHSIM_Timing Timing;
+	FLASHSIM_GetTiming(&Timing);
+	FLASHSIM_SetProgramHook(BENCH_ProgramHook);
+
+	printf("%u pages of %u B, %u variables, %u writes per mix\n", (unsigned) EEPROM_PAGE_COUNT, (unsigned) FLASH_PAGE_SIZE, (unsigned) EEPROM_VARIABLE_COUNT, (unsigned) Writes);
+	printf("timing: program %.1f us/halfword, erase %.1f ms/page, %.1f us/program call, %.3f us/read, %.1f ms idle/write\n\n",
+		Timing.ProgramHalfword / 1000.0, Timing.ErasePage / 1000000.0, Timing.ProgramCall / 1000.0, Timing.ReadAccess / 1000.0, BENCH_IDLE_TIME / 1000000.0);
+#if EEPROM_BURST_PROGRAM
+	printf("burst programming: %.1f us to enter program mode, %.3f us/halfword in it\n\n", Timing.ProgramCall / 1000.0, Timing.BurstHalfword / 1000.0);
+#endif
+#ifdef FLASH_BANK2_END
+	printf("pages in bank %u at 0x%08X, code in bank 1 (stall: time the code in bank 1 can't execute)\n\n", EEPROM_START_ADDRESS > FLASH_BANK1_END ? 2 : 1,
+		(unsigned) EEPROM_START_ADDRESS);
+#endif
+#if EEPROM_SHADOW
+	printf("shadow copy: %u B of RAM (%u B per variable), reads without flash access\n\n", (unsigned) sizeof(EEPROM_DefaultShadow[0]) * EEPROM_VARIABLE_COUNT,
+		(unsigned) sizeof(EEPROM_DefaultShadow[0]));
+#endif
+#if EEPROM_SPARSE_NAMES
+	printf("sparse names: %u entries for names 0x%04X ... 0x%04X, name table %u B of RAM\n\n", (unsigned) EEPROM_VARIABLE_COUNT, (unsigned) BENCH_NAME(0),
+		(unsigned) BENCH_NAME(EEPROM_VARIABLE_COUNT - 1), (unsigned) sizeof(EEPROM_DefaultNames[0]) * EEPROM_VARIABLE_COUNT);
+#endif
+	printf("%-10s %-16s %8s %9s %7s %8s %9s %8s %10s %10s %10s %10s\n", "mix", "function", "calls", "hw/call", "max hw", "erases", "transfers", "reads",
+		"avg us", "max us", "stall us", "max stall");
+
+	for (BENCH_Mix Mix = BENCH_MIX_COUNTER; Mix <= BENCH_MIX_HOTCOLD; Mix++) BENCH_Run(Mix, Writes);
+	BENCH_InitFill();
+	BENCH_Blob(Writes);
+	BENCH_Counter(Writes);
+#if EEPROM_QUEUE_SIZE > 0
+	BENCH_Queue(Writes);
+#endif
+
+	return 0;
+}
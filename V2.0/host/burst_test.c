@@ -0,0 +1,134 @@
+//tests of the error flag checks of the burst programming (EEPROM_BURST_PROGRAM) on the host flash simulator
+//V2.0
+//
+//a halfword ahead of the write position is programmed beforehand (like a flash defect), so its programming in a burst fails
+//and only the error flags report it: checks that a batch write and a page transfer stop at the failed record with EEPROM_ERROR,
+//that every variable still reads its last written value (the failed record doesn't enter the index), that the values survive
+//a reset and that the writes and the page transfer continue after it (FLASHSIM_REGISTERS: with the library's hooks on the simulated
+//flash registers, which also leave the error code of the flags and release the lock of the flash driver)
+//usage: burst_test
+
+
+//includes
+#define TEST_NAME		"burst_test"
+#define TEST_VARIABLES	EEPROM_VARIABLE_COUNT
+#include <stdio.h>
+#include <string.h>
+#include "eeprom.h"
+#include "flash_sim.h"
+#include "test_check.h"
+
+
+//content of a defective halfword (not erased, so the programming of a value other than 0x0000 fails)
+#define BURST_DEFECT			0xFFFE
+
+
+//global variables
+static uint32_t BURST_End;				//end of the highest halfword programmed since it was cleared
+static uint16_t BURST_Header;			//page header (fill of the blank page)
+static uint16_t BURST_RecordBytes;		//bytes of a 32 bit record
+
+
+// program hook of the simulator: keeps the end of the highest programmed halfword (the next index after a write on one page)
+static void BURST_Program(uint32_t Address, uint16_t Data)
+{
+	if (Address + 2 > BURST_End) BURST_End = Address + 2;
+}
+
+
+// programs a halfword of the flash beforehand, so its programming by the library fails
+static void BURST_Defect(uint32_t Address)
+{
+	uint16_t Data = BURST_DEFECT;
+	FLASHSIM_Write(Address, &Data, 2);
+}
+
+
+// returns the used bytes of the page written to (page header included)
+static uint16_t BURST_PageFill(void)
+{
+	EEPROM_Stats Stats;
+	EEPROM_GetStats(&Stats);
+	return Stats.PageFill;
+}
+
+
+// starts on a blank flash and writes every variable once (the last write gives the next index and the bytes of a record)
+static void BURST_Begin(void)
+{
+	TEST_Begin();
+	FLASHSIM_SetProgramHook(BURST_Program);
+	BURST_Header = BURST_PageFill();
+
+	for (uint16_t i = 0; i < EEPROM_VARIABLE_COUNT; i++)
+	{
+		BURST_End = 0;
+		TEST_Check(TEST_Write(i, 0x11110101 + i, EEPROM_SIZE32) == EEPROM_SUCCESS, "write of a variable");
+	}
+	BURST_RecordBytes = (BURST_PageFill() - BURST_Header) / EEPROM_VARIABLE_COUNT;
+}
+
+
+// a batch write stops at the defective record: the records before it are written, it and the following ones keep their old values
+static void BURST_Batch(void)
+{
+	EEPROM_Variable Batch[4];
+
+	BURST_Begin();
+	BURST_Defect(BURST_End + 2 * BURST_RecordBytes + 2);
+	for (uint16_t i = 0; i < 4; i++) Batch[i] = (EEPROM_Variable) {i, EEPROM_SIZE32, {.uInt32 = 0x22220202 + i}};
+	TEST_Check(EEPROM_WriteVariables(Batch, 4) == EEPROM_ERROR, "batch write with a defective record");
+#if FLASHSIM_REGISTERS
+	TEST_Check(pFlash.ErrorCode == HAL_FLASH_ERROR_PROG && pFlash.Lock == HAL_UNLOCKED, "error code and lock of the flash driver");
+#endif
+	for (uint16_t i = 0; i < 2; i++) TEST_Expect(i, Batch[i].Value.uInt32, EEPROM_SIZE32);
+	TEST_Check(TEST_Holds(), "values after the batch write (failed record not in the index)");
+
+	//the values survive a reset, the writes continue behind the defective record
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values after reset");
+	TEST_Check(EEPROM_WriteVariables(&Batch[2], 2) == EEPROM_SUCCESS, "batch write after reset");
+#if FLASHSIM_REGISTERS
+	TEST_Check(pFlash.ErrorCode == HAL_FLASH_ERROR_NONE && pFlash.Lock == HAL_UNLOCKED, "error code and lock of the flash driver after reset");
+#endif
+	for (uint16_t i = 2; i < 4; i++) TEST_Expect(i, Batch[i].Value.uInt32, EEPROM_SIZE32);
+	TEST_Check(TEST_Holds() && EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values of the batch write after reset");
+}
+
+
+// a page transfer stops at the defective record: the variable isn't carried forward past it and still reads its value
+static void BURST_Transfer(void)
+{
+	uint32_t Value = 0x33330303;
+
+	//fill the page written to, its last record is followed by the page transfer
+	BURST_Begin();
+	while (FLASH_PAGE_SIZE - BURST_PageFill() >= BURST_RecordBytes) TEST_Check(TEST_Write(0, Value++, EEPROM_SIZE32) == EEPROM_SUCCESS, "write of the page");
+
+	//the receiving page gets the triggering record, then the variables 1, 2 ... (the defect is in the record of variable 3)
+	EEPROM_Page ReceivingPage = BURST_End - 2 < EEPROM_PAGE_ADDRESS(1) ? EEPROM_PAGE_ADDRESS(1) : EEPROM_PAGE_ADDRESS(0);
+	BURST_Defect(ReceivingPage + BURST_Header + 3 * BURST_RecordBytes + 2);
+	//(the triggering record is written before the page transfer starts, so it holds even if the transfer fails)
+	EEPROM_Result result = TEST_Store(0, Value, EEPROM_SIZE32);
+	TEST_Expect(0, Value++, EEPROM_SIZE32);
+	if (result == EEPROM_SUCCESS) result = TEST_Finish();
+	TEST_Check(result == EEPROM_ERROR, "page transfer with a defective record");
+	TEST_Check(TEST_Holds(), "values after the page transfer (failed record not in the index)");
+
+	//the values survive a reset, the page transfer and the writes continue behind the defective record
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values after reset");
+	TEST_Check(TEST_Finish() == EEPROM_SUCCESS && TEST_Holds(), "page transfer after reset");
+	for (uint16_t i = 0; i < 200; i++) TEST_Check(TEST_Write(i % EEPROM_VARIABLE_COUNT, Value++, EEPROM_SIZE32) == EEPROM_SUCCESS, "write after reset");
+	TEST_Check(TEST_Finish() == EEPROM_SUCCESS && TEST_Holds(), "values of the writes after reset");
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values of the writes after a further reset");
+}
+
+
+int main(void)
+{
+	BURST_Batch();
+	BURST_Transfer();
+
+	FLASHSIM_SetProgramHook(NULL);
+	return TEST_Result("%u variables, %s transfer, %s hooks", (unsigned) EEPROM_VARIABLE_COUNT, EEPROM_INCREMENTAL_TRANSFER ? "incremental" : "blocking",
+		FLASHSIM_REGISTERS ? "register" : "simulator");
+}
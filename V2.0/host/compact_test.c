@@ -0,0 +1,176 @@
+//tests of the free space accounting, EEPROM_Compact and the pre-compaction of EEPROM_Poll (EEPROM_COMPACT_THRESHOLD) on the host flash simulator
+//V2.0
+//
+//checks that EEPROM_GetFreeSpace drops by the bytes of each record, that EEPROM_Compact leaves a page below the threshold alone
+//and carries the latest records of a page above it forward (the following writes need no page transfer), that pre-compaction
+//starts every page transfer in EEPROM_Poll instead of a write, that the live bytes of the statistics match the latest records
+//and that the values and the free space survive resets
+//usage: compact_test
+
+
+//includes
+#define TEST_NAME		"compact_test"
+#define TEST_VARIABLES	EEPROM_VARIABLE_COUNT
+#include <stdio.h>
+#include <string.h>
+#include "eeprom.h"
+#include "flash_sim.h"
+#include "test_check.h"
+
+
+//writes of the churn scenario
+#define COMPACT_WRITES			20000
+
+//page size of the simulated flash
+#define COMPACT_PAGE_SIZE		FLASHSIM_PAGE_SIZE
+
+//bytes of a 32 bit record (header, value and CRC)
+#define COMPACT_RECORD_BYTES	(6 + (EEPROM_CRC ? 2 : 0))
+
+
+//global variables
+static uint16_t COMPACT_Header;
+
+
+// returns the runtime statistics
+static EEPROM_Stats COMPACT_Stats(void)
+{
+	EEPROM_Stats Stats;
+	EEPROM_GetStats(&Stats);
+	return Stats;
+}
+
+
+// starts a scenario on a blank flash (the page header is the fill of the blank page)
+static void COMPACT_Begin(void)
+{
+	TEST_Begin();
+	COMPACT_Header = COMPACT_Stats().PageFill;
+}
+
+
+// returns 1 if the live bytes of the statistics (sum of the pages) are the records of the assigned variables
+static int COMPACT_LiveBytes(void)
+{
+	uint32_t LiveBytes = 0;
+	for (uint16_t i = 0; i < EEPROM_VARIABLE_COUNT; i++) if (TEST_Sizes[i] != EEPROM_SIZE_DELETED) LiveBytes += COMPACT_RECORD_BYTES;
+	return COMPACT_Stats().LiveBytes == LiveBytes;
+}
+
+
+// returns the garbage share of the page written to in percent (outdated records and checkpoints, single page in use)
+static uint32_t COMPACT_Garbage(void)
+{
+	EEPROM_Stats Stats = COMPACT_Stats();
+	return 100 * (Stats.PageFill - COMPACT_Header - Stats.LiveBytes) / (COMPACT_PAGE_SIZE - COMPACT_Header);
+}
+
+
+// the free space is the erased part of the page written to and the erased pages but the last one, each record takes its bytes
+static void COMPACT_FreeSpace(void)
+{
+	COMPACT_Begin();
+	uint32_t FreeSpace = EEPROM_GetFreeSpace();
+	TEST_Check(FreeSpace == (EEPROM_PAGE_COUNT - 1) * (COMPACT_PAGE_SIZE - COMPACT_Header), "free space of the blank flash");
+
+	for (uint16_t i = 0; i < EEPROM_VARIABLE_COUNT; i++)
+	{
+		uint16_t PageFill = COMPACT_Stats().PageFill;
+		TEST_Check(TEST_Write(i, 0x1000 + i, EEPROM_SIZE32) == EEPROM_SUCCESS, "write of a variable");
+		TEST_Check(FreeSpace - EEPROM_GetFreeSpace() == (uint32_t) (COMPACT_Stats().PageFill - PageFill), "free space drops by the record bytes");
+		FreeSpace = EEPROM_GetFreeSpace();
+	}
+	TEST_Check(FreeSpace == COMPACT_PAGE_SIZE - COMPACT_Stats().PageFill, "free space is the erased part of the page");
+
+	//the free space survives a reset
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds() && EEPROM_GetFreeSpace() == FreeSpace, "free space after reset");
+}
+
+
+// EEPROM_Compact carries the latest records forward above the threshold, the following writes need no page transfer
+static void COMPACT_Manual(void)
+{
+	uint32_t Value = 0;
+
+	COMPACT_Begin();
+	for (uint16_t i = 0; i < EEPROM_VARIABLE_COUNT; i++) TEST_Check(TEST_Write(i, i, EEPROM_SIZE32) == EEPROM_SUCCESS, "write of a variable");
+	while (COMPACT_Garbage() < 40) TEST_Check(TEST_Write(0, Value++, EEPROM_SIZE32) == EEPROM_SUCCESS, "write of the garbage");
+
+	//below the threshold nothing is done
+	uint32_t FreeSpace = EEPROM_GetFreeSpace();
+	TEST_Check(EEPROM_Compact(60) == EEPROM_SUCCESS && COMPACT_Stats().PageTransfers == 0 && EEPROM_GetFreeSpace() == FreeSpace,
+		"no page transfer below the threshold");
+
+	//above the threshold the page transfer is done (and finished, also in incremental mode)
+	TEST_Check(EEPROM_Compact(40) == EEPROM_SUCCESS && COMPACT_Stats().PageTransfers == 1, "page transfer above the threshold");
+	TEST_Check(EEPROM_Poll(1) == EEPROM_SUCCESS, "no page transfer running after EEPROM_Compact");
+	TEST_Check(EEPROM_GetFreeSpace() > FreeSpace && COMPACT_Garbage() == 0 && TEST_Holds(), "free space after EEPROM_Compact");
+
+	//the free space is written without a page transfer
+	EEPROM_Stats Stats = COMPACT_Stats();
+	uint16_t PageFill = Stats.PageFill;
+	TEST_Check(TEST_Write(0, Value++, EEPROM_SIZE32) == EEPROM_SUCCESS, "write after EEPROM_Compact");
+	uint16_t RecordBytes = COMPACT_Stats().PageFill - PageFill;
+	while (EEPROM_GetFreeSpace() >= RecordBytes) TEST_Check(TEST_Write(0, Value++, EEPROM_SIZE32) == EEPROM_SUCCESS, "write of the free space");
+	TEST_Check(COMPACT_Stats().PageTransfers == Stats.PageTransfers, "no page transfer while free space is left");
+	TEST_Check(TEST_Write(0, Value++, EEPROM_SIZE32) == EEPROM_SUCCESS && COMPACT_Stats().PageTransfers == Stats.PageTransfers + 1,
+		"page transfer when the free space is used up");
+	TEST_Finish();
+
+	//threshold 0 compacts even a page without garbage, threshold 100 only a page without latest records
+	TEST_Check(EEPROM_Compact(0) == EEPROM_SUCCESS && COMPACT_Stats().PageTransfers == Stats.PageTransfers + 2, "page transfer at threshold 0");
+	TEST_Check(EEPROM_Compact(100) == EEPROM_SUCCESS && COMPACT_Stats().PageTransfers == Stats.PageTransfers + 2, "no page transfer at threshold 100");
+	TEST_Check(TEST_Holds(), "values after EEPROM_Compact");
+
+	//an open transaction is not compacted
+#if EEPROM_TRANSACTION_SIZE > 0
+	TEST_Check(EEPROM_BeginTransaction() == EEPROM_SUCCESS && TEST_Write(1, Value++, EEPROM_SIZE32) == EEPROM_SUCCESS, "write of a transaction");
+	TEST_Check(EEPROM_Compact(0) == EEPROM_BUSY && EEPROM_Commit() == EEPROM_SUCCESS, "no EEPROM_Compact during a transaction");
+#endif
+
+	//values and free space survive a reset
+	FreeSpace = EEPROM_GetFreeSpace();
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds() && EEPROM_GetFreeSpace() == FreeSpace, "values after reset");
+}
+
+
+// random writes with EEPROM_Poll after each write: with pre-compaction every page transfer starts in EEPROM_Poll, without it in a write
+static void COMPACT_Churn(void)
+{
+	uint32_t Random = 0x12345678;
+	uint32_t WriteTransfers = 0;
+	uint32_t PollTransfers = 0;
+
+	COMPACT_Begin();
+	for (uint32_t i = 0; i < COMPACT_WRITES; i++)
+	{
+		Random = Random * 1103515245 + 12345;
+		uint32_t PageTransfers = COMPACT_Stats().PageTransfers;
+		if (TEST_Write((Random >> 16) % EEPROM_VARIABLE_COUNT, i, EEPROM_SIZE32) != EEPROM_SUCCESS) { TEST_Check(0, "write of the churn"); return; }
+		WriteTransfers += COMPACT_Stats().PageTransfers - PageTransfers;
+
+		PageTransfers = COMPACT_Stats().PageTransfers;
+		EEPROM_Result result = EEPROM_Poll(4);
+		if (result != EEPROM_SUCCESS && result != EEPROM_PENDING) { TEST_Check(0, "EEPROM_Poll of the churn"); return; }
+		PollTransfers += COMPACT_Stats().PageTransfers - PageTransfers;
+
+		//reset now and then (the statistics restart)
+		if (i % 5000 == 2500) TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values of the churn after reset");
+	}
+	TEST_Check(WriteTransfers + PollTransfers > 10, "page transfers of the churn");
+	TEST_Check(EEPROM_COMPACT_THRESHOLD > 0 ? WriteTransfers == 0 : PollTransfers == 0, "page transfers started by pre-compaction only");
+	TEST_Check(TEST_Holds(), "values of the churn");
+	TEST_Check(COMPACT_LiveBytes(), "live bytes of the churn");
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values of the churn after reset");
+	TEST_Check(COMPACT_LiveBytes(), "live bytes of the churn after reset");
+}
+
+
+int main(void)
+{
+	COMPACT_FreeSpace();
+	COMPACT_Manual();
+	COMPACT_Churn();
+
+	return TEST_Result("%u variables, threshold %u%%", (unsigned) EEPROM_VARIABLE_COUNT, (unsigned) EEPROM_COMPACT_THRESHOLD);
+}
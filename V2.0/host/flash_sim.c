@@ -0,0 +1,568 @@
+//simulated STM32F1XX flash memory for host builds of the EEPROM emulation library
+//V2.0
+
+
+//includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stm32f1xx_hal.h"
+
+
+//private function prototypes
+static uint8_t* FLASHSIM_Pointer(uint32_t Address, uint32_t Bytes);
+static HAL_StatusTypeDef FLASHSIM_ProgramHalfword(uint32_t Address, uint16_t Data);
+static void FLASHSIM_Update(void);
+static void FLASHSIM_WaitForErase(uint32_t Address);
+static uint32_t FLASHSIM_Bank(uint32_t Address);
+static void FLASHSIM_Stall(uint32_t Address, uint32_t Time);
+
+
+//global variables
+static uint8_t FLASHSIM_Memory[1024 * FLASHSIM_FLASH_SIZE];					//flash content, erased state is 0xFF
+static uint8_t FLASHSIM_Locked = 1;											//flash control register lock (FLASH_CR_LOCK)
+static FLASHSIM_Counters FLASHSIM_Count;
+static FLASHSIM_ProgramHook FLASHSIM_Hook = NULL;
+static FLASHSIM_EraseHook FLASHSIM_EraseHandler = NULL;
+
+static uint32_t FLASHSIM_EraseAddress;											//page of a running interrupt driven erase
+static uint32_t FLASHSIM_ErasePages = 0;										//pages left to erase (0: no erase running)
+static uint64_t FLASHSIM_EraseEnd;												//modeled time the current page erase ends
+
+static uint8_t FLASHSIM_Burst = 0;												//flash controller in program mode (FLASHSIM_BurstBegin)
+static HAL_StatusTypeDef FLASHSIM_BurstError = HAL_OK;							//error flags of the running burst
+
+FLASH_TypeDef FLASHSIM_Registers;												//register block of the flash controller (FLASH)
+FLASH_ProcessTypeDef pFlash = {HAL_FLASH_ERROR_NONE, HAL_UNLOCKED};				//state of the flash driver
+
+static FLASHSIM_Timing FLASHSIM_Time =
+{
+	.ProgramHalfword = 52500,
+	.ErasePage = 20000000,
+	.ProgramCall = 1500,
+	.BurstHalfword = 100,
+	.EraseCall = 1500,
+	.ReadAccess = 42,
+	.TickPoll = 1000
+};
+
+
+// erases the whole simulated flash, locks it and clears all counters
+void FLASHSIM_Reset(void)
+{
+	memset(FLASHSIM_Memory, 0xFF, sizeof(FLASHSIM_Memory));
+	FLASHSIM_Locked = 1;
+	FLASHSIM_ErasePages = 0;
+	FLASHSIM_Burst = 0;
+	memset(&FLASHSIM_Registers, 0, sizeof(FLASHSIM_Registers));
+	pFlash.ErrorCode = HAL_FLASH_ERROR_NONE;
+	pFlash.Lock = HAL_UNLOCKED;
+	FLASHSIM_ClearCounters();
+}
+
+
+// sets / gets the timing model used for the modeled time
+void FLASHSIM_SetTiming(const FLASHSIM_Timing* Timing)
+{
+	FLASHSIM_Time = *Timing;
+}
+
+void FLASHSIM_GetTiming(FLASHSIM_Timing* Timing)
+{
+	*Timing = FLASHSIM_Time;
+}
+
+
+// gets / clears the operation counters
+void FLASHSIM_GetCounters(FLASHSIM_Counters* Counters)
+{
+	*Counters = FLASHSIM_Count;
+}
+
+void FLASHSIM_ClearCounters(void)
+{
+	memset(&FLASHSIM_Count, 0, sizeof(FLASHSIM_Count));
+}
+
+
+// sets the function called after every programmed halfword (NULL to remove)
+void FLASHSIM_SetProgramHook(FLASHSIM_ProgramHook Hook)
+{
+	FLASHSIM_Hook = Hook;
+}
+
+
+// sets the function called before every page erase (NULL to remove)
+void FLASHSIM_SetEraseHook(FLASHSIM_EraseHook Hook)
+{
+	FLASHSIM_EraseHandler = Hook;
+}
+
+
+// lets application time pass (a running interrupt driven erase ends when its time is over)
+void FLASHSIM_Elapse(uint64_t Time)
+{
+	FLASHSIM_Count.Time += Time;
+	FLASHSIM_Update();
+}
+
+
+// returns the modeled time in us like a free running timer (e.g. DWT->CYCCNT) without advancing it
+uint32_t FLASHSIM_Timestamp(void)
+{
+	return (uint32_t) (FLASHSIM_Count.Time / 1000);
+}
+
+
+// reads from the simulated flash like the library's __IO pointer reads (one counted read access)
+// - a read stalls until a running erase of its bank is finished (the bank can't be read meanwhile)
+uint16_t FLASHSIM_Read16(uint32_t Address)
+{
+	FLASHSIM_WaitForErase(Address);
+	uint16_t Data;
+	memcpy(&Data, FLASHSIM_Pointer(Address, 2), 2);
+	FLASHSIM_Count.Reads++;
+	FLASHSIM_Count.Time += FLASHSIM_Time.ReadAccess;
+	return Data;
+}
+
+uint32_t FLASHSIM_Read32(uint32_t Address)
+{
+	FLASHSIM_WaitForErase(Address);
+	uint32_t Data;
+	memcpy(&Data, FLASHSIM_Pointer(Address, 4), 4);
+	FLASHSIM_Count.Reads++;
+	FLASHSIM_Count.Time += FLASHSIM_Time.ReadAccess;
+	return Data;
+}
+
+
+// maps simulated flash into the host address space like the memory-mapped flash of the device (zero-copy reads)
+// accesses through the pointer are not counted and don't stall for a running erase
+const uint8_t* FLASHSIM_Map(uint32_t Address)
+{
+	return FLASHSIM_Pointer(Address, 0);
+}
+
+
+// writes raw bytes into the simulated flash, ignoring the programming rules and not counted
+// (loads a flash image or models physical effects like an interrupted erase)
+void FLASHSIM_Write(uint32_t Address, const void* Data, uint32_t Bytes)
+{
+	memcpy(FLASHSIM_Pointer(Address, Bytes), Data, Bytes);
+}
+
+
+// writes a halfword in program mode like the __IO pointer writes of the library's register hooks (FLASHSIM_REGISTERS, BurstHalfword each)
+// - the program bit of the bank must be set and no erase running, the halfword is programmed following the STM32F1 rules
+// - an error sets PGERR (nothing is written), else EOP, the busy flag reads set once (one iteration of the polling loop)
+void FLASHSIM_Write16(uint32_t Address, uint16_t Data)
+{
+	__IO uint32_t* SR = &FLASHSIM_Registers.SR;
+	__IO uint32_t* CR = &FLASHSIM_Registers.CR;
+#if defined(FLASH_BANK2_END)
+	if (FLASHSIM_Bank(Address) == FLASH_BANK_2)
+	{
+		SR = &FLASHSIM_Registers.SR2;
+		CR = &FLASHSIM_Registers.CR2;
+	}
+#endif
+
+	FLASHSIM_Count.BurstHalfwords++;
+	FLASHSIM_Count.ProgramOverhead += FLASHSIM_Time.BurstHalfword;
+	FLASHSIM_Count.Time += FLASHSIM_Time.BurstHalfword;
+	FLASHSIM_Update();
+	if (!(*CR & FLASH_CR_PG) || FLASHSIM_ErasePages != 0)
+	{
+		FLASHSIM_Count.Errors++;
+		*SR |= FLASH_SR_PGERR;
+	}
+	else if (FLASHSIM_ProgramHalfword(Address, Data) != HAL_OK) *SR |= FLASH_SR_PGERR;
+	else *SR |= FLASH_SR_EOP;
+	*SR |= FLASH_SR_BSY;
+}
+
+//--------------------------------------------------HAL flash driver-------------------------------------------
+
+// millisecond tick, every call is one iteration of a polling loop (lets the modeled time pass)
+uint32_t HAL_GetTick(void)
+{
+	FLASHSIM_Count.Time += FLASHSIM_Time.TickPoll;
+	FLASHSIM_Update();
+	return (uint32_t) (FLASHSIM_Count.Time / 1000000);
+}
+
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+	FLASHSIM_Locked = 0;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+	FLASHSIM_Locked = 1;
+	return HAL_OK;
+}
+
+
+// programs 1, 2 or 4 halfwords like the HAL (one halfword after another, stop at first error)
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+	HAL_StatusTypeDef result = HAL_OK;
+
+	//get number of halfwords
+	uint8_t Halfwords;
+	switch (TypeProgram)
+	{
+		case FLASH_TYPEPROGRAM_HALFWORD: Halfwords = 1; break;
+		case FLASH_TYPEPROGRAM_WORD: Halfwords = 2; break;
+		case FLASH_TYPEPROGRAM_DOUBLEWORD: Halfwords = 4; break;
+		default: FLASHSIM_Count.Errors++; return HAL_ERROR;
+	}
+
+	FLASHSIM_Count.ProgramCalls++;
+	FLASHSIM_Count.ProgramOverhead += FLASHSIM_Time.ProgramCall;
+	FLASHSIM_Count.Time += FLASHSIM_Time.ProgramCall;
+
+	//flash driver is locked by a running interrupt driven erase (or in program mode of a burst, the lock held by the library's register hooks)
+	FLASHSIM_Update();
+	if (FLASHSIM_ErasePages != 0 || FLASHSIM_Burst || pFlash.Lock == HAL_LOCKED)
+	{
+		FLASHSIM_Count.Errors++;
+		return HAL_BUSY;
+	}
+
+	//program halfwords
+	for (uint8_t i = 0; i < Halfwords && result == HAL_OK; i++)
+	{
+		result = FLASHSIM_ProgramHalfword(Address + 2*i, (uint16_t) (Data >> (16*i)));
+	}
+
+	return result;
+}
+
+
+// erases pages (or the whole flash) like the HAL
+// (stricter than the HAL: a page erase must name the bank of every page, FLASH_BANK_BOTH for pages in both banks)
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef* pEraseInit, uint32_t* PageError)
+{
+	*PageError = 0xFFFFFFFF;
+	FLASHSIM_Count.EraseCalls++;
+	FLASHSIM_Count.Time += FLASHSIM_Time.EraseCall;
+
+	FLASHSIM_Update();
+	if (FLASHSIM_ErasePages != 0 || FLASHSIM_Burst || pFlash.Lock == HAL_LOCKED)
+	{
+		FLASHSIM_Count.Errors++;
+		return HAL_BUSY;
+	}
+	if (FLASHSIM_Locked)
+	{
+		FLASHSIM_Count.Errors++;
+		return HAL_ERROR;
+	}
+
+	//get pages to erase
+	uint32_t Address = FLASHSIM_BASE;
+	uint32_t NbPages = sizeof(FLASHSIM_Memory) / FLASHSIM_PAGE_SIZE;
+	if (pEraseInit->TypeErase == FLASH_TYPEERASE_PAGES)
+	{
+		Address = pEraseInit->PageAddress - (pEraseInit->PageAddress - FLASHSIM_BASE) % FLASHSIM_PAGE_SIZE;
+		NbPages = pEraseInit->NbPages;
+		for (uint32_t i = 0; i < NbPages; i++)
+		{
+			if ((pEraseInit->Banks & FLASHSIM_Bank(Address + i * FLASHSIM_PAGE_SIZE)) == 0)
+			{
+				FLASHSIM_Count.Errors++;
+				return HAL_ERROR;
+			}
+		}
+	}
+
+	//erase page by page
+	for (uint32_t i = 0; i < NbPages; i++)
+	{
+		if (FLASHSIM_EraseHandler != NULL) FLASHSIM_EraseHandler(Address);
+		memset(FLASHSIM_Pointer(Address, FLASHSIM_PAGE_SIZE), 0xFF, FLASHSIM_PAGE_SIZE);
+		FLASHSIM_Count.PageErases++;
+		FLASHSIM_Count.Time += FLASHSIM_Time.ErasePage;
+		FLASHSIM_Stall(Address, FLASHSIM_Time.ErasePage);
+		Address += FLASHSIM_PAGE_SIZE;
+	}
+
+	return HAL_OK;
+}
+
+
+// starts an interrupt driven page erase like the HAL (pages are erased one after another in the background)
+// (the erase of a bank 1 page stalls the code in bank 1 all the same, pages must be in the named bank like in HAL_FLASHEx_Erase)
+HAL_StatusTypeDef HAL_FLASHEx_Erase_IT(FLASH_EraseInitTypeDef* pEraseInit)
+{
+	FLASHSIM_Count.EraseCalls++;
+	FLASHSIM_Count.Time += FLASHSIM_Time.EraseCall;
+
+	FLASHSIM_Update();
+	if (FLASHSIM_ErasePages != 0 || FLASHSIM_Burst || pFlash.Lock == HAL_LOCKED)
+	{
+		FLASHSIM_Count.Errors++;
+		return HAL_BUSY;
+	}
+	if (FLASHSIM_Locked || pEraseInit->TypeErase != FLASH_TYPEERASE_PAGES || pEraseInit->NbPages == 0)
+	{
+		FLASHSIM_Count.Errors++;
+		return HAL_ERROR;
+	}
+
+	FLASHSIM_EraseAddress = pEraseInit->PageAddress - (pEraseInit->PageAddress - FLASHSIM_BASE) % FLASHSIM_PAGE_SIZE;
+	FLASHSIM_Pointer(FLASHSIM_EraseAddress, pEraseInit->NbPages * FLASHSIM_PAGE_SIZE);
+	for (uint32_t i = 0; i < pEraseInit->NbPages; i++)
+	{
+		if ((pEraseInit->Banks & FLASHSIM_Bank(FLASHSIM_EraseAddress + i * FLASHSIM_PAGE_SIZE)) == 0)
+		{
+			FLASHSIM_Count.Errors++;
+			return HAL_ERROR;
+		}
+	}
+	FLASHSIM_ErasePages = pEraseInit->NbPages;
+	FLASHSIM_EraseEnd = FLASHSIM_Count.Time + FLASHSIM_Time.ErasePage;
+	FLASHSIM_Stall(FLASHSIM_EraseAddress, FLASHSIM_Time.ErasePage);
+
+	return HAL_OK;
+}
+
+
+// waits for the last operation like the HAL (the library's register hooks call it before entering program mode, FLASHSIM_REGISTERS)
+// - costs ProgramCall like a HAL_FLASH_Program call, counted as burst
+// - busy while an interrupt driven erase is running (the simulator doesn't wait for it, like FLASHSIM_BurstBegin)
+HAL_StatusTypeDef FLASH_WaitForLastOperation(uint32_t Timeout)
+{
+	FLASHSIM_Count.BurstCalls++;
+	FLASHSIM_Count.ProgramOverhead += FLASHSIM_Time.ProgramCall;
+	FLASHSIM_Count.Time += FLASHSIM_Time.ProgramCall;
+
+	FLASHSIM_Update();
+	if (FLASHSIM_ErasePages != 0)
+	{
+		FLASHSIM_Count.Errors++;
+		return HAL_BUSY;
+	}
+	return HAL_OK;
+}
+
+#if defined(FLASH_BANK2_END)
+HAL_StatusTypeDef FLASH_WaitForLastOperationBank2(uint32_t Timeout)
+{
+	FLASHSIM_Update();
+	if (FLASHSIM_ErasePages != 0)
+	{
+		FLASHSIM_Count.Errors++;
+		return HAL_BUSY;
+	}
+	return HAL_OK;
+}
+#endif
+
+
+// gets a status flag like __HAL_FLASH_GET_FLAG (the busy flag is cleared by reading it, see FLASHSIM_Write16)
+// return: the flag bits, if the flag is set, else 0
+uint32_t FLASHSIM_GetFlag(uint32_t Flag)
+{
+	__IO uint32_t* SR = &FLASHSIM_Registers.SR;
+#if defined(FLASH_BANK2_END)
+	if (Flag & FLASH_FLAG_BANK2) SR = &FLASHSIM_Registers.SR2;
+	Flag &= ~FLASH_FLAG_BANK2;
+#endif
+	uint32_t Set = *SR & Flag;
+	*SR &= ~(Set & FLASH_SR_BSY);
+	return Set;
+}
+
+
+// clears status flags like __HAL_FLASH_CLEAR_FLAG (write 1 to clear)
+void FLASHSIM_ClearFlag(uint32_t Flags)
+{
+#if defined(FLASH_BANK2_END)
+	if (Flags & FLASH_FLAG_BANK2)
+	{
+		FLASHSIM_Registers.SR2 &= ~(Flags & ~FLASH_FLAG_BANK2);
+		return;
+	}
+#endif
+	FLASHSIM_Registers.SR &= ~Flags;
+}
+
+
+// enters program mode for a burst like the library's EEPROM_BurstBegin (one HAL_FLASH_Program worth of overhead)
+// - waits for the last operation: busy while an interrupt driven erase is running
+HAL_StatusTypeDef FLASHSIM_BurstBegin(uint32_t Address)
+{
+	FLASHSIM_Count.BurstCalls++;
+	FLASHSIM_Count.ProgramOverhead += FLASHSIM_Time.ProgramCall;
+	FLASHSIM_Count.Time += FLASHSIM_Time.ProgramCall;
+
+	FLASHSIM_Update();
+	if (FLASHSIM_ErasePages != 0 || FLASHSIM_Burst || pFlash.Lock == HAL_LOCKED)
+	{
+		FLASHSIM_Count.Errors++;
+		return HAL_BUSY;
+	}
+
+	FLASHSIM_Burst = 1;
+	FLASHSIM_BurstError = HAL_OK;
+	return HAL_OK;
+}
+
+
+// programs one halfword in program mode like the library's EEPROM_BurstWrite (no flag check, an error is kept for FLASHSIM_BurstEnd)
+HAL_StatusTypeDef FLASHSIM_BurstWrite(uint32_t Address, uint16_t Data)
+{
+	if (!FLASHSIM_Burst)
+	{
+		FLASHSIM_Count.Errors++;
+		return HAL_ERROR;
+	}
+
+	FLASHSIM_Count.BurstHalfwords++;
+	FLASHSIM_Count.ProgramOverhead += FLASHSIM_Time.BurstHalfword;
+	FLASHSIM_Count.Time += FLASHSIM_Time.BurstHalfword;
+	if (FLASHSIM_ProgramHalfword(Address, Data) != HAL_OK) FLASHSIM_BurstError = HAL_ERROR;
+	return HAL_OK;
+}
+
+
+// reads the error flags of the running burst like the library's EEPROM_BurstCheck (stays in program mode)
+// return: HAL_ERROR if a halfword of the burst failed, HAL_OK otherwise
+HAL_StatusTypeDef FLASHSIM_BurstCheck(uint32_t Address)
+{
+	if (!FLASHSIM_Burst)
+	{
+		FLASHSIM_Count.Errors++;
+		return HAL_ERROR;
+	}
+
+	return FLASHSIM_BurstError;
+}
+
+
+// leaves program mode like the library's EEPROM_BurstEnd
+// return: HAL_ERROR if a halfword of the burst failed, HAL_OK otherwise
+HAL_StatusTypeDef FLASHSIM_BurstEnd(uint32_t Address)
+{
+	if (!FLASHSIM_Burst)
+	{
+		FLASHSIM_Count.Errors++;
+		return HAL_ERROR;
+	}
+
+	FLASHSIM_Burst = 0;
+	return FLASHSIM_BurstError;
+}
+
+
+// flash interrupt like the HAL: ends the current page erase and calls the callbacks
+// - HAL_FLASH_EndOfOperationCallback with the page address after each page, with 0xFFFFFFFF when all pages are erased
+void HAL_FLASH_IRQHandler(void)
+{
+	if (FLASHSIM_ErasePages == 0 || FLASHSIM_Count.Time < FLASHSIM_EraseEnd) return;
+
+	if (FLASHSIM_EraseHandler != NULL) FLASHSIM_EraseHandler(FLASHSIM_EraseAddress);
+	memset(FLASHSIM_Pointer(FLASHSIM_EraseAddress, FLASHSIM_PAGE_SIZE), 0xFF, FLASHSIM_PAGE_SIZE);
+	FLASHSIM_Count.PageErases++;
+
+	if (--FLASHSIM_ErasePages != 0)
+	{
+		HAL_FLASH_EndOfOperationCallback(FLASHSIM_EraseAddress);
+		FLASHSIM_EraseAddress += FLASHSIM_PAGE_SIZE;
+		FLASHSIM_EraseEnd += FLASHSIM_Time.ErasePage;
+		FLASHSIM_Stall(FLASHSIM_EraseAddress, FLASHSIM_Time.ErasePage);
+	}
+	else HAL_FLASH_EndOfOperationCallback(0xFFFFFFFF);
+}
+
+
+// default callbacks (weak like in the HAL)
+__attribute__((weak)) void HAL_FLASH_EndOfOperationCallback(uint32_t ReturnValue)
+{
+}
+
+__attribute__((weak)) void HAL_FLASH_OperationErrorCallback(uint32_t ReturnValue)
+{
+}
+
+
+//--------------------------------------------------private functions----------------------------------------
+
+// raises the flash interrupt for every page erase that ended by now
+static void FLASHSIM_Update(void)
+{
+	while (FLASHSIM_ErasePages != 0 && FLASHSIM_Count.Time >= FLASHSIM_EraseEnd) HAL_FLASH_IRQHandler();
+}
+
+
+// stalls until a running erase of the bank of the address is finished
+static void FLASHSIM_WaitForErase(uint32_t Address)
+{
+	while (FLASHSIM_ErasePages != 0 && FLASHSIM_Bank(FLASHSIM_EraseAddress) == FLASHSIM_Bank(Address))
+	{
+		if (FLASHSIM_Count.Time < FLASHSIM_EraseEnd) FLASHSIM_Count.Time = FLASHSIM_EraseEnd;
+		FLASHSIM_Update();
+	}
+}
+
+
+// returns the bank of a flash address (FLASH_BANK_1 or FLASH_BANK_2)
+static uint32_t FLASHSIM_Bank(uint32_t Address)
+{
+	return Address - FLASHSIM_BASE < 1024 * FLASHSIM_BANK1_SIZE ? FLASH_BANK_1 : FLASH_BANK_2;
+}
+
+
+// counts the time the code in bank 1 can't execute, because a program or erase of the address keeps bank 1 busy
+static void FLASHSIM_Stall(uint32_t Address, uint32_t Time)
+{
+	if (FLASHSIM_Bank(Address) == FLASH_BANK_1) FLASHSIM_Count.CodeStall += Time;
+}
+
+
+// translates a flash address into a pointer to the simulated memory (aborts like a bus fault if out of range)
+static uint8_t* FLASHSIM_Pointer(uint32_t Address, uint32_t Bytes)
+{
+	if (Address < FLASHSIM_BASE || Address - FLASHSIM_BASE + Bytes > sizeof(FLASHSIM_Memory))
+	{
+		fprintf(stderr, "flash_sim: access to 0x%08X outside of simulated flash\n", (unsigned) Address);
+		abort();
+	}
+	return &FLASHSIM_Memory[Address - FLASHSIM_BASE];
+}
+
+
+// programs one halfword following the STM32F1 rules
+// - flash must be unlocked and the address halfword aligned
+// - the halfword must be erased (0xFFFF), except when programming 0x0000 (PGERR otherwise, nothing is written)
+static HAL_StatusTypeDef FLASHSIM_ProgramHalfword(uint32_t Address, uint16_t Data)
+{
+	if (FLASHSIM_Locked || (Address & 1))
+	{
+		FLASHSIM_Count.Errors++;
+		return HAL_ERROR;
+	}
+
+	uint8_t* Pointer = FLASHSIM_Pointer(Address, 2);
+	uint16_t Content;
+	memcpy(&Content, Pointer, 2);
+	if (Content != 0xFFFF && Data != 0x0000)
+	{
+		FLASHSIM_Count.Errors++;
+		return HAL_ERROR;
+	}
+
+	memcpy(Pointer, &Data, 2);
+	FLASHSIM_Count.HalfwordPrograms++;
+	FLASHSIM_Count.Time += FLASHSIM_Time.ProgramHalfword;
+	FLASHSIM_Stall(Address, FLASHSIM_Time.ProgramHalfword);
+
+	if (FLASHSIM_Hook != NULL) FLASHSIM_Hook(Address, Data);
+
+	return HAL_OK;
+}
@@ -0,0 +1,93 @@
+//simulated STM32F1XX flash memory for host builds of the EEPROM emulation library
+//V2.0
+
+
+//define to prevent recursive inclusion
+#ifndef __FLASH_SIM_H
+#define __FLASH_SIM_H
+
+//includes
+#include <stdint.h>
+
+//-------------------------------------------simulator configuration-------------------------------------------
+
+//flash page size in bytes: 0x400 for low- and medium-density, 0x800 for high-density, XL-density and connectivity line devices
+#ifndef FLASHSIM_PAGE_SIZE
+#define FLASHSIM_PAGE_SIZE		0x400U
+#endif
+
+//simulated flash size in KByte (should match EEPROM_FLASH_SIZE)
+#ifndef FLASHSIM_FLASH_SIZE
+#define FLASHSIM_FLASH_SIZE		64U
+#endif
+
+//size of flash bank 1 in KByte: 512 for XL-density devices (bank 2 follows up to FLASHSIM_FLASH_SIZE), default: one bank
+//the application code is modeled in bank 1: every program or erase of a bank 1 page stalls its instruction fetch (CodeStall),
+//operations on bank 2 don't (read-while-write), a flash read stalls while an erase of its own bank is running
+#ifndef FLASHSIM_BANK1_SIZE
+#define FLASHSIM_BANK1_SIZE		FLASHSIM_FLASH_SIZE
+#endif
+
+//burst programming of the library (EEPROM_BURST_PROGRAM) on the simulated flash registers: 1 builds its register hooks
+//(EEPROM_BurstBegin ...) against the register block, flags and driver lock of stm32f1xx_hal.h, 0 redirects them to FLASHSIM_BurstBegin ...
+#ifndef FLASHSIM_REGISTERS
+#define FLASHSIM_REGISTERS		0
+#endif
+
+//flash start address
+#define FLASHSIM_BASE			(uint32_t) 0x08000000
+
+//-------------------------------------------------types-------------------------------------------------
+
+//timing model in nanoseconds (defaults are the typical values of the STM32F103 datasheet)
+typedef struct
+{
+	uint32_t ProgramHalfword;													//tPROG: programming time of one halfword
+	uint32_t ErasePage;															//tERASE: erase time of one page
+	uint32_t ProgramCall;														//software overhead of one HAL_FLASH_Program call (lock check, FLASH_WaitForLastOperation, flag clearing)
+	uint32_t BurstHalfword;														//software overhead of one halfword of a burst (store, busy flag polling)
+	uint32_t EraseCall;															//software overhead of one HAL_FLASHEx_Erase call
+	uint32_t ReadAccess;														//one flash read access including wait states
+	uint32_t TickPoll;															//one iteration of a HAL_GetTick polling loop
+} FLASHSIM_Timing;
+
+//operation counters (cleared by FLASHSIM_Reset and FLASHSIM_ClearCounters)
+typedef struct
+{
+	uint64_t HalfwordPrograms;													//programmed halfwords
+	uint64_t ProgramCalls;														//HAL_FLASH_Program calls
+	uint64_t BurstCalls;														//bursts (FLASHSIM_BurstBegin calls, the flash controller entered program mode)
+	uint64_t BurstHalfwords;													//halfwords programmed in bursts (FLASHSIM_BurstWrite calls)
+	uint64_t ProgramOverhead;													//modeled software overhead of the programming in ns (ProgramCall, BurstHalfword)
+	uint64_t PageErases;														//erased pages
+	uint64_t EraseCalls;														//HAL_FLASHEx_Erase calls
+	uint64_t Reads;																//flash read accesses of the library
+	uint64_t Errors;															//rejected operations (flash locked, halfword not erased, out of range)
+	uint64_t Time;																//modeled time in ns (flash operations, stalls and FLASHSIM_Elapse)
+	uint64_t CodeStall;															//modeled time in ns the code in bank 1 could not execute (bank 1 programmed or erased)
+} FLASHSIM_Counters;
+
+//called after every successfully programmed halfword
+typedef void (*FLASHSIM_ProgramHook)(uint32_t Address, uint16_t Data);
+
+//called before every page erase (with FLASHSIM_Write it can model an erase interrupted by a power loss)
+typedef void (*FLASHSIM_EraseHook)(uint32_t Address);
+
+//----------------------------------------------public functions---------------------------------------------
+
+void FLASHSIM_Reset(void);
+void FLASHSIM_SetTiming(const FLASHSIM_Timing* Timing);
+void FLASHSIM_GetTiming(FLASHSIM_Timing* Timing);
+void FLASHSIM_GetCounters(FLASHSIM_Counters* Counters);
+void FLASHSIM_ClearCounters(void);
+void FLASHSIM_SetProgramHook(FLASHSIM_ProgramHook Hook);
+void FLASHSIM_SetEraseHook(FLASHSIM_EraseHook Hook);
+void FLASHSIM_Elapse(uint64_t Time);
+uint32_t FLASHSIM_Timestamp(void);
+uint16_t FLASHSIM_Read16(uint32_t Address);
+uint32_t FLASHSIM_Read32(uint32_t Address);
+const uint8_t* FLASHSIM_Map(uint32_t Address);
+void FLASHSIM_Write(uint32_t Address, const void* Data, uint32_t Bytes);
+void FLASHSIM_Write16(uint32_t Address, uint16_t Data);
+
+#endif
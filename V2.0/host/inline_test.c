@@ -0,0 +1,96 @@
+//tests of the inline records of 8 bit values (EEPROM_INLINE_VALUES) on the host flash simulator
+//V2.0
+//
+//checks that an 8 bit value is written with one halfword program (plus the CRC), that only names below EEPROM_INLINE_NAMES
+//take it, that size changes between inline and 16 bit records are written, and that a mix of inline and 32 bit records
+//survives page transfers and resets (replay and checkpoints)
+//usage: inline_test
+
+
+//includes
+#define TEST_NAME		"inline_test"
+#define TEST_VARIABLES	EEPROM_VARIABLE_COUNT
+#include <stdio.h>
+#include <string.h>
+#include "eeprom.h"
+#include "flash_sim.h"
+#include "test_check.h"
+
+
+//writes of the churn scenario
+#define INLINE_WRITES			20000
+
+//halfwords of the CRC of a record
+#define INLINE_CRC_HALFWORDS	(EEPROM_CRC ? 1 : 0)
+
+
+// writes a value (8 bit inline below EEPROM_INLINE_NAMES, else 32 bit) and records it as expected
+static EEPROM_Result INLINE_Write(uint16_t VariableName, uint32_t Value)
+{
+	return TEST_Write(VariableName, Value, VariableName < EEPROM_INLINE_NAMES ? EEPROM_SIZE8 : EEPROM_SIZE32);
+}
+
+
+// an inline record takes one halfword program (plus the CRC), names from EEPROM_INLINE_NAMES on are rejected
+static void INLINE_Format(void)
+{
+	EEPROM_Value Value = {.uInt8 = 0xA5};
+	EEPROM_Variable Batch[2] = {{1, EEPROM_SIZE8, {.uInt8 = 1}}, {EEPROM_INLINE_NAMES, EEPROM_SIZE8, {.uInt8 = 2}}};
+
+	TEST_Begin();
+	TEST_Programs();
+	TEST_Check(INLINE_Write(0, 0xA5) == EEPROM_SUCCESS && TEST_Programs() == 1 + INLINE_CRC_HALFWORDS, "inline record in one halfword program");
+	TEST_Check(INLINE_Write(EEPROM_INLINE_NAMES - 1, 0xFF) == EEPROM_SUCCESS && INLINE_Write(1, 0x00) == EEPROM_SUCCESS, "values 0xFF and 0x00 of the highest and a low name");
+	TEST_Check(EEPROM_WriteVariable(EEPROM_INLINE_NAMES, Value, EEPROM_SIZE8) == EEPROM_INVALID_SIZE, "8 bit value of a name above the inline names");
+	TEST_Check(EEPROM_WriteVariables(Batch, 2) == EEPROM_INVALID_SIZE, "batch with an 8 bit value of a name above the inline names");
+	TEST_Check(EEPROM_UpdateVariable(0, Value, EEPROM_SIZE8) == EEPROM_UNCHANGED, "unchanged inline value is skipped");
+	TEST_Check(TEST_Holds(), "inline values");
+
+	//a size change between inline and 16 bit records is written (the value is read with the new size)
+	Value.uInt16 = 0xA5;
+	TEST_Programs();
+	TEST_Check(EEPROM_UpdateVariable(0, Value, EEPROM_SIZE16) == EEPROM_SUCCESS && TEST_Programs() == 2 + INLINE_CRC_HALFWORDS, "16 bit record of the same value");
+	Value.uInt16 = 0;
+	TEST_Check(EEPROM_ReadVariable(0, &Value) == EEPROM_SUCCESS && Value.uInt16 == 0xA5, "16 bit value after an inline value");
+	TEST_Check(EEPROM_DeleteVariable(1) == EEPROM_SUCCESS, "delete of an inline variable");
+	TEST_Expect(0, 0xA5, EEPROM_SIZE16);
+	TEST_Expect(1, 0, EEPROM_SIZE_DELETED);
+
+	//the values survive a reset
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values after reset");
+	TEST_Check(INLINE_Write(0, 0x5A) == EEPROM_SUCCESS && INLINE_Write(1, 0x01) == EEPROM_SUCCESS, "inline values after 16 bit and deleted records");
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "inline values after reset");
+}
+
+
+// inline and 32 bit records are written at random, with page transfers (EEPROM_Poll after each write) and resets
+static void INLINE_Churn(void)
+{
+	EEPROM_Stats Stats;
+	uint32_t Random = 0x12345678;
+
+	TEST_Begin();
+	for (uint32_t i = 0; i < INLINE_WRITES; i++)
+	{
+		Random = Random * 1103515245 + 12345;
+		if (INLINE_Write((Random >> 16) % EEPROM_VARIABLE_COUNT, i) != EEPROM_SUCCESS) { TEST_Check(0, "write of the churn"); return; }
+		EEPROM_Result result = EEPROM_Poll(4);
+		if (result != EEPROM_SUCCESS && result != EEPROM_PENDING) { TEST_Check(0, "EEPROM_Poll of the churn"); return; }
+
+		//reset now and then (replay from the latest checkpoint)
+		if (i % 5000 == 2500) TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values of the churn after reset");
+	}
+	EEPROM_GetStats(&Stats);
+	TEST_Check(Stats.PageTransfers > 10, "page transfers of the churn");
+	TEST_Check(TEST_Holds(), "values of the churn");
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values of the churn after reset");
+}
+
+
+int main(void)
+{
+	INLINE_Format();
+	INLINE_Churn();
+
+	return TEST_Result("%u variables, %u inline names", (unsigned) EEPROM_VARIABLE_COUNT, (unsigned) EEPROM_INLINE_NAMES);
+}
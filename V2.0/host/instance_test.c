@@ -0,0 +1,228 @@
+//tests of the instances (EEPROM_Handle) on the host flash simulator
+//V2.0
+//
+//checks that an instance on the region of the default instance leaves the same flash content and operation counts as the
+//functions without handle, that invalid regions are rejected and that many simulated devices (instances with different
+//page and variable counts on disjoint regions of one flash) run interleaved without disturbing each other or the default
+//instance, every device is reinitialized (simulated reset) and checked against its expected values
+//usage: instance_test
+
+
+//includes
+#define TEST_NAME		"instance_test"
+#include <stdio.h>
+#include <string.h>
+#include "eeprom.h"
+#include "test_check.h"
+
+
+//number of simulated devices (instances), their regions start at INSTANCE_BASE and follow each other
+#define INSTANCE_DEVICES		8
+#define INSTANCE_BASE			(FLASH_BASE + 16 * FLASH_PAGE_SIZE)
+
+//library calls of the interleaved workload and calls between two resets of all devices
+#define INSTANCE_CALLS			20000
+#define INSTANCE_RESET_PERIOD	2500
+
+//simulated device (instance, its storage and the expected value of every variable)
+typedef struct
+{
+	EEPROM_Handle Handle;
+	EEPROM_Region Region;
+	uint16_t Index[EEPROM_MAX_VARIABLE_COUNT];
+	uint8_t SizeTable[EEPROM_MAX_VARIABLE_COUNT];
+	uint8_t Assigned[EEPROM_MAX_VARIABLE_COUNT];
+	uint32_t Values[EEPROM_MAX_VARIABLE_COUNT];
+} INSTANCE_Device;
+
+
+//global variables
+static INSTANCE_Device INSTANCE_Devices[INSTANCE_DEVICES];
+static uint8_t INSTANCE_Image[EEPROM_PAGE_COUNT * FLASH_PAGE_SIZE];
+static FLASHSIM_Counters INSTANCE_Counters;
+static uint32_t INSTANCE_Random = 0x12345678;
+
+
+// returns the next pseudo random number (xorshift32, same sequence on every run)
+static uint32_t INSTANCE_Next(void)
+{
+	INSTANCE_Random ^= INSTANCE_Random << 13;
+	INSTANCE_Random ^= INSTANCE_Random >> 17;
+	INSTANCE_Random ^= INSTANCE_Random << 5;
+	return INSTANCE_Random;
+}
+
+
+// runs the same workload through the functions without handle or through an instance on the default region
+static void INSTANCE_Workload(EEPROM_Handle* Handle)
+{
+	EEPROM_Variable Batch[2] = {{1, EEPROM_SIZE32, {.uInt32 = 7}}, {2, EEPROM_SIZE64, {.Double = 2.5}}};
+	EEPROM_Value Value;
+
+	for (uint16_t i = 0; i < 600; i++)
+	{
+		Value.uInt32 = i * 2654435761U;
+		if (Handle == NULL) EEPROM_WriteVariable(i % EEPROM_VARIABLE_COUNT, Value, (EEPROM_Size) (1 + i % 3));
+		else EEPROM_HandleWriteVariable(Handle, i % EEPROM_VARIABLE_COUNT, Value, (EEPROM_Size) (1 + i % 3));
+	}
+	if (Handle == NULL)
+	{
+		EEPROM_WriteVariables(Batch, 2);
+		EEPROM_IncrementCounter(3, NULL);
+		EEPROM_WriteBlob(4, "instance", 8);
+		EEPROM_DeleteVariable(0);
+	}
+	else
+	{
+		EEPROM_HandleWriteVariables(Handle, Batch, 2);
+		EEPROM_HandleIncrementCounter(Handle, 3, NULL);
+		EEPROM_HandleWriteBlob(Handle, 4, "instance", 8);
+		EEPROM_HandleDeleteVariable(Handle, 0);
+	}
+}
+
+
+// an instance on the region of the default instance behaves exactly like the functions without handle
+static void INSTANCE_Default(void)
+{
+	static uint16_t Index[EEPROM_VARIABLE_COUNT];
+	static uint8_t SizeTable[EEPROM_VARIABLE_COUNT];
+	static const uint8_t ClassPages[] = {EEPROM_PAGE_COUNT};
+	static const uint16_t ClassNames[] = {0};
+	EEPROM_Region Region = {EEPROM_START_ADDRESS, EEPROM_PAGE_COUNT, EEPROM_VARIABLE_COUNT, Index, SizeTable, 1, ClassPages, ClassNames, NULL, NULL};
+	EEPROM_Handle Handle;
+	FLASHSIM_Counters Counters;
+
+	//functions without handle
+	FLASHSIM_Reset();
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS, "EEPROM_Init");
+	INSTANCE_Workload(NULL);
+	memcpy(INSTANCE_Image, FLASHSIM_Map(EEPROM_START_ADDRESS), sizeof(INSTANCE_Image));
+	FLASHSIM_GetCounters(&INSTANCE_Counters);
+
+	//instance on the same region
+	FLASHSIM_Reset();
+	TEST_Check(EEPROM_HandleInit(&Handle, &Region) == EEPROM_SUCCESS, "EEPROM_HandleInit on the default region");
+	INSTANCE_Workload(&Handle);
+	FLASHSIM_GetCounters(&Counters);
+	TEST_Check(memcmp(INSTANCE_Image, FLASHSIM_Map(EEPROM_START_ADDRESS), sizeof(INSTANCE_Image)) == 0, "instance leaves the same flash as the default instance");
+	TEST_Check(Counters.HalfwordPrograms == INSTANCE_Counters.HalfwordPrograms && Counters.PageErases == INSTANCE_Counters.PageErases,
+		"instance programs and erases like the default instance");
+
+	//the default instance reads what the instance wrote
+	EEPROM_Value Value;
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && EEPROM_ReadVariable(1, &Value) == EEPROM_SUCCESS && Value.uInt32 == 7, "default instance reads the instance");
+}
+
+
+// invalid regions are rejected
+static void INSTANCE_Regions(void)
+{
+	static uint16_t Index[EEPROM_MAX_VARIABLE_COUNT];
+	static uint8_t SizeTable[EEPROM_MAX_VARIABLE_COUNT];
+	EEPROM_Handle Handle;
+	EEPROM_Region Region = {INSTANCE_BASE, 2, 4, Index, SizeTable, 0, NULL, NULL, NULL, NULL};
+
+	FLASHSIM_Reset();
+	Region.PageCount = 1;
+	TEST_Check(EEPROM_HandleInit(&Handle, &Region) == EEPROM_NO_VALID_PAGE, "region of one page");
+	Region.PageCount = EEPROM_MAX_PAGE_COUNT + 1;
+	TEST_Check(EEPROM_HandleInit(&Handle, &Region) == EEPROM_NO_VALID_PAGE, "region above EEPROM_MAX_PAGE_COUNT");
+	Region.PageCount = 2;
+	Region.StartAddress = INSTANCE_BASE + 2;
+	TEST_Check(EEPROM_HandleInit(&Handle, &Region) == EEPROM_NO_VALID_PAGE, "region not page aligned");
+	Region.StartAddress = INSTANCE_BASE;
+	Region.VariableCount = EEPROM_MAX_VARIABLE_COUNT + 1;
+	TEST_Check(EEPROM_HandleInit(&Handle, &Region) == EEPROM_INVALID_NAME, "variable count above EEPROM_MAX_VARIABLE_COUNT");
+	Region.VariableCount = 4;
+	Region.Index = NULL;
+	TEST_Check(EEPROM_HandleInit(&Handle, &Region) == EEPROM_INVALID_NAME, "region without index storage");
+	Region.Index = Index;
+	TEST_Check(EEPROM_HandleInit(&Handle, &Region) == EEPROM_SUCCESS, "valid region");
+	TEST_Check(EEPROM_HandleWriteVariable(&Handle, 4, (EEPROM_Value) (uint16_t) 1, EEPROM_SIZE16) == EEPROM_INVALID_NAME, "name above the variable count of the instance");
+}
+
+
+// initializes a device (simulated reset) and checks every variable against its expected value
+static void INSTANCE_Reset(INSTANCE_Device* Device)
+{
+	EEPROM_Value Value;
+
+	TEST_Check(EEPROM_HandleInit(&Device->Handle, &Device->Region) == EEPROM_SUCCESS, "EEPROM_HandleInit of a device");
+	for (uint16_t i = 0; i < Device->Region.VariableCount; i++)
+	{
+		EEPROM_Result result = EEPROM_HandleReadVariable(&Device->Handle, i, &Value);
+		if (Device->Assigned[i]) TEST_Check(result == EEPROM_SUCCESS && Value.uInt32 == Device->Values[i], "device keeps its values");
+		else TEST_Check(result == EEPROM_NOT_ASSIGNED, "device keeps its deleted variables");
+	}
+}
+
+
+// many devices on disjoint regions of one flash, written interleaved, next to the default instance
+static void INSTANCE_Interleaved(void)
+{
+	EEPROM_Value Value;
+	uint32_t Address = INSTANCE_BASE;
+
+	//set up the devices (2 to 4 pages, 4 to EEPROM_MAX_VARIABLE_COUNT variables) and the default instance with a sentinel
+	FLASHSIM_Reset();
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS, "EEPROM_Init");
+	Value.uInt32 = 0xC0FFEE;
+	EEPROM_WriteVariable(0, Value, EEPROM_SIZE32);
+	for (uint8_t i = 0; i < INSTANCE_DEVICES; i++)
+	{
+		INSTANCE_Device* Device = &INSTANCE_Devices[i];
+		memset(Device, 0, sizeof(*Device));
+		Device->Region.StartAddress = Address;
+		Device->Region.PageCount = 2 + i % (EEPROM_MAX_PAGE_COUNT - 1);
+		Device->Region.VariableCount = 4 + i * (EEPROM_MAX_VARIABLE_COUNT - 4) / (INSTANCE_DEVICES - 1);
+		Device->Region.Index = Device->Index;
+		Device->Region.SizeTable = Device->SizeTable;
+		Address += Device->Region.PageCount * FLASH_PAGE_SIZE;
+		INSTANCE_Reset(Device);
+	}
+	TEST_Check(Address <= EEPROM_START_ADDRESS, "device regions fit below the default region");
+
+	//interleaved writes and deletes, all devices are reset periodically
+	for (uint32_t Call = 1; Call <= INSTANCE_CALLS; Call++)
+	{
+		INSTANCE_Device* Device = &INSTANCE_Devices[INSTANCE_Next() % INSTANCE_DEVICES];
+		uint16_t Name = INSTANCE_Next() % Device->Region.VariableCount;
+		EEPROM_Result result;
+		if (INSTANCE_Next() % 16 == 0)
+		{
+			result = EEPROM_HandleDeleteVariable(&Device->Handle, Name);
+			Device->Assigned[Name] = 0;
+		}
+		else
+		{
+			Value.uInt32 = INSTANCE_Next();
+			result = EEPROM_HandleWriteVariable(&Device->Handle, Name, Value, EEPROM_SIZE32);
+			Device->Assigned[Name] = 1;
+			Device->Values[Name] = Value.uInt32;
+		}
+		if (result != EEPROM_SUCCESS) TEST_Check(0, "device write");
+
+		if (Call % INSTANCE_RESET_PERIOD == 0)
+		{
+			for (uint8_t i = 0; i < INSTANCE_DEVICES; i++) INSTANCE_Reset(&INSTANCE_Devices[i]);
+		}
+	}
+
+	//the default instance is untouched, the write counters are kept per instance
+	uint32_t Writes = 0;
+	uint32_t ElidedWrites = 0;
+	EEPROM_GetWriteCounters(&Writes, &ElidedWrites);
+	TEST_Check(EEPROM_ReadVariable(0, &Value) == EEPROM_SUCCESS && Value.uInt32 == 0xC0FFEE && Writes == 1, "default instance untouched by the devices");
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && EEPROM_ReadVariable(0, &Value) == EEPROM_SUCCESS && Value.uInt32 == 0xC0FFEE, "default instance after reset");
+}
+
+
+int main(void)
+{
+	INSTANCE_Default();
+	INSTANCE_Regions();
+	INSTANCE_Interleaved();
+
+	return TEST_Result("%u devices, %u calls", INSTANCE_DEVICES, INSTANCE_CALLS);
+}
@@ -0,0 +1,443 @@
+//power loss fault injection for the EEPROM emulation library on the host flash simulator
+//V2.0
+//
+//replays a workload (writes, deletes, batch writes, blobs, counter increments and transactions) and cuts the power after every single
+//halfword program and in the middle of every page erase, one run per cut (each run is a child process, like a reset
+//the recovery starts with fresh RAM and only the flash image of the cut)
+//after each cut EEPROM_Init recovers from the flash image, then it is checked:
+//every variable holds its value from before or after the interrupted call (a transaction: all of them from before or all from after),
+//the flash was not formatted,
+//the library keeps working (further writes, reinitialization)
+//reports the worst recovery time of EEPROM_Init (a resumed page transfer blocks the boot)
+//usage: powercut [library calls of the workload]
+
+
+//includes
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "eeprom.h"
+
+
+//variables carried forward per EEPROM_Poll call after each library call (incremental page transfer)
+#ifndef POWERCUT_POLL_BUDGET
+#define POWERCUT_POLL_BUDGET	4
+#endif
+
+//idle time after each library call in ns (an asynchronous erase continues in the background meanwhile)
+#ifndef POWERCUT_IDLE_TIME
+#define POWERCUT_IDLE_TIME		50000000
+#endif
+
+//maximum blob length of the workload in bytes
+#ifndef POWERCUT_BLOB_SIZE
+#define POWERCUT_BLOB_SIZE		16
+#endif
+
+//variable name of workload variable i (sparse names: spread over the 14 bit name space in ascending order, 8 names per 256)
+#if EEPROM_SPARSE_NAMES
+#define POWERCUT_NAME(i)		(0x1000 + ((i) / 8) * 0x100 + (i) % 8)
+#else
+#define POWERCUT_NAME(i)		(i)
+#endif
+
+//kind of variable by name: every 16th variable is a blob, every 16th a counter, the others are values
+#define POWERCUT_KIND(Name)		((Name) % 16 == 3 ? POWERCUT_BLOB : (Name) % 16 == 2 ? POWERCUT_COUNTER : POWERCUT_VALUE)
+
+//parts of a page left erased by an interrupted erase (0: first half incl. page status, 1: second half)
+#define POWERCUT_ERASE_PATTERNS	2
+
+//size of the simulated flash in bytes
+#define POWERCUT_IMAGE_SIZE		(1024 * FLASHSIM_FLASH_SIZE)
+
+//expected content of one variable
+typedef enum
+{
+	POWERCUT_NONE,
+	POWERCUT_VALUE,
+	POWERCUT_BLOB,
+	POWERCUT_COUNTER
+} POWERCUT_Kind;
+
+typedef struct
+{
+	uint8_t Kind;																//POWERCUT_Kind
+	uint8_t Size;																//EEPROM_Size of a value
+	uint16_t Length;															//length of a blob
+	uint64_t Value;																//value (masked to its size) or counter value
+	uint8_t Data[POWERCUT_BLOB_SIZE];											//data of a blob
+} POWERCUT_Variable;
+
+//state shared between the runs (child processes) and the main process
+typedef struct
+{
+	uint8_t Image[POWERCUT_IMAGE_SIZE];											//flash content at the power cut
+	POWERCUT_Variable Before[EEPROM_VARIABLE_COUNT];							//variables before the interrupted call
+	POWERCUT_Variable After[EEPROM_VARIABLE_COUNT];								//variables after the interrupted call
+	uint64_t CutOperation;														//flash operation (halfword program or page erase) to cut the power at
+	uint8_t ErasePattern;														//part of the page left erased, if the cut hits an erase
+	uint64_t Operations;														//flash operations of the workload so far
+	uint8_t PowerLost;															//1: the workload was cut, 0: the workload ended before the cut
+	uint8_t Atomic;																//1: the interrupted call is a transaction (all or none of its variables changed)
+	uint8_t CutErase;															//1: the cut hit a page erase
+	uint64_t InitTime;															//modeled time of the recovering EEPROM_Init in ns
+	uint64_t InitPrograms;														//halfwords programmed by the recovering EEPROM_Init
+	uint64_t InitErases;														//pages erased by the recovering EEPROM_Init
+	char Error[200];															//description of a failed check
+} POWERCUT_Shared;
+
+
+//global variables
+static POWERCUT_Shared* POWERCUT_State;
+static uint32_t POWERCUT_Calls = 400;
+static uint32_t POWERCUT_Random;
+
+
+// xorshift32 pseudo random numbers (every run replays the same workload)
+static uint32_t POWERCUT_Rand(void)
+{
+	POWERCUT_Random ^= POWERCUT_Random << 13;
+	POWERCUT_Random ^= POWERCUT_Random >> 17;
+	POWERCUT_Random ^= POWERCUT_Random << 5;
+	return POWERCUT_Random;
+}
+
+
+// ends a run with a failed check
+static void POWERCUT_Fail(const char* Format, ...)
+{
+	va_list Arguments;
+	va_start(Arguments, Format);
+	vsnprintf(POWERCUT_State->Error, sizeof(POWERCUT_State->Error), Format, Arguments);
+	va_end(Arguments);
+	_exit(1);
+}
+
+
+// cuts the power: saves the flash image for the recovery and ends the run (RAM content is lost)
+static void POWERCUT_PowerLoss(void)
+{
+	memcpy(POWERCUT_State->Image, FLASHSIM_Map(FLASHSIM_BASE), POWERCUT_IMAGE_SIZE);
+	POWERCUT_State->PowerLost = 1;
+	_exit(0);
+}
+
+
+// counts flash operations of the workload and cuts the power after the chosen halfword program
+static void POWERCUT_ProgramHook(uint32_t Address, uint16_t Data)
+{
+	if (++POWERCUT_State->Operations == POWERCUT_State->CutOperation) POWERCUT_PowerLoss();
+}
+
+
+// counts flash operations of the workload and cuts the power in the middle of the chosen page erase (half of the page erased)
+static void POWERCUT_EraseHook(uint32_t Address)
+{
+	static const uint8_t Erased[FLASH_PAGE_SIZE / 2] = {[0 ... FLASH_PAGE_SIZE / 2 - 1] = 0xFF};
+
+	if (++POWERCUT_State->Operations != POWERCUT_State->CutOperation) return;
+	POWERCUT_State->CutErase = 1;
+	FLASHSIM_Write(Address + POWERCUT_State->ErasePattern * sizeof(Erased), Erased, sizeof(Erased));
+	POWERCUT_PowerLoss();
+}
+
+
+// checks if a variable in the library matches the expected content
+static uint8_t POWERCUT_Matches(uint16_t Name, const POWERCUT_Variable* Expected)
+{
+	EEPROM_Value Value = {0};
+	const uint8_t* Data;
+	uint16_t Length;
+	EEPROM_Result result = EEPROM_ReadVariable(POWERCUT_NAME(Name), &Value);
+
+	switch (Expected->Kind)
+	{
+		case POWERCUT_VALUE:
+		case POWERCUT_COUNTER: return result == EEPROM_SUCCESS && Value.uInt64 == Expected->Value;
+		case POWERCUT_BLOB:
+			if (EEPROM_ReadBlob(POWERCUT_NAME(Name), &Data, &Length) != EEPROM_SUCCESS) return 0;
+			return Length == Expected->Length && memcmp(Data, Expected->Data, Length) == 0;
+		default: return result == EEPROM_NOT_ASSIGNED && EEPROM_ReadBlob(POWERCUT_NAME(Name), &Data, &Length) == EEPROM_NOT_ASSIGNED;
+	}
+}
+
+
+// picks a random value size and a value masked to it (EEPROM_INLINE_VALUES: 8 bit instead of 16 bit for names with inline records)
+static void POWERCUT_PickValue(POWERCUT_Variable* Variable, uint16_t Name)
+{
+	static const uint64_t Masks[] = {0, 0xFFFF, 0xFFFFFFFF, 0xFFFFFFFFFFFFFFFF};
+
+	Variable->Kind = POWERCUT_VALUE;
+	Variable->Size = EEPROM_SIZE16 + POWERCUT_Rand() % 3;
+	Variable->Value = (((uint64_t) POWERCUT_Rand() << 32) | POWERCUT_Rand()) & Masks[Variable->Size];
+	if (EEPROM_INLINE_VALUES && Variable->Size == EEPROM_SIZE16 && POWERCUT_NAME(Name) < EEPROM_INLINE_NAMES)
+	{
+		Variable->Size = EEPROM_SIZE8;
+		Variable->Value &= 0xFF;
+	}
+}
+
+
+// picks a random variable name of a value
+static uint16_t POWERCUT_PickValueName(void)
+{
+	uint16_t Name;
+	do Name = POWERCUT_Rand() % EEPROM_VARIABLE_COUNT; while (POWERCUT_KIND(Name) != POWERCUT_VALUE);
+	return Name;
+}
+
+
+// lets the library finish background work after a call (flush, page transfer steps, erase time)
+static void POWERCUT_Background(void)
+{
+	if (EEPROM_CACHE_SIZE > 0 && EEPROM_Flush() != EEPROM_SUCCESS) POWERCUT_Fail("EEPROM_Flush failed");
+	if (EEPROM_INCREMENTAL_TRANSFER || EEPROM_CACHE_SIZE > 0 || EEPROM_COMPACT_THRESHOLD > 0)
+	{
+		EEPROM_Result result = EEPROM_Poll(POWERCUT_POLL_BUDGET);
+		if (result != EEPROM_SUCCESS && result != EEPROM_PENDING) POWERCUT_Fail("EEPROM_Poll failed (%d)", result);
+	}
+	FLASHSIM_Elapse(POWERCUT_IDLE_TIME);
+}
+
+
+// run: replays the workload until the power is cut
+// - format the flash (not counted as operations of the workload)
+// - per call: set the expected variables after the call, do the call and the background work, accept the new variables
+static void POWERCUT_Workload(void)
+{
+	POWERCUT_Shared* State = POWERCUT_State;
+
+	//format the flash
+	FLASHSIM_Reset();
+	POWERCUT_Random = 0x12345678;
+	memset(State->Before, 0, sizeof(State->Before));
+	memset(State->After, 0, sizeof(State->After));
+	State->Operations = 0;
+	State->PowerLost = 0;
+	State->CutErase = 0;
+	State->Atomic = 0;
+	if (EEPROM_Init() != EEPROM_SUCCESS) POWERCUT_Fail("EEPROM_Init of the blank flash failed");
+	FLASHSIM_SetProgramHook(POWERCUT_ProgramHook);
+	FLASHSIM_SetEraseHook(POWERCUT_EraseHook);
+
+	for (uint32_t i = 0; i < POWERCUT_Calls; i++)
+	{
+		uint16_t Name = POWERCUT_Rand() % EEPROM_VARIABLE_COUNT;
+		POWERCUT_Variable* After = &State->After[Name];
+		EEPROM_Result result = EEPROM_SUCCESS;
+		uint32_t Kind = POWERCUT_Rand() % 10;
+
+		//blob: new data of random length
+		if (POWERCUT_KIND(Name) == POWERCUT_BLOB)
+		{
+			After->Kind = POWERCUT_BLOB;
+			After->Length = POWERCUT_Rand() % (POWERCUT_BLOB_SIZE + 1);
+			for (uint16_t j = 0; j < After->Length; j++) After->Data[j] = (uint8_t) POWERCUT_Rand();
+			result = EEPROM_WriteBlob(POWERCUT_NAME(Name), After->Data, After->Length);
+			if (result == EEPROM_UNCHANGED) result = EEPROM_SUCCESS;
+		}
+
+		//counter: incremented by one
+		else if (POWERCUT_KIND(Name) == POWERCUT_COUNTER)
+		{
+			After->Kind = POWERCUT_COUNTER;
+			After->Value = (uint32_t) (After->Value + 1);
+			result = EEPROM_IncrementCounter(POWERCUT_NAME(Name), NULL);
+		}
+
+		//value: deleted, written in a batch or a transaction with other values or written alone
+		else if (Kind == 0)
+		{
+			After->Kind = POWERCUT_NONE;
+			result = EEPROM_DeleteVariable(POWERCUT_NAME(Name));
+			if (result == EEPROM_NOT_ASSIGNED) result = EEPROM_SUCCESS;
+		}
+		else if (Kind == 1)
+		{
+			EEPROM_Variable Batch[4];
+			for (uint8_t j = 0; j < 4; j++)
+			{
+				uint16_t Picked = POWERCUT_PickValueName();
+				POWERCUT_PickValue(&State->After[Picked], Picked);
+				Batch[j].Name = POWERCUT_NAME(Picked);
+				Batch[j].Size = State->After[Picked].Size;
+				Batch[j].Value.uInt64 = State->After[Picked].Value;
+			}
+			result = EEPROM_WriteVariables(Batch, 4);
+		}
+		else if (EEPROM_TRANSACTION_SIZE > 0 && Kind == 2)
+		{
+			State->Atomic = 1;
+			result = EEPROM_BeginTransaction();
+			for (uint8_t j = 0; j < 4 && result == EEPROM_SUCCESS; j++)
+			{
+				uint16_t Picked = POWERCUT_PickValueName();
+				POWERCUT_PickValue(&State->After[Picked], Picked);
+				EEPROM_Value Value = {.uInt64 = State->After[Picked].Value};
+				result = EEPROM_WriteVariable(POWERCUT_NAME(Picked), Value, State->After[Picked].Size);
+			}
+			if (result == EEPROM_SUCCESS) result = EEPROM_Commit();
+		}
+		else
+		{
+			POWERCUT_PickValue(After, Name);
+			EEPROM_Value Value = {.uInt64 = After->Value};
+			result = EEPROM_WriteVariable(POWERCUT_NAME(Name), Value, After->Size);
+		}
+		if (result != EEPROM_SUCCESS) POWERCUT_Fail("library call of the workload failed (%d)", result);
+
+		POWERCUT_Background();
+		memcpy(State->Before, State->After, sizeof(State->Before));
+		State->Atomic = 0;
+	}
+}
+
+
+// run: recovers from the flash image of the cut and checks the variables
+// - load the flash image and reinitialize (measure recovery time, detect a format)
+// - check that every variable holds its value from before or after the interrupted call
+// - a transaction: check that all of its variables hold the old or all the new value
+// - check that the library keeps working: write values, reinitialize and check again
+static void POWERCUT_Recovery(void)
+{
+	POWERCUT_Shared* State = POWERCUT_State;
+	POWERCUT_Variable Expected[EEPROM_VARIABLE_COUNT];
+	FLASHSIM_Counters Before, After;
+
+	//load the flash image and reinitialize
+	FLASHSIM_Reset();
+	FLASHSIM_Write(FLASHSIM_BASE, State->Image, POWERCUT_IMAGE_SIZE);
+	FLASHSIM_GetCounters(&Before);
+	EEPROM_Result result = EEPROM_Init();
+	FLASHSIM_GetCounters(&After);
+	State->InitTime = After.Time - Before.Time;
+	State->InitPrograms = After.HalfwordPrograms - Before.HalfwordPrograms;
+	State->InitErases = After.PageErases - Before.PageErases;
+	if (result != EEPROM_SUCCESS) POWERCUT_Fail("EEPROM_Init failed (%d)", result);
+	if (State->InitErases >= EEPROM_PAGE_COUNT) POWERCUT_Fail("EEPROM_Init formatted the flash (%d pages erased)", (int) State->InitErases);
+
+	//check that every variable holds its value from before or after the interrupted call
+	for (uint16_t i = 0; i < EEPROM_VARIABLE_COUNT; i++)
+	{
+		if (POWERCUT_Matches(i, &State->Before[i])) Expected[i] = State->Before[i];
+		else if (POWERCUT_Matches(i, &State->After[i])) Expected[i] = State->After[i];
+		else POWERCUT_Fail("variable %d holds neither its old nor its new value", i);
+	}
+
+	//a transaction: all of its variables hold the old or all the new value
+	for (uint16_t i = 0; i < EEPROM_VARIABLE_COUNT && State->Atomic; i++)
+	{
+		if (memcmp(&State->Before[i], &State->After[i], sizeof(POWERCUT_Variable)) == 0) continue;
+		for (uint16_t j = 0; j < i; j++)
+		{
+			if (memcmp(&State->Before[j], &State->After[j], sizeof(POWERCUT_Variable)) == 0) continue;
+			if (POWERCUT_Matches(i, &State->After[i]) != POWERCUT_Matches(j, &State->After[j])) POWERCUT_Fail("transaction stored variable %d but not %d", i, j);
+		}
+	}
+
+	//check that the library keeps working
+	POWERCUT_Random = 0x9E3779B9;
+	for (uint16_t i = 0; i < 2 * EEPROM_VARIABLE_COUNT; i++)
+	{
+		uint16_t Name = POWERCUT_PickValueName();
+		POWERCUT_PickValue(&Expected[Name], Name);
+		EEPROM_Value Value = {.uInt64 = Expected[Name].Value};
+		result = EEPROM_WriteVariable(POWERCUT_NAME(Name), Value, Expected[Name].Size);
+		if (result != EEPROM_SUCCESS) POWERCUT_Fail("EEPROM_WriteVariable after the recovery failed (%d)", result);
+		POWERCUT_Background();
+	}
+	if (EEPROM_Flush() != EEPROM_SUCCESS) POWERCUT_Fail("EEPROM_Flush after the recovery failed");
+	if (EEPROM_Init() != EEPROM_SUCCESS) POWERCUT_Fail("second EEPROM_Init after the recovery failed");
+	for (uint16_t i = 0; i < EEPROM_VARIABLE_COUNT; i++)
+	{
+		if (!POWERCUT_Matches(i, &Expected[i])) POWERCUT_Fail("variable %d lost its value after the recovery", i);
+	}
+}
+
+
+// runs a function in a child process (fresh RAM of the library in every run)
+// return: exit status of the child (1: check failed, 2: crashed)
+static int POWERCUT_Run(void (*Function)(void))
+{
+	fflush(stdout);
+	pid_t Child = fork();
+	if (Child < 0) { perror("powercut: fork"); exit(2); }
+	if (Child == 0)
+	{
+		Function();
+		_exit(0);
+	}
+
+	int Status;
+	waitpid(Child, &Status, 0);
+	return WIFEXITED(Status) ? WEXITSTATUS(Status) : 2;
+}
+
+
+int main(int argc, char** argv)
+{
+	if (argc > 1) POWERCUT_Calls = (uint32_t) strtoul(argv[1], NULL, 0);
+
+	POWERCUT_State = mmap(NULL, sizeof(POWERCUT_Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (POWERCUT_State == MAP_FAILED) { perror("powercut: mmap"); return 2; }
+
+	printf("%u pages of %u B, %u variables, %u library calls per run\n", (unsigned) EEPROM_PAGE_COUNT, (unsigned) FLASH_PAGE_SIZE, (unsigned) EEPROM_VARIABLE_COUNT, (unsigned) POWERCUT_Calls);
+
+	uint64_t ProgramCuts = 0, EraseCuts = 0, Failures = 0;
+	uint64_t Recoveries = 0, InitTime = 0, MaxInitTime = 0, MaxInitOperation = 0, MaxInitPrograms = 0, MaxInitErases = 0;
+	for (uint64_t Operation = 1; ; Operation++)
+	{
+		//cut the power at the operation (page erase: once per erase pattern)
+		uint8_t ErasePatterns = 1;
+		for (uint8_t Pattern = 0; Pattern < ErasePatterns; Pattern++)
+		{
+			POWERCUT_State->CutOperation = Operation;
+			POWERCUT_State->ErasePattern = Pattern;
+			if (POWERCUT_Run(POWERCUT_Workload) != 0)
+			{
+				printf("workload failed at operation %llu: %s\n", (unsigned long long) Operation, POWERCUT_State->Error);
+				return 1;
+			}
+			if (!POWERCUT_State->PowerLost) goto Done;
+			if (POWERCUT_State->CutErase) ErasePatterns = POWERCUT_ERASE_PATTERNS;
+
+			//recover and check
+			POWERCUT_State->Error[0] = 0;
+			POWERCUT_State->InitTime = 0;
+			int Status = POWERCUT_Run(POWERCUT_Recovery);
+			if (POWERCUT_State->CutErase) EraseCuts++;
+			else ProgramCuts++;
+			if (Status != 0)
+			{
+				if (Failures++ < 10) printf("cut at operation %llu (%s): %s\n", (unsigned long long) Operation,
+					POWERCUT_State->CutErase ? (Pattern == 0 ? "erase, first half erased" : "erase, second half erased") : "halfword program",
+					Status == 1 ? POWERCUT_State->Error : "recovery crashed");
+				continue;
+			}
+
+			//recovery time
+			Recoveries++;
+			InitTime += POWERCUT_State->InitTime;
+			if (POWERCUT_State->InitTime > MaxInitTime)
+			{
+				MaxInitTime = POWERCUT_State->InitTime;
+				MaxInitOperation = Operation;
+				MaxInitPrograms = POWERCUT_State->InitPrograms;
+				MaxInitErases = POWERCUT_State->InitErases;
+			}
+		}
+	}
+
+Done:
+	printf("%llu flash operations: %llu cuts after halfword programs, %llu cuts during page erases, %llu failed\n",
+		(unsigned long long) POWERCUT_State->Operations, (unsigned long long) ProgramCuts, (unsigned long long) EraseCuts, (unsigned long long) Failures);
+	if (Recoveries > 0) printf("recovery EEPROM_Init: avg %.3f ms, max %.3f ms (cut at operation %llu: %llu halfwords programmed, %llu pages erased)\n",
+		InitTime / 1000000.0 / Recoveries, MaxInitTime / 1000000.0, (unsigned long long) MaxInitOperation,
+		(unsigned long long) MaxInitPrograms, (unsigned long long) MaxInitErases);
+
+	return Failures != 0;
+}
@@ -0,0 +1,172 @@
+//tests of the ISR write queue (EEPROM_WriteVariableFromISR) on the host flash simulator
+//V2.0
+//
+//checks that queued writes never touch the flash, are drained by EEPROM_Poll, EEPROM_Flush and the next write of the writer
+//context (coalesced per name, older than the write draining them), that a full queue rejects or overwrites by the overflow policy
+//and that writes queued by a simulated interrupt while the writer context programs the flash are all kept
+//usage: queue_test (built once per overflow policy)
+
+
+//includes
+#define TEST_NAME		"queue_test"
+#include <stdio.h>
+#include <string.h>
+#include "eeprom.h"
+#include "test_check.h"
+
+
+//writes of the interrupt scenario and flash programs between two queued writes of the simulated interrupt
+#define QUEUE_WRITES			5000
+#define QUEUE_INTERRUPT_PERIOD	32
+
+//variables written by the simulated interrupt (the main loop writes the others)
+#define QUEUE_FIRST_ISR_NAME	(EEPROM_VARIABLE_COUNT / 2)
+
+
+//global variables
+static uint32_t QUEUE_Programs = 0;
+static uint32_t QUEUE_Pushes = 0;
+static uint32_t QUEUE_Values[EEPROM_VARIABLE_COUNT];
+
+
+// starts a scenario on a blank flash
+static void QUEUE_Begin(void)
+{
+	FLASHSIM_Reset();
+	FLASHSIM_SetProgramHook(NULL);
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS, "EEPROM_Init");
+}
+
+
+// returns 1 if the variable holds the 32 bit value
+static int QUEUE_Holds(uint16_t VariableName, uint32_t Expected)
+{
+	EEPROM_Value Value;
+	return EEPROM_ReadVariable(VariableName, &Value) == EEPROM_SUCCESS && Value.uInt32 == Expected;
+}
+
+
+// queued writes don't touch the flash, are coalesced per name and drained by EEPROM_Poll, EEPROM_Flush and writes
+static void QUEUE_Drain(void)
+{
+	FLASHSIM_Counters Before, After;
+	EEPROM_Value Value;
+	EEPROM_Stats Stats;
+
+	QUEUE_Begin();
+	FLASHSIM_GetCounters(&Before);
+	Value.uInt32 = 1; TEST_Check(EEPROM_WriteVariableFromISR(0, Value, EEPROM_SIZE32) == EEPROM_SUCCESS, "queue a write");
+	Value.uInt32 = 2; EEPROM_WriteVariableFromISR(1, Value, EEPROM_SIZE32);
+	Value.uInt32 = 3; EEPROM_WriteVariableFromISR(0, Value, EEPROM_SIZE32);
+	TEST_Check(EEPROM_WriteVariableFromISR(EEPROM_VARIABLE_COUNT, Value, EEPROM_SIZE32) == EEPROM_INVALID_NAME, "queue an invalid name");
+	TEST_Check(EEPROM_WriteVariableFromISR(0, Value, EEPROM_SIZE_BLOB) == EEPROM_INVALID_SIZE, "queue a blob size");
+	FLASHSIM_GetCounters(&After);
+	TEST_Check(After.HalfwordPrograms == Before.HalfwordPrograms && After.Reads == Before.Reads, "queued writes don't access the flash");
+	TEST_Check(EEPROM_ReadVariable(0, &Value) == EEPROM_NOT_ASSIGNED, "queued write not seen before the drain");
+
+	//EEPROM_Poll drains, the second write of name 0 wins (one record per name)
+	FLASHSIM_GetCounters(&Before);
+	TEST_Check(EEPROM_Poll(4) == EEPROM_SUCCESS, "EEPROM_Poll drains");
+	FLASHSIM_GetCounters(&After);
+	TEST_Check(QUEUE_Holds(0, 3) && QUEUE_Holds(1, 2), "drained values");
+	TEST_Check(After.HalfwordPrograms - Before.HalfwordPrograms == 2 * 3, "duplicate name coalesced");
+	EEPROM_GetStats(&Stats);
+	TEST_Check(Stats.Writes == 3 && Stats.ElidedWrites == 1 && Stats.QueueHighWater == 3 && Stats.QueueOverflows == 0, "write counters and high-water mark");
+
+	//a write of the writer context drains the older queued write of the same name first
+	Value.uInt32 = 4; EEPROM_WriteVariableFromISR(5, Value, EEPROM_SIZE32);
+	Value.uInt32 = 5; EEPROM_WriteVariable(5, Value, EEPROM_SIZE32);
+	TEST_Check(QUEUE_Holds(5, 5), "direct write after the queued write wins");
+
+	//EEPROM_Flush drains, the values survive a reset
+	Value.uInt32 = 6; EEPROM_WriteVariableFromISR(6, Value, EEPROM_SIZE32);
+	TEST_Check(EEPROM_DeleteVariable(0) == EEPROM_SUCCESS && EEPROM_WriteVariableFromISR(1, Value, EEPROM_SIZE_DELETED) == EEPROM_SUCCESS, "queue a delete");
+	TEST_Check(EEPROM_Flush() == EEPROM_SUCCESS, "EEPROM_Flush drains");
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && QUEUE_Holds(6, 6) && EEPROM_ReadVariable(1, &Value) == EEPROM_NOT_ASSIGNED, "drained values after reset");
+}
+
+
+// a full queue rejects the new write (EEPROM_QUEUE_REJECT) or overwrites the oldest queued write (EEPROM_QUEUE_OVERWRITE)
+static void QUEUE_Overflow(void)
+{
+	const uint16_t Writes = EEPROM_QUEUE_SIZE + 3;
+	EEPROM_Value Value;
+	EEPROM_Stats Stats;
+	uint16_t Rejected = 0;
+
+	QUEUE_Begin();
+	for (uint16_t i = 0; i < Writes; i++)
+	{
+		Value.uInt32 = 100 + i;
+		if (EEPROM_WriteVariableFromISR(i, Value, EEPROM_SIZE32) == EEPROM_FULL) Rejected++;
+	}
+	EEPROM_GetStats(&Stats);
+	TEST_Check(Stats.QueueHighWater == EEPROM_QUEUE_SIZE && Stats.QueueOverflows == 3, "high-water mark and overflows of a full queue");
+	TEST_Check(EEPROM_Poll(4) == EEPROM_SUCCESS, "EEPROM_Poll drains a full queue");
+
+	//the kept writes: the first EEPROM_QUEUE_SIZE (reject) or the last EEPROM_QUEUE_SIZE (overwrite)
+	uint16_t First = EEPROM_QUEUE_OVERFLOW == EEPROM_QUEUE_REJECT ? 0 : 3;
+	TEST_Check(Rejected == (EEPROM_QUEUE_OVERFLOW == EEPROM_QUEUE_REJECT ? 3 : 0), "writes rejected by the overflow policy");
+	for (uint16_t i = 0; i < Writes; i++)
+	{
+		if (i >= First && i < First + EEPROM_QUEUE_SIZE) TEST_Check(QUEUE_Holds(i, 100 + i), "kept write of a full queue");
+		else TEST_Check(EEPROM_ReadVariable(i, &Value) == EEPROM_NOT_ASSIGNED, "lost write of a full queue");
+	}
+
+	//the queue is empty again
+	Value.uInt32 = 200;
+	TEST_Check(EEPROM_WriteVariableFromISR(0, Value, EEPROM_SIZE32) == EEPROM_SUCCESS && EEPROM_Poll(4) == EEPROM_SUCCESS && QUEUE_Holds(0, 200), "queue after overflow");
+}
+
+
+// simulated interrupt: queues a write every QUEUE_INTERRUPT_PERIOD flash programs (it interrupts the writer context while it programs,
+// page transfers and drains included)
+static void QUEUE_Interrupt(uint32_t Address, uint16_t Data)
+{
+	if (++QUEUE_Programs % QUEUE_INTERRUPT_PERIOD != 0) return;
+
+	uint16_t Name = QUEUE_FIRST_ISR_NAME + QUEUE_Pushes % (EEPROM_VARIABLE_COUNT - QUEUE_FIRST_ISR_NAME);
+	EEPROM_Value Value;
+	Value.uInt32 = 0x10000 + QUEUE_Pushes++;
+	if (EEPROM_WriteVariableFromISR(Name, Value, EEPROM_SIZE32) == EEPROM_SUCCESS) QUEUE_Values[Name] = Value.uInt32;
+}
+
+
+// the main loop writes its variables while the simulated interrupt queues writes of its own
+static void QUEUE_Interleaved(void)
+{
+	EEPROM_Value Value;
+	EEPROM_Stats Stats;
+
+	QUEUE_Begin();
+	memset(QUEUE_Values, 0, sizeof(QUEUE_Values));
+	FLASHSIM_SetProgramHook(QUEUE_Interrupt);
+	for (uint32_t i = 0; i < QUEUE_WRITES; i++)
+	{
+		uint16_t Name = i % QUEUE_FIRST_ISR_NAME;
+		Value.uInt32 = i;
+		QUEUE_Values[Name] = i;
+		if (EEPROM_WriteVariable(Name, Value, EEPROM_SIZE32) != EEPROM_SUCCESS || EEPROM_Poll(4) != EEPROM_SUCCESS)
+		{
+			TEST_Check(0, "writes of the main loop");
+			break;
+		}
+	}
+	FLASHSIM_SetProgramHook(NULL);
+	EEPROM_GetStats(&Stats);
+	TEST_Check(QUEUE_Pushes > 100 && Stats.QueueOverflows == 0, "writes queued by the interrupt");
+	TEST_Check(EEPROM_Flush() == EEPROM_SUCCESS && EEPROM_Init() == EEPROM_SUCCESS, "flush and reset");
+
+	for (uint16_t i = 0; i < EEPROM_VARIABLE_COUNT; i++) TEST_Check(QUEUE_Holds(i, QUEUE_Values[i]), "latest value after reset");
+}
+
+
+int main(void)
+{
+	QUEUE_Drain();
+	QUEUE_Overflow();
+	QUEUE_Interleaved();
+
+	return TEST_Result("%u entries, %s, %u writes queued by the interrupt",
+		(unsigned) EEPROM_QUEUE_SIZE, EEPROM_QUEUE_OVERFLOW == EEPROM_QUEUE_REJECT ? "reject" : "overwrite", (unsigned) QUEUE_Pushes);
+}
@@ -0,0 +1,122 @@
+//tests of the sparse variable names (EEPROM_SPARSE_NAMES) on the host flash simulator
+//V2.0
+//
+//checks that any name of the 14 bit name space can be used, that the address index holds at most EEPROM_VARIABLE_COUNT
+//variables at once (a new name to a full index is rejected, a deleted variable frees its entry), and that the values of
+//names coming and going survive page transfers and resets (replay and checkpoints)
+//usage: sparse_test
+
+
+//includes
+#define TEST_NAME		"sparse_test"
+#define TEST_VARIABLES	EEPROM_NAME_COUNT
+#include <stdio.h>
+#include <string.h>
+#include "eeprom.h"
+#include "test_check.h"
+
+
+//writes of the churn scenario and variables alive at once (a window of names sliding over the name space)
+#define SPARSE_WRITES			20000
+#define SPARSE_WINDOW			(EEPROM_VARIABLE_COUNT * 3 / 4)
+
+//name of variable i of a module (modules 0x100 names apart, like the parameters of several modules)
+#define SPARSE_NAME(Module, i)	((Module) * 0x100 + (i))
+
+
+// names of the whole 14 bit name space are valid, names above are rejected
+static void SPARSE_Names(void)
+{
+	EEPROM_Value Value = {.uInt32 = 7};
+	const uint8_t Data[3] = {1, 2, 3};
+	uint32_t Counter;
+
+	TEST_Begin();
+	TEST_Check(TEST_Write(0, 1, EEPROM_SIZE32) == EEPROM_SUCCESS && TEST_Write(EEPROM_NAME_COUNT - 1, 2, EEPROM_SIZE32) == EEPROM_SUCCESS, "lowest and highest name");
+	TEST_Check(EEPROM_WriteVariable(EEPROM_NAME_COUNT, Value, EEPROM_SIZE32) == EEPROM_INVALID_NAME, "name above the name space");
+	TEST_Check(EEPROM_ReadVariable(EEPROM_NAME_COUNT, &Value) == EEPROM_INVALID_NAME, "read of a name above the name space");
+	TEST_Check(EEPROM_WriteBlob(SPARSE_NAME(0x12, 3), Data, sizeof(Data)) == EEPROM_SUCCESS, "blob of a sparse name");
+	TEST_Check(EEPROM_IncrementCounter(SPARSE_NAME(0x13, 4), &Counter) == EEPROM_SUCCESS && Counter == 1, "counter of a sparse name");
+	TEST_Expect(SPARSE_NAME(0x13, 4), 1, EEPROM_SIZE32);
+	TEST_Check(EEPROM_ReadVariable(SPARSE_NAME(0x12, 4), &Value) == EEPROM_NOT_ASSIGNED, "neighbour name not assigned");
+	TEST_Check(EEPROM_DeleteVariable(SPARSE_NAME(0x14, 0)) == EEPROM_SUCCESS, "delete of a name never written");
+
+	//the values survive a reset
+	const uint8_t* Read;
+	uint16_t Length;
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values after reset");
+	TEST_Check(EEPROM_ReadBlob(SPARSE_NAME(0x12, 3), &Read, &Length) == EEPROM_SUCCESS && Length == sizeof(Data) && memcmp(Read, Data, Length) == 0,
+		"blob after reset");
+}
+
+
+// a full address index rejects new names (single and batch writes), a deleted variable frees its entry
+static void SPARSE_Full(void)
+{
+	EEPROM_Variable Batch[2] = {{SPARSE_NAME(0x0F, 0), EEPROM_SIZE16, {.uInt16 = 1}}, {SPARSE_NAME(0x0F, 1), EEPROM_SIZE16, {.uInt16 = 2}}};
+	EEPROM_Value Value = {.uInt32 = 7};
+
+	TEST_Begin();
+	for (uint16_t i = 0; i < EEPROM_VARIABLE_COUNT; i++) TEST_Check(TEST_Write(SPARSE_NAME(0x10 + i, i), i, EEPROM_SIZE32) == EEPROM_SUCCESS, "write up to a full index");
+	TEST_Check(EEPROM_WriteVariable(SPARSE_NAME(0x0F, 0), Value, EEPROM_SIZE32) == EEPROM_FULL, "new name to a full index");
+	TEST_Check(TEST_Write(SPARSE_NAME(0x10, 0), 100, EEPROM_SIZE32) == EEPROM_SUCCESS, "assigned name to a full index");
+	TEST_Check(TEST_Write(SPARSE_NAME(0x11, 1), 0, EEPROM_SIZE_DELETED) == EEPROM_SUCCESS, "delete frees an entry");
+	TEST_Check(EEPROM_WriteVariables(Batch, 2) == EEPROM_FULL && EEPROM_ReadVariable(SPARSE_NAME(0x0F, 0), &Value) == EEPROM_NOT_ASSIGNED,
+		"batch of more new names than free entries writes nothing");
+	TEST_Check(TEST_Write(SPARSE_NAME(0x0F, 0), 200, EEPROM_SIZE32) == EEPROM_SUCCESS, "new name takes the freed entry");
+
+	//a new name twice in a batch takes one entry
+	EEPROM_Variable Twice[4] = {{SPARSE_NAME(0x0F, 7), EEPROM_SIZE16, {.uInt16 = 3}}, {SPARSE_NAME(0x10, 0), EEPROM_SIZE16, {.uInt16 = 4}},
+		{SPARSE_NAME(0x0F, 7), EEPROM_SIZE16, {.uInt16 = 5}}, {SPARSE_NAME(0x12, 2), EEPROM_SIZE16, {.uInt16 = 6}}};
+	TEST_Check(TEST_Write(SPARSE_NAME(0x13, 3), 0, EEPROM_SIZE_DELETED) == EEPROM_SUCCESS && EEPROM_WriteVariables(Twice, 4) == EEPROM_SUCCESS,
+		"batch of a new name twice to one free entry");
+	for (uint16_t i = 1; i < 4; i++) TEST_Expect(Twice[i].Name, Twice[i].Value.uInt16, EEPROM_SIZE16);
+	TEST_Check(TEST_Holds(), "values of a full index");
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values of a full index after reset");
+}
+
+
+// names come and go over the whole name space (a sliding window of live variables), with page transfers (EEPROM_Poll after each write) and resets
+static void SPARSE_Churn(void)
+{
+	EEPROM_Stats Stats;
+	uint16_t Window[SPARSE_WINDOW];
+	uint16_t Next = 0;
+	uint32_t Random = 0x12345678;
+
+	TEST_Begin();
+	for (uint32_t i = 0; i < SPARSE_WRITES; i++)
+	{
+		Random = Random * 1103515245 + 12345;
+
+		//every 8th write moves the window on: delete its oldest name, take a new one
+		if (i % 8 == 0)
+		{
+			uint16_t Slot = Next % SPARSE_WINDOW;
+			if (Next >= SPARSE_WINDOW && TEST_Write(Window[Slot], 0, EEPROM_SIZE_DELETED) != EEPROM_SUCCESS) { TEST_Check(0, "delete of the churn"); return; }
+			Window[Slot] = (uint16_t) ((Next * 4099U) % EEPROM_NAME_COUNT);
+			Next++;
+		}
+		uint16_t Count = Next < SPARSE_WINDOW ? Next : SPARSE_WINDOW;
+		if (TEST_Write(Window[(Random >> 16) % Count], i, EEPROM_SIZE32) != EEPROM_SUCCESS) { TEST_Check(0, "write of the churn"); return; }
+		EEPROM_Result result = EEPROM_Poll(4);
+		if (result != EEPROM_SUCCESS && result != EEPROM_PENDING) { TEST_Check(0, "EEPROM_Poll of the churn"); return; }
+
+		//reset now and then (replay from the latest checkpoint)
+		if (i % 5000 == 2500) TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values of the churn after reset");
+	}
+	EEPROM_GetStats(&Stats);
+	TEST_Check(Stats.PageTransfers > 10, "page transfers of the churn");
+	TEST_Check(TEST_Holds(), "values of the churn");
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values of the churn after reset");
+}
+
+
+int main(void)
+{
+	SPARSE_Names();
+	SPARSE_Full();
+	SPARSE_Churn();
+
+	return TEST_Result("%u entries, %u names", (unsigned) EEPROM_VARIABLE_COUNT, (unsigned) EEPROM_NAME_COUNT);
+}
@@ -0,0 +1,182 @@
+//host stand-in for the STM32F1XX HAL-Driver (flash driver only)
+//the flash is backed by the simulator in flash_sim.c
+
+
+//define to prevent recursive inclusion
+#ifndef __STM32F1xx_HAL_H
+#define __STM32F1xx_HAL_H
+
+//includes
+#include <stddef.h>
+#include <stdint.h>
+#include "flash_sim.h"
+
+//------------------------------------------------core definitions-------------------------------------------
+
+#define __IO						volatile
+
+//data memory barrier (CMSIS): a full compiler and memory barrier on the host
+#define __DMB()						__sync_synchronize()
+
+typedef enum
+{
+	HAL_OK						= 0x00,
+	HAL_ERROR					= 0x01,
+	HAL_BUSY					= 0x02,
+	HAL_TIMEOUT					= 0x03
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+	HAL_UNLOCKED				= 0x00,
+	HAL_LOCKED					= 0x01
+} HAL_LockTypeDef;
+
+//lock of a HAL driver (returns HAL_BUSY from the calling function if it is taken)
+#define __HAL_LOCK(__HANDLE__)		do { if ((__HANDLE__)->Lock == HAL_LOCKED) return HAL_BUSY; (__HANDLE__)->Lock = HAL_LOCKED; } while (0)
+#define __HAL_UNLOCK(__HANDLE__)	do { (__HANDLE__)->Lock = HAL_UNLOCKED; } while (0)
+
+//------------------------------------------------flash definitions------------------------------------------
+
+#define FLASH_BASE					FLASHSIM_BASE
+#define FLASH_PAGE_SIZE				FLASHSIM_PAGE_SIZE
+
+#define FLASH_TYPEPROGRAM_HALFWORD	0x01
+#define FLASH_TYPEPROGRAM_WORD		0x02
+#define FLASH_TYPEPROGRAM_DOUBLEWORD	0x03
+
+#define FLASH_TYPEERASE_PAGES		0x00
+#define FLASH_TYPEERASE_MASSERASE	0x02
+
+//end addresses of the banks (FLASH_BANK2_END only on devices with two banks)
+#if FLASHSIM_BANK1_SIZE < FLASHSIM_FLASH_SIZE
+#define FLASH_BANK1_END				(FLASH_BASE + 1024 * FLASHSIM_BANK1_SIZE - 1)
+#define FLASH_BANK2_END				(FLASH_BASE + 1024 * FLASHSIM_FLASH_SIZE - 1)
+#else
+#define FLASH_BANK1_END				(FLASH_BASE + 1024 * FLASHSIM_FLASH_SIZE - 1)
+#endif
+
+#define FLASH_BANK_1				0x01
+#define FLASH_BANK_2				0x02
+#define FLASH_BANK_BOTH				0x03
+
+typedef struct
+{
+	uint32_t TypeErase;
+	uint32_t Banks;
+	uint32_t PageAddress;
+	uint32_t NbPages;
+} FLASH_EraseInitTypeDef;
+
+//state of the flash driver (error code of the last operation and lock)
+typedef struct
+{
+	__IO uint32_t ErrorCode;
+	HAL_LockTypeDef Lock;
+} FLASH_ProcessTypeDef;
+
+#define HAL_FLASH_ERROR_NONE		0x00
+#define HAL_FLASH_ERROR_PROG		0x01
+#define HAL_FLASH_ERROR_WRP			0x02
+
+extern FLASH_ProcessTypeDef pFlash;
+
+//timeout of FLASH_WaitForLastOperation in ms
+#define FLASH_TIMEOUT_VALUE			50000U
+
+uint32_t HAL_GetTick(void);
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef* pEraseInit, uint32_t* PageError);
+HAL_StatusTypeDef HAL_FLASHEx_Erase_IT(FLASH_EraseInitTypeDef* pEraseInit);
+void HAL_FLASH_IRQHandler(void);
+void HAL_FLASH_EndOfOperationCallback(uint32_t ReturnValue);
+void HAL_FLASH_OperationErrorCallback(uint32_t ReturnValue);
+HAL_StatusTypeDef FLASH_WaitForLastOperation(uint32_t Timeout);
+#if defined(FLASH_BANK2_END)
+HAL_StatusTypeDef FLASH_WaitForLastOperationBank2(uint32_t Timeout);
+#endif
+
+//------------------------------------------------flash registers--------------------------------------------
+
+//register block of the flash controller: the simulator models the program bit (FLASH_CR_PG) of the control registers,
+//the status flags are read and cleared (write 1 to clear) by the flag macros of the HAL
+typedef struct
+{
+	__IO uint32_t ACR;
+	__IO uint32_t KEYR;
+	__IO uint32_t OPTKEYR;
+	__IO uint32_t SR;
+	__IO uint32_t CR;
+	__IO uint32_t AR;
+	uint32_t RESERVED;
+	__IO uint32_t OBR;
+	__IO uint32_t WRPR;
+#if defined(FLASH_BANK2_END)
+	uint32_t RESERVED2[8];
+	__IO uint32_t KEYR2;
+	uint32_t RESERVED3;
+	__IO uint32_t SR2;
+	__IO uint32_t CR2;
+	__IO uint32_t AR2;
+#endif
+} FLASH_TypeDef;
+
+extern FLASH_TypeDef FLASHSIM_Registers;
+#define FLASH						(&FLASHSIM_Registers)
+
+#define FLASH_SR_BSY				0x01U
+#define FLASH_SR_PGERR				0x04U
+#define FLASH_SR_WRPRTERR			0x10U
+#define FLASH_SR_EOP				0x20U
+#define FLASH_CR_PG					0x01U
+
+#define FLASH_FLAG_BSY				FLASH_SR_BSY
+#define FLASH_FLAG_PGERR			FLASH_SR_PGERR
+#define FLASH_FLAG_WRPERR			FLASH_SR_WRPRTERR
+#define FLASH_FLAG_EOP				FLASH_SR_EOP
+#if defined(FLASH_BANK2_END)
+#define FLASH_FLAG_BANK2			0x80000000U
+#define FLASH_FLAG_BSY_BANK2		(FLASH_SR_BSY | FLASH_FLAG_BANK2)
+#define FLASH_FLAG_PGERR_BANK2		(FLASH_SR_PGERR | FLASH_FLAG_BANK2)
+#define FLASH_FLAG_WRPERR_BANK2		(FLASH_SR_WRPRTERR | FLASH_FLAG_BANK2)
+#define FLASH_FLAG_EOP_BANK2		(FLASH_SR_EOP | FLASH_FLAG_BANK2)
+#endif
+
+//status flags (FLASH_FLAG_xxx, bank 2 flags of XL-density devices FLASH_FLAG_xxx_BANK2): get one, clear some
+uint32_t FLASHSIM_GetFlag(uint32_t Flag);
+void FLASHSIM_ClearFlag(uint32_t Flags);
+
+#define __HAL_FLASH_GET_FLAG(__FLAG__)		FLASHSIM_GetFlag(__FLAG__)
+#define __HAL_FLASH_CLEAR_FLAG(__FLAG__)	FLASHSIM_ClearFlag(__FLAG__)
+
+//--------------------------flash read access, timestamp and burst programming of the library----------------
+
+#define EEPROM_READ16(Address)		FLASHSIM_Read16(Address)
+#define EEPROM_READ32(Address)		FLASHSIM_Read32(Address)
+#define EEPROM_POINTER(Address)		FLASHSIM_Map(Address)
+
+//timestamp of the write latency statistic: modeled time in us
+#define EEPROM_TIMESTAMP()			FLASHSIM_Timestamp()
+
+//burst programming hooks of the library (EEPROM_BURST_PROGRAM): the simulator models program mode like the flash registers,
+//entering it costs ProgramCall like a HAL_FLASH_Program call, every halfword only BurstHalfword, FLASHSIM_BurstCheck and
+//FLASHSIM_BurstEnd return the error flags of the burst (HAL_FLASH_Program or an erase in program mode is an error)
+//FLASHSIM_REGISTERS: the library's own hooks on the flash registers are built instead, they write with FLASHSIM_Write16
+HAL_StatusTypeDef FLASHSIM_BurstBegin(uint32_t Address);
+HAL_StatusTypeDef FLASHSIM_BurstWrite(uint32_t Address, uint16_t Data);
+HAL_StatusTypeDef FLASHSIM_BurstCheck(uint32_t Address);
+HAL_StatusTypeDef FLASHSIM_BurstEnd(uint32_t Address);
+
+#if FLASHSIM_REGISTERS
+#define EEPROM_WRITE16(Address, Data)		FLASHSIM_Write16(Address, Data)
+#else
+#define EEPROM_BURST_BEGIN(Address)			FLASHSIM_BurstBegin(Address)
+#define EEPROM_BURST_WRITE(Address, Data)	FLASHSIM_BurstWrite(Address, Data)
+#define EEPROM_BURST_CHECK(Address)			FLASHSIM_BurstCheck(Address)
+#define EEPROM_BURST_END(Address)			FLASHSIM_BurstEnd(Address)
+#endif
+
+#endif
@@ -0,0 +1,160 @@
+//check counting of the host tests (C and C++), each test defines TEST_NAME (its name in the output) before including it
+//V2.0
+//
+//a test of the library defines TEST_VARIABLES (number of its test variables) too for the model of the expected values
+//(TEST_Write, TEST_Expect, TEST_Holds ...), and TEST_VARIABLE_NAME(i) if test variable i isn't variable name i
+
+
+//define to prevent recursive inclusion
+#ifndef __TEST_CHECK_H
+#define __TEST_CHECK_H
+
+//includes
+#include <stdarg.h>
+#include <stdio.h>
+
+#ifndef TEST_NAME
+#error "TEST_NAME must be defined before including test_check.h"
+#endif
+
+
+//global variables
+static unsigned TEST_Checks = 0;
+static unsigned TEST_Failures = 0;
+
+
+#if defined(__GNUC__)
+static int TEST_Result(const char* Format, ...) __attribute__((format(printf, 1, 2)));
+#endif
+
+
+// counts a check and reports it if it failed
+static void TEST_Check(int Passed, const char* Description)
+{
+	TEST_Checks++;
+	if (Passed) return;
+	TEST_Failures++;
+	printf("%s: failed: %s\n", TEST_NAME, Description);
+}
+
+
+// prints the result line of the test: the check counts and the configuration (printf format, in parentheses)
+//
+// Format:	format of the configuration, followed by its arguments
+// return:	exit code of the test (0: all checks passed, 1: a check failed)
+static int TEST_Result(const char* Format, ...)
+{
+	va_list Arguments;
+	printf("%s: %u checks, %u failed (", TEST_NAME, TEST_Checks, TEST_Failures);
+	va_start(Arguments, Format);
+	vprintf(Format, Arguments);
+	va_end(Arguments);
+	printf(")\n");
+	return TEST_Failures != 0;
+}
+
+
+#ifdef TEST_VARIABLES
+//model of the expected values (inline functions, a test uses a part of them)
+#include <string.h>
+#include "eeprom.h"
+#include "flash_sim.h"
+
+//variable name of test variable i
+#ifndef TEST_VARIABLE_NAME
+#define TEST_VARIABLE_NAME(i)	(i)
+#endif
+
+//idle time between EEPROM_Poll calls in ns (an asynchronous erase continues in the background meanwhile)
+#define TEST_IDLE_TIME			10000000
+
+
+//global variables
+static uint64_t TEST_Values[TEST_VARIABLES];
+static uint8_t TEST_Sizes[TEST_VARIABLES];			//size of the expected value (EEPROM_SIZE_DELETED: not assigned)
+
+
+// starts a scenario on a blank flash (no variable assigned)
+static inline void TEST_Begin(void)
+{
+	FLASHSIM_Reset();
+	memset(TEST_Sizes, EEPROM_SIZE_DELETED, sizeof(TEST_Sizes));
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS, "EEPROM_Init");
+}
+
+
+// returns the halfwords programmed since the last call
+static inline uint64_t TEST_Programs(void)
+{
+	FLASHSIM_Counters Counters;
+	FLASHSIM_GetCounters(&Counters);
+	FLASHSIM_ClearCounters();
+	return Counters.HalfwordPrograms;
+}
+
+
+// returns a value cut to a variable size
+static inline uint64_t TEST_Cut(uint64_t Value, EEPROM_Size Size)
+{
+	if (Size == EEPROM_SIZE8) return (uint8_t) Value;
+	if (Size == EEPROM_SIZE16) return (uint16_t) Value;
+	if (Size == EEPROM_SIZE32) return (uint32_t) Value;
+	return Value;
+}
+
+
+// records a value of test variable i as expected (size EEPROM_SIZE_DELETED: not assigned)
+static inline void TEST_Expect(uint16_t i, uint64_t Value, EEPROM_Size Size)
+{
+	TEST_Values[i] = TEST_Cut(Value, Size);
+	TEST_Sizes[i] = Size;
+}
+
+
+// writes a value of test variable i without recording it (deleted for size EEPROM_SIZE_DELETED)
+static inline EEPROM_Result TEST_Store(uint16_t i, uint64_t Value, EEPROM_Size Size)
+{
+	EEPROM_Value Written;
+	Written.uInt64 = TEST_Cut(Value, Size);
+	if (Size == EEPROM_SIZE_DELETED) return EEPROM_DeleteVariable(TEST_VARIABLE_NAME(i));
+	return EEPROM_WriteVariable(TEST_VARIABLE_NAME(i), Written, Size);
+}
+
+
+// writes a value of test variable i and records it as expected if the write succeeds
+static inline EEPROM_Result TEST_Write(uint16_t i, uint64_t Value, EEPROM_Size Size)
+{
+	EEPROM_Result result = TEST_Store(i, Value, Size);
+	if (result == EEPROM_SUCCESS) TEST_Expect(i, Value, Size);
+	return result;
+}
+
+
+// returns 1 if every test variable holds its expected value (or is not assigned), in the shadow too
+static inline int TEST_Holds(void)
+{
+	for (uint16_t i = 0; i < TEST_VARIABLES; i++)
+	{
+		EEPROM_Value Value;
+		Value.uInt64 = 0;
+		EEPROM_Result result = EEPROM_ReadVariable(TEST_VARIABLE_NAME(i), &Value);
+		if (TEST_Sizes[i] == EEPROM_SIZE_DELETED ? result != EEPROM_NOT_ASSIGNED : result != EEPROM_SUCCESS || Value.uInt64 != TEST_Values[i]) return 0;
+#if EEPROM_SHADOW
+		if (TEST_Sizes[i] != EEPROM_SIZE_DELETED && EEPROM_ReadShadow(TEST_VARIABLE_NAME(i)).uInt64 != TEST_Values[i]) return 0;
+#endif
+	}
+	return 1;
+}
+
+
+// runs EEPROM_Poll until no page transfer is left
+// return: result of the last EEPROM_Poll
+static inline EEPROM_Result TEST_Finish(void)
+{
+	EEPROM_Result result;
+	while ((result = EEPROM_Poll(EEPROM_VARIABLE_COUNT)) == EEPROM_PENDING) FLASHSIM_Elapse(TEST_IDLE_TIME);
+	return result;
+}
+#endif
+
+#endif
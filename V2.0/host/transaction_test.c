@@ -0,0 +1,224 @@
+//tests of the transactions (EEPROM_TRANSACTION_SIZE) on the host flash simulator
+//V2.0
+//
+//checks that reads see the writes of an open transaction, that EEPROM_AbortTransaction and a flash error drop all of them,
+//that a write of another class or above the transaction size is rejected without dropping them, that EEPROM_Commit stores all
+//of them with one halfword program, that a reset before the commit keeps the values from before the transaction, and that
+//random transactions (committed and aborted) survive page transfers and resets
+//usage: transaction_test
+
+
+//includes
+#define TEST_NAME		"transaction_test"
+#define TEST_VARIABLES	EEPROM_VARIABLE_COUNT
+#include <stdio.h>
+#include <string.h>
+#include "eeprom.h"
+#include "flash_sim.h"
+
+//variable name of test variable i (sparse names: spread over the 14 bit name space, 0 ... 7 and 8 ... 15 in the classes of the config)
+#if EEPROM_SPARSE_NAMES
+#define TEST_VARIABLE_NAME(i)	(0x100 * (i) + 7)
+#endif
+#include "test_check.h"
+
+
+//transactions of the churn scenario
+#define TRANSACTION_CHURN		4000
+
+//size of the simulated flash in bytes
+#define TRANSACTION_IMAGE_SIZE	(1024 * FLASHSIM_FLASH_SIZE)
+
+//bytes of a 32 bit record (header, value and CRC)
+#define TRANSACTION_RECORD_BYTES	(6 + (EEPROM_CRC ? 2 : 0))
+
+//test variables per class (the variables of a transaction are of one class)
+#define TRANSACTION_CLASS_VARIABLES	(EEPROM_VARIABLE_COUNT / EEPROM_CLASS_COUNT)
+
+
+//global variables
+static uint8_t TRANSACTION_Image[TRANSACTION_IMAGE_SIZE];
+
+
+// reads see the writes of the open transaction, an abort drops them, a commit stores them with one more halfword program
+static void TRANSACTION_Semantics(void)
+{
+	EEPROM_Value Value = {0};
+
+	TEST_Begin();
+	for (uint16_t i = 0; i < 3; i++)
+	{
+		TEST_Check(TEST_Store(i, 100 + i, EEPROM_SIZE32) == EEPROM_SUCCESS, "write before the transaction");
+		TEST_Expect(i, 100 + i, EEPROM_SIZE32);
+	}
+
+	//reads see the writes of the open transaction, an abort restores the values from before
+	TEST_Check(EEPROM_BeginTransaction() == EEPROM_SUCCESS, "EEPROM_BeginTransaction");
+	TEST_Check(EEPROM_BeginTransaction() == EEPROM_BUSY, "second EEPROM_BeginTransaction");
+	TEST_Check(TEST_Store(0, 200, EEPROM_SIZE32) == EEPROM_SUCCESS && TEST_Store(1, 0, EEPROM_SIZE_DELETED) == EEPROM_SUCCESS &&
+		TEST_Store(3, 203, EEPROM_SIZE64) == EEPROM_SUCCESS, "writes of the transaction");
+	TEST_Check(EEPROM_ReadVariable(TEST_VARIABLE_NAME(0), &Value) == EEPROM_SUCCESS && Value.uInt32 == 200, "read of a value of the open transaction");
+	TEST_Check(EEPROM_ReadVariable(TEST_VARIABLE_NAME(1), &Value) == EEPROM_NOT_ASSIGNED, "read of a delete of the open transaction");
+	TEST_Check(EEPROM_AbortTransaction() == EEPROM_SUCCESS && TEST_Holds(), "values after EEPROM_AbortTransaction");
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values of the aborted transaction after reset");
+
+	//a commit takes one halfword program more than the writes of the transaction, an empty transaction none
+	TEST_Programs();
+	TEST_Check(TEST_Store(2, 202, EEPROM_SIZE32) == EEPROM_SUCCESS, "write without transaction");
+	uint64_t Programs = TEST_Programs();
+	TEST_Check(EEPROM_BeginTransaction() == EEPROM_SUCCESS && TEST_Store(2, 302, EEPROM_SIZE32) == EEPROM_SUCCESS &&
+		EEPROM_Commit() == EEPROM_SUCCESS && TEST_Programs() == Programs + 1, "commit halfword of a transaction");
+	TEST_Expect(2, 302, EEPROM_SIZE32);
+	TEST_Check(EEPROM_BeginTransaction() == EEPROM_SUCCESS && EEPROM_Commit() == EEPROM_SUCCESS && TEST_Programs() == 0, "empty transaction");
+	TEST_Check(EEPROM_Commit() == EEPROM_SUCCESS && EEPROM_AbortTransaction() == EEPROM_SUCCESS, "EEPROM_Commit and EEPROM_AbortTransaction without transaction");
+
+	//a committed transaction (a variable written twice, a batch write) survives a reset
+	EEPROM_Variable Batch[2] = {{TEST_VARIABLE_NAME(4), EEPROM_SIZE16, {.uInt16 = 404}}, {TEST_VARIABLE_NAME(0), EEPROM_SIZE16, {.uInt16 = 400}}};
+	TEST_Check(EEPROM_BeginTransaction() == EEPROM_SUCCESS && TEST_Store(0, 300, EEPROM_SIZE32) == EEPROM_SUCCESS &&
+		TEST_Store(1, 301, EEPROM_SIZE64) == EEPROM_SUCCESS && EEPROM_WriteVariables(Batch, 2) == EEPROM_SUCCESS && EEPROM_Commit() == EEPROM_SUCCESS,
+		"committed transaction");
+	TEST_Expect(0, 400, EEPROM_SIZE16);
+	TEST_Expect(1, 301, EEPROM_SIZE64);
+	TEST_Expect(4, 404, EEPROM_SIZE16);
+	TEST_Check(TEST_Holds(), "values of the committed transaction");
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values of the committed transaction after reset");
+}
+
+
+// blobs, counters, another class and too many variables are rejected, the transaction stays; a flash error drops it: EEPROM_Commit returns the error
+static void TRANSACTION_Rejects(void)
+{
+	uint32_t Counter = 0;
+	EEPROM_Stats Stats;
+
+	TEST_Begin();
+	TEST_Check(TEST_Store(0, 1, EEPROM_SIZE32) == EEPROM_SUCCESS, "write before the transaction");
+	TEST_Expect(0, 1, EEPROM_SIZE32);
+	TEST_Check(EEPROM_BeginTransaction() == EEPROM_SUCCESS && EEPROM_WriteBlob(TEST_VARIABLE_NAME(1), "blob", 4) == EEPROM_INVALID_SIZE &&
+		EEPROM_IncrementCounter(TEST_VARIABLE_NAME(2), &Counter) == EEPROM_INVALID_SIZE && EEPROM_Commit() == EEPROM_SUCCESS, "blob and counter in a transaction");
+
+	//too many variables (the configurations allow fewer variables per transaction than per class): the variables written before stay
+	TEST_Check(EEPROM_BeginTransaction() == EEPROM_SUCCESS, "EEPROM_BeginTransaction");
+	EEPROM_Result result = EEPROM_SUCCESS;
+	for (uint16_t i = 0; i <= EEPROM_TRANSACTION_SIZE && result == EEPROM_SUCCESS; i++) result = TEST_Store(i, 2, EEPROM_SIZE32);
+	TEST_Check(result == EEPROM_FULL, "variable above the transaction size");
+	TEST_Check(TEST_Store(0, 3, EEPROM_SIZE32) == EEPROM_SUCCESS && EEPROM_Commit() == EEPROM_SUCCESS, "commit of the full transaction");
+	for (uint16_t i = 0; i < EEPROM_TRANSACTION_SIZE; i++) TEST_Expect(i, i == 0 ? 3 : 2, EEPROM_SIZE32);
+	TEST_Check(TEST_Holds(), "values of the full transaction");
+
+	//another class (single and batch write): the variables written before stay
+#if EEPROM_CLASS_COUNT > 1
+	EEPROM_Variable Batch[2] = {{TEST_VARIABLE_NAME(2), EEPROM_SIZE32, {.uInt32 = 5}}, {TEST_VARIABLE_NAME(TRANSACTION_CLASS_VARIABLES), EEPROM_SIZE32, {.uInt32 = 5}}};
+	TEST_Check(EEPROM_BeginTransaction() == EEPROM_SUCCESS && TEST_Store(0, 4, EEPROM_SIZE32) == EEPROM_SUCCESS &&
+		TEST_Store(TRANSACTION_CLASS_VARIABLES, 4, EEPROM_SIZE32) == EEPROM_INVALID_NAME && EEPROM_WriteVariables(Batch, 2) == EEPROM_INVALID_NAME,
+		"variable of another class");
+	TEST_Check(TEST_Store(1, 4, EEPROM_SIZE32) == EEPROM_SUCCESS && EEPROM_Commit() == EEPROM_SUCCESS, "commit after a variable of another class");
+	TEST_Expect(0, 4, EEPROM_SIZE32);
+	TEST_Expect(1, 4, EEPROM_SIZE32);
+	TEST_Check(TEST_Holds(), "values of the transaction with a variable of another class");
+#endif
+
+	//flash error (a halfword of the next record programmed beforehand): the transaction is dropped, EEPROM_Commit returns the error
+	uint16_t Defect = 0xFFFE;
+	EEPROM_GetStats(&Stats);
+	TEST_Check(EEPROM_BeginTransaction() == EEPROM_SUCCESS && TEST_Store(0, 6, EEPROM_SIZE32) == EEPROM_SUCCESS, "write before the flash error");
+	FLASHSIM_Write(EEPROM_PAGE_ADDRESS(0) + Stats.PageFill + 2 + TRANSACTION_RECORD_BYTES, &Defect, 2);
+	TEST_Check(TEST_Store(1, 6, EEPROM_SIZE32) == EEPROM_ERROR && TEST_Store(2, 6, EEPROM_SIZE32) == EEPROM_ERROR &&
+		EEPROM_Commit() == EEPROM_ERROR && TEST_Holds(), "values of the transaction with a flash error");
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values of the rejected transactions after reset");
+}
+
+
+// a reset before the commit halfword keeps the values from before the transaction (the next records are written behind it)
+static void TRANSACTION_PowerLoss(void)
+{
+	TEST_Begin();
+	for (uint16_t i = 0; i < 4; i++)
+	{
+		TEST_Check(TEST_Store(i, 10 + i, EEPROM_SIZE32) == EEPROM_SUCCESS, "write before the transaction");
+		TEST_Expect(i, 10 + i, EEPROM_SIZE32);
+	}
+
+	//take the flash image before the commit halfword (the records of the transaction are programmed)
+	TEST_Check(EEPROM_BeginTransaction() == EEPROM_SUCCESS, "EEPROM_BeginTransaction");
+	for (uint16_t i = 0; i < 4; i++) TEST_Check(TEST_Store(i, 20 + i, i % 2 ? EEPROM_SIZE64 : EEPROM_SIZE_DELETED) == EEPROM_SUCCESS, "write of the transaction");
+	memcpy(TRANSACTION_Image, FLASHSIM_Map(FLASHSIM_BASE), TRANSACTION_IMAGE_SIZE);
+	TEST_Check(EEPROM_Commit() == EEPROM_SUCCESS, "EEPROM_Commit");
+
+	//power loss before the commit: values from before the transaction
+	FLASHSIM_Write(FLASHSIM_BASE, TRANSACTION_Image, TRANSACTION_IMAGE_SIZE);
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values after a reset before the commit");
+	TEST_Check(TEST_Store(0, 30, EEPROM_SIZE16) == EEPROM_SUCCESS, "write after the dropped transaction");
+	TEST_Expect(0, 30, EEPROM_SIZE16);
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values after the dropped transaction and reset");
+}
+
+
+// random transactions (committed and aborted, up to the transaction size) with page transfers (EEPROM_Poll after each) and resets
+static void TRANSACTION_Churn(void)
+{
+	EEPROM_Stats Stats;
+	uint64_t Staged[EEPROM_VARIABLE_COUNT];
+	uint8_t StagedSizes[EEPROM_VARIABLE_COUNT];
+	uint32_t Random = 0x12345678;
+	uint32_t Transfers = 0;
+
+	TEST_Begin();
+	for (uint32_t t = 0; t < TRANSACTION_CHURN; t++)
+	{
+		memcpy(Staged, TEST_Values, sizeof(Staged));
+		memcpy(StagedSizes, TEST_Sizes, sizeof(StagedSizes));
+		Random = Random * 1103515245 + 12345;
+		uint16_t Class = (Random >> 16) % EEPROM_CLASS_COUNT;
+		uint8_t Writes = 1 + (Random >> 20) % EEPROM_TRANSACTION_SIZE;
+		if (EEPROM_BeginTransaction() != EEPROM_SUCCESS) { TEST_Check(0, "EEPROM_BeginTransaction of the churn"); return; }
+
+		//up to the transaction size of writes (a variable written twice takes one place)
+		for (uint8_t w = 0; w < Writes; w++)
+		{
+			Random = Random * 1103515245 + 12345;
+			uint16_t i = Class * TRANSACTION_CLASS_VARIABLES + (Random >> 16) % TRANSACTION_CLASS_VARIABLES;
+			EEPROM_Size Size = (Random >> 8) % 8 == 0 ? EEPROM_SIZE_DELETED : (EEPROM_Size) (EEPROM_SIZE16 + (Random >> 8) % 3);
+			uint64_t Value = ((uint64_t) Random << 32) | t;
+			if (TEST_Store(i, Value, Size) != EEPROM_SUCCESS) { TEST_Check(0, "write of the churn"); return; }
+			Staged[i] = TEST_Cut(Value, Size);
+			StagedSizes[i] = Size;
+		}
+
+		//commit 3 of 4 transactions
+		Random = Random * 1103515245 + 12345;
+		EEPROM_Result result = (Random >> 16) % 4 ? EEPROM_Commit() : EEPROM_AbortTransaction();
+		if (result != EEPROM_SUCCESS) { TEST_Check(0, "end of a transaction of the churn"); return; }
+		if ((Random >> 16) % 4)
+		{
+			memcpy(TEST_Values, Staged, sizeof(Staged));
+			memcpy(TEST_Sizes, StagedSizes, sizeof(StagedSizes));
+		}
+		result = EEPROM_Poll(4);
+		if (result != EEPROM_SUCCESS && result != EEPROM_PENDING) { TEST_Check(0, "EEPROM_Poll of the churn"); return; }
+
+		//reset now and then (replay from the page start or the latest checkpoint, the statistics restart)
+		if (t % 1000 == 500)
+		{
+			EEPROM_GetStats(&Stats);
+			Transfers += Stats.PageTransfers;
+			TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values of the churn after reset");
+		}
+	}
+	EEPROM_GetStats(&Stats);
+	TEST_Check(Transfers + Stats.PageTransfers > 10, "page transfers of the churn");
+	TEST_Check(TEST_Holds(), "values of the churn");
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS && TEST_Holds(), "values of the churn after reset");
+}
+
+
+int main(void)
+{
+	TRANSACTION_Semantics();
+	TRANSACTION_Rejects();
+	TRANSACTION_PowerLoss();
+	TRANSACTION_Churn();
+
+	return TEST_Result("%u variables, %u per transaction, %u classes",
+		(unsigned) EEPROM_VARIABLE_COUNT, (unsigned) EEPROM_TRANSACTION_SIZE, (unsigned) EEPROM_CLASS_COUNT);
+}
@@ -0,0 +1,173 @@
+//tests of the typed C++ front end (eeprom.hpp) on the host flash simulator
+//V2.0
+//
+//checks the size codes and layout sizes at compile time and that every typed access leaves the same flash content
+//and operation counts as the equivalent call of the C API, values written by one are read back by the other
+//usage: typed_test
+
+
+//includes
+#define TEST_NAME		"typed_test"
+#include <cstdio>
+#include <cstring>
+#include "eeprom.hpp"
+#include "test_check.h"
+
+
+//test variables
+enum class TEST_Mode : uint8_t { Off, Slow, Fast };
+struct TEST_Pair { uint16_t Low; uint16_t High; };
+
+using TEST_Mode8 = EEPROM::Var<0, TEST_Mode>;
+using TEST_Int16 = EEPROM::Var<1, int16_t>;
+using TEST_UInt32 = EEPROM::Var<2, uint32_t>;
+using TEST_Float = EEPROM::Var<3, float>;
+using TEST_Double = EEPROM::Var<4, double>;
+using TEST_Int64 = EEPROM::Var<5, int64_t>;
+using TEST_PairVar = EEPROM::Var<6, TEST_Pair>;
+using TEST_Boots = EEPROM::Counter<7>;
+using TEST_Serial = EEPROM::Blob<8, 12>;
+
+//size codes and record sizes (compile time)
+static_assert(TEST_Mode8::Size == (EEPROM_INLINE_VALUES ? EEPROM_SIZE8 : EEPROM_SIZE16) && TEST_Int16::Size == EEPROM_SIZE16);
+static_assert(TEST_UInt32::Size == EEPROM_SIZE32 && TEST_Float::Size == EEPROM_SIZE32 && TEST_PairVar::Size == EEPROM_SIZE32);
+static_assert(TEST_Double::Size == EEPROM_SIZE64 && TEST_Int64::Size == EEPROM_SIZE64);
+static_assert(TEST_Int16::RecordBytes == 4 + EEPROM::CrcBytes && TEST_Double::RecordBytes == 10 + EEPROM::CrcBytes);
+
+//layout (compile time): 2 + 4 (inline: 2) + 4 + 3*6 + 2*10 + counter + blob bytes
+using TEST_Layout = EEPROM::Layout<TEST_Mode8, TEST_Int16, TEST_UInt32, TEST_Float, TEST_Double, TEST_Int64, TEST_PairVar, TEST_Boots, TEST_Serial>;
+static_assert(TEST_Layout::Valid);
+static_assert(TEST_Layout::Bytes == EEPROM::PageHeaderBytes + TEST_Mode8::RecordBytes + TEST_Int16::RecordBytes + 3 * TEST_Float::RecordBytes
+	+ 2 * TEST_Double::RecordBytes + TEST_Boots::RecordBytes + TEST_Serial::RecordBytes);
+static_assert(EEPROM::BoundedLayout<100, TEST_Double, TEST_Int64>::Bytes == EEPROM::PageHeaderBytes + 2 * TEST_Double::RecordBytes);
+
+
+//global variables
+static uint8_t TEST_Image[EEPROM_PAGE_COUNT * FLASH_PAGE_SIZE];
+static FLASHSIM_Counters TEST_Counters;
+
+
+// starts a scenario on a blank flash
+static void TEST_Begin()
+{
+	FLASHSIM_Reset();
+	TEST_Check(EEPROM_Init() == EEPROM_SUCCESS, "EEPROM_Init");
+}
+
+
+// keeps flash content and operation counts of the scenario run by the C API / compares the typed run with it
+static void TEST_Keep()
+{
+	std::memcpy(TEST_Image, FLASHSIM_Map(EEPROM_START_ADDRESS), sizeof(TEST_Image));
+	FLASHSIM_GetCounters(&TEST_Counters);
+}
+
+static void TEST_Compare(const char* Scenario)
+{
+	FLASHSIM_Counters Counters;
+	FLASHSIM_GetCounters(&Counters);
+	TEST_Check(std::memcmp(TEST_Image, FLASHSIM_Map(EEPROM_START_ADDRESS), sizeof(TEST_Image)) == 0, Scenario);
+	TEST_Check(Counters.HalfwordPrograms == TEST_Counters.HalfwordPrograms && Counters.ProgramCalls == TEST_Counters.ProgramCalls
+		&& Counters.PageErases == TEST_Counters.PageErases, Scenario);
+}
+
+
+// writes every value type by the C API and by the front end, reads them back crosswise
+static void TEST_Values()
+{
+	const int16_t Int16 = -1234;
+	const uint32_t UInt32 = 0xDEADBEEF;
+	const float Float = 3.25f;
+	const double Double = -2.5e-7;
+	const int64_t Int64 = -0x123456789ABCLL;
+	const TEST_Pair Pair = {0x1111, 0x2222};
+	EEPROM_Value Value;
+
+	//C API
+	TEST_Begin();
+	Value.uInt16 = (uint16_t) TEST_Mode::Fast; EEPROM_WriteVariable(0, Value, EEPROM_INLINE_VALUES ? EEPROM_SIZE8 : EEPROM_SIZE16);
+	Value.Int16 = Int16; EEPROM_WriteVariable(1, Value, EEPROM_SIZE16);
+	Value.uInt32 = UInt32; EEPROM_WriteVariable(2, Value, EEPROM_SIZE32);
+	Value.Float = Float; EEPROM_WriteVariable(3, Value, EEPROM_SIZE32);
+	Value.Double = Double; EEPROM_WriteVariable(4, Value, EEPROM_SIZE64);
+	Value.Int64 = Int64; EEPROM_WriteVariable(5, Value, EEPROM_SIZE64);
+	Value.uInt32 = Pair.Low | ((uint32_t) Pair.High << 16); EEPROM_WriteVariable(6, Value, EEPROM_SIZE32);
+	Value.Float = Float; TEST_Check(EEPROM_UpdateVariable(3, Value, EEPROM_SIZE32) == EEPROM_UNCHANGED, "C API update of an unchanged value");
+	EEPROM_DeleteVariable(1);
+	TEST_Keep();
+
+	//front end
+	TEST_Begin();
+	TEST_Check(TEST_Mode8::Write(TEST_Mode::Fast) == EEPROM_SUCCESS, "Var<uint8_t enum>::Write");
+	TEST_Check(TEST_Int16::Write(Int16) == EEPROM_SUCCESS, "Var<int16_t>::Write");
+	TEST_Check(TEST_UInt32::Write(UInt32) == EEPROM_SUCCESS, "Var<uint32_t>::Write");
+	TEST_Check(TEST_Float::Write(Float) == EEPROM_SUCCESS, "Var<float>::Write");
+	TEST_Check(TEST_Double::Write(Double) == EEPROM_SUCCESS, "Var<double>::Write");
+	TEST_Check(TEST_Int64::Write(Int64) == EEPROM_SUCCESS, "Var<int64_t>::Write");
+	TEST_Check(TEST_PairVar::Write(Pair) == EEPROM_SUCCESS, "Var<struct>::Write");
+	TEST_Check(TEST_Float::Update(Float) == EEPROM_UNCHANGED, "Var<float>::Update of an unchanged value");
+	TEST_Check(TEST_Int16::Delete() == EEPROM_SUCCESS, "Var<int16_t>::Delete");
+	TEST_Compare("typed writes leave the same flash as the C API");
+
+	//front end reads what the C API wrote (same flash) and the C API reads what the front end wrote
+	TEST_Mode Mode = TEST_Mode::Off;
+	int16_t ReadInt16 = 7;
+	uint32_t ReadUInt32 = 0;
+	float ReadFloat = 0;
+	double ReadDouble = 0;
+	int64_t ReadInt64 = 0;
+	TEST_Pair ReadPair = {0, 0};
+	TEST_Check(TEST_Mode8::Read(Mode) == EEPROM_SUCCESS && Mode == TEST_Mode::Fast, "Var<uint8_t enum>::Read");
+	TEST_Check(TEST_Int16::Read(ReadInt16) == EEPROM_NOT_ASSIGNED && ReadInt16 == 7, "Var<int16_t>::Read of a deleted variable");
+	TEST_Check(TEST_UInt32::Read(ReadUInt32) == EEPROM_SUCCESS && ReadUInt32 == UInt32, "Var<uint32_t>::Read");
+	TEST_Check(TEST_Float::Read(ReadFloat) == EEPROM_SUCCESS && ReadFloat == Float, "Var<float>::Read");
+	TEST_Check(TEST_Double::Read(ReadDouble) == EEPROM_SUCCESS && ReadDouble == Double, "Var<double>::Read");
+	TEST_Check(TEST_Int64::Read(ReadInt64) == EEPROM_SUCCESS && ReadInt64 == Int64, "Var<int64_t>::Read");
+	TEST_Check(TEST_PairVar::Read(ReadPair) == EEPROM_SUCCESS && ReadPair.Low == Pair.Low && ReadPair.High == Pair.High, "Var<struct>::Read");
+	TEST_Check(EEPROM_ReadVariable(4, &Value) == EEPROM_SUCCESS && Value.Double == Double, "C API reads a typed double");
+	TEST_Check(EEPROM_ReadVariable(5, &Value) == EEPROM_SUCCESS && Value.Int64 == Int64, "C API reads a typed int64_t");
+}
+
+
+// batch write, counter and blob by the C API and by the front end
+static void TEST_Others()
+{
+	const uint8_t Serial[] = "SN-0042";
+
+	//C API
+	TEST_Begin();
+	EEPROM_Variable Batch[3];
+	Batch[0].Name = 2; Batch[0].Size = EEPROM_SIZE32; Batch[0].Value.uInt32 = 42;
+	Batch[1].Name = 4; Batch[1].Size = EEPROM_SIZE64; Batch[1].Value.Double = 1.5;
+	Batch[2].Name = 1; Batch[2].Size = EEPROM_SIZE16; Batch[2].Value.Int16 = -1;
+	EEPROM_WriteVariables(Batch, 3);
+	for (uint8_t i = 0; i < 3; i++) EEPROM_IncrementCounter(7, NULL);
+	EEPROM_WriteBlob(8, Serial, sizeof(Serial));
+	TEST_Keep();
+
+	//front end
+	TEST_Begin();
+	const EEPROM_Variable TypedBatch[] = {TEST_UInt32::Entry(42), TEST_Double::Entry(1.5), TEST_Int16::Entry(-1)};
+	TEST_Check(EEPROM_WriteVariables(TypedBatch, 3) == EEPROM_SUCCESS, "batch of typed entries");
+	uint32_t Count = 0;
+	for (uint8_t i = 0; i < 3; i++) TEST_Boots::Increment(&Count);
+	TEST_Check(Count == 3, "Counter::Increment");
+	TEST_Check(TEST_Serial::Write(Serial, sizeof(Serial)) == EEPROM_SUCCESS, "Blob::Write");
+	TEST_Check(TEST_Serial::Write(Serial, 13) == EEPROM_INVALID_SIZE, "Blob::Write longer than the descriptor");
+	TEST_Compare("typed batch, counter and blob leave the same flash as the C API");
+
+	Count = 0;
+	const uint8_t* Data = NULL;
+	uint16_t Length = 0;
+	TEST_Check(TEST_Boots::Read(Count) == EEPROM_SUCCESS && Count == 3, "Counter::Read");
+	TEST_Check(TEST_Serial::Read(Data, Length) == EEPROM_SUCCESS && Length == sizeof(Serial) && std::memcmp(Data, Serial, Length) == 0, "Blob::Read");
+}
+
+
+int main()
+{
+	TEST_Values();
+	TEST_Others();
+
+	return TEST_Result("layout %u B, utilization %.1f%%", (unsigned) TEST_Layout::Bytes, TEST_Layout::Utilization * 100.0);
+}